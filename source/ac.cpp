@@ -0,0 +1,580 @@
+/************************************************************************/
+/* Arithmetic circuit compilation and evaluation					        */
+/* Version:			1.0													*/
+/* Last changed:	18-10-2026                                         	*/
+/*                                                                     	*/
+/* Version History:                                                    	*/
+/*                                                                     	*/
+/* Version Comments:                                                   	*/
+/* - compilation is variable elimination on tables of circuit nodes    	*/
+/*   instead of numbers (Darwiche, 2003); the indicator table of a     	*/
+/*   variable stays in the pool until the variable is eliminated, so   	*/
+/*   every sum node ranges over the states of one variable and the     	*/
+/*   same circuit can be evaluated with max instead of sum.            	*/
+/* - evaluation does not rescale, so on very large networks P(e) may   	*/
+/*   underflow; the junction tree engines do not have this problem.    	*/
+/* - a circuit file names the content hash of its network, so a        	*/
+/*   circuit of another network (or other CPTs) is refused             	*/
+/************************************************************************/
+
+// headers
+#include <algorithm>
+#include <limits>
+#include <iomanip>
+#include <fstream>
+#include "dai/index.h"
+#include "ac.h"
+#include "network.h"
+
+static const size_t npos = (size_t) -1;
+static const size_t zeroNode = 0;
+static const size_t oneNode = 1;
+
+ArithmeticCircuit::ArithmeticCircuit(const dai::FactorGraph &fg)
+{
+    _network = contentHash(fg);
+    _vars = fg.vars();
+    parameter(0.0);                         // zeroNode
+    parameter(1.0);                         // oneNode
+
+    // the indicator tables and the factor tables, as tables of nodes
+    std::vector<Symbolic> pool;
+    _indicators.resize(_vars.size());
+    for (size_t i = 0; i < _vars.size(); i++)
+    {
+        Symbolic s;
+        s.vars = dai::VarSet(_vars[i]);
+        for (size_t x = 0; x < _vars[i].states(); x++)
+        {
+            Node n;
+            n.type = INDICATOR;
+            n.var = i;
+            n.state = x;
+            n.value = 1.0;
+            n.begin = n.end = _children.size();
+            _indicators[i].push_back(_nodes.size());
+            s.nodes.push_back(_nodes.size());
+            _nodes.push_back(n);
+        }
+        pool.push_back(s);
+    }
+    for (size_t I = 0; I < fg.nrFactors(); I++)
+    {
+        Symbolic s;
+        s.vars = fg.factor(I).vars();
+        for (size_t x = 0; x < fg.factor(I).nrStates(); x++)
+            s.nodes.push_back(parameter(fg.factor(I)[x]));
+        pool.push_back(s);
+    }
+
+    // eliminate the variables one by one, smallest product first
+    while (true)
+    {
+        dai::VarSet all;
+        for (auto const& s: pool)
+            all |= s.vars;
+        if (all.empty())
+            break;
+
+        dai::Var best;
+        double bestSize = std::numeric_limits<double>::infinity();
+        for (auto const& v: all)
+        {
+            dai::VarSet domain;
+            for (auto const& s: pool)
+                if (s.vars.contains(v))
+                    domain |= s.vars;
+            double size = 1.0;
+            for (auto const& u: domain)
+                size *= u.states();
+            if (size < bestSize)
+            {
+                bestSize = size;
+                best = v;
+            }
+        }
+
+        std::vector<Symbolic> with, without;
+        dai::VarSet domain;
+        for (auto &s: pool)
+        {
+            if (s.vars.contains(best))
+            {
+                domain |= s.vars;
+                with.push_back(std::move(s));
+            }
+            else
+                without.push_back(std::move(s));
+        }
+
+        // multiply the tables that mention best and sum best out
+        dai::VarSet rest = domain / best;
+        size_t restSize = 1;
+        for (auto const& v: rest)
+            restSize *= v.states();
+        std::vector<std::vector<size_t> > buckets(restSize);
+        std::vector<dai::IndexFor> index;
+        for (auto const& s: with)
+            index.push_back(dai::IndexFor(s.vars, domain));
+        dai::IndexFor target(rest, domain);
+        for (; target.valid(); ++target)
+        {
+            std::vector<size_t> args;
+            for (size_t k = 0; k < with.size(); k++)
+            {
+                args.push_back(with[k].nodes[(size_t) index[k]]);
+                ++index[k];
+            }
+            size_t product = combine(PRODUCT, args);
+            if (product != zeroNode)
+                buckets[(size_t) target].push_back(product);
+        }
+
+        Symbolic summed;
+        summed.vars = rest;
+        for (auto &b: buckets)
+            summed.nodes.push_back(combine(SUM, b));
+        without.push_back(summed);
+        pool.swap(without);
+    }
+
+    std::vector<size_t> scalars;
+    for (auto const& s: pool)
+        scalars.push_back(s.nodes[0]);
+    size_t root = combine(PRODUCT, scalars);
+    if (root != _nodes.size() - 1)
+    {
+        // keep the root last
+        Node n;
+        n.type = SUM;
+        n.var = n.state = npos;
+        n.value = 0.0;
+        n.begin = _children.size();
+        _children.push_back(root);
+        n.end = _children.size();
+        _nodes.push_back(n);
+    }
+
+    _parameters.clear();
+    _unique.clear();
+}
+
+size_t ArithmeticCircuit::parameter(dai::Real value)
+{
+    // equal parameters share a node
+    auto p = _parameters.find(value);
+    if (p != _parameters.end())
+        return p->second;
+
+    Node n;
+    n.type = PARAMETER;
+    n.var = n.state = npos;
+    n.value = value;
+    n.begin = n.end = _children.size();
+    _parameters[value] = _nodes.size();
+    _nodes.push_back(n);
+    return _nodes.size() - 1;
+}
+
+size_t ArithmeticCircuit::combine(NodeType type, std::vector<size_t> args)
+{
+    std::vector<size_t> kept;
+    if (type == PRODUCT)
+    {
+        // fold the parameters into one constant; a zero makes the whole product zero
+        dai::Real constant = 1.0;
+        for (auto a: args)
+        {
+            if (_nodes[a].type == PARAMETER)
+                constant *= _nodes[a].value;
+            else
+                kept.push_back(a);
+        }
+        if (constant == 0.0)
+            return zeroNode;
+        if (constant != 1.0)
+            kept.push_back(parameter(constant));
+        if (kept.empty())
+            return oneNode;
+    }
+    else
+    {
+        for (auto a: args)
+            if (a != zeroNode)
+                kept.push_back(a);
+        if (kept.empty())
+            return zeroNode;
+    }
+    if (kept.size() == 1)
+        return kept[0];
+
+    // identical subcircuits are built once
+    std::sort(kept.begin(), kept.end());
+    auto key = std::make_pair((int) type, kept);
+    auto u = _unique.find(key);
+    if (u != _unique.end())
+        return u->second;
+
+    Node n;
+    n.type = type;
+    n.var = n.state = npos;
+    n.value = 0.0;
+    n.begin = _children.size();
+    _children.insert(_children.end(), kept.begin(), kept.end());
+    n.end = _children.size();
+    _unique[key] = _nodes.size();
+    _nodes.push_back(n);
+    return _nodes.size() - 1;
+}
+
+void ArithmeticCircuit::write(std::ostream &os) const
+{
+    os << "AC2 " << std::hex << _network << std::dec << ' ' << _vars.size() << ' ' << _nodes.size() << ' ' << _children.size() << std::endl;
+    for (auto const& v: _vars)
+        os << v.label() << ' ' << v.states() << std::endl;
+
+    os << std::setprecision(std::numeric_limits<dai::Real>::max_digits10);
+    for (auto const& n: _nodes)
+    {
+        switch (n.type)
+        {
+            case INDICATOR:
+                os << "l " << n.var << ' ' << n.state;
+                break;
+            case PARAMETER:
+                os << "p " << n.value;
+                break;
+            case PRODUCT:
+            case SUM:
+                os << ((n.type == PRODUCT) ? "* " : "+ ") << (n.end - n.begin);
+                for (size_t c = n.begin; c < n.end; c++)
+                    os << ' ' << _children[c];
+                break;
+        }
+        os << std::endl;
+    }
+}
+
+void ArithmeticCircuit::read(std::istream &is)
+{
+    std::string magic;
+    size_t nrVars, nrNodes, nrChildren;
+    is >> magic;
+    if (magic == "AC")
+        DAI_THROWE(INVALID_FACTORGRAPH_FILE, "Arithmetic circuit without the hash of its network: compile it again with fg2ac");
+    is >> std::hex >> _network >> std::dec >> nrVars >> nrNodes >> nrChildren;
+    if (!is || (magic != "AC2"))
+        DAI_THROWE(INVALID_FACTORGRAPH_FILE, "Not an arithmetic circuit");
+
+    _vars.clear();
+    _indicators.assign(nrVars, std::vector<size_t>());
+    for (size_t i = 0; i < nrVars; i++)
+    {
+        size_t label, states;
+        is >> label >> states;
+        _vars.push_back(dai::Var(label, states));
+        _indicators[i].assign(states, npos);
+    }
+
+    _nodes.clear();
+    _children.clear();
+    _children.reserve(nrChildren);
+    for (size_t i = 0; (i < nrNodes) && is; i++)
+    {
+        std::string type;
+        Node n;
+        n.var = n.state = npos;
+        n.value = 0.0;
+        n.begin = _children.size();
+        is >> type;
+        if (type == "l")
+        {
+            n.type = INDICATOR;
+            is >> n.var >> n.state;
+            if ((n.var >= nrVars) || (n.state >= _vars[n.var].states()))
+                DAI_THROWE(INVALID_FACTORGRAPH_FILE, "Indicator out of range");
+            _indicators[n.var][n.state] = i;
+        }
+        else if (type == "p")
+        {
+            n.type = PARAMETER;
+            is >> n.value;
+        }
+        else if ((type == "*") || (type == "+"))
+        {
+            n.type = (type == "*") ? PRODUCT : SUM;
+            size_t k, c;
+            is >> k;
+            for (size_t j = 0; j < k; j++)
+            {
+                is >> c;
+                if (c >= i)
+                    DAI_THROWE(INVALID_FACTORGRAPH_FILE, "Circuit nodes must follow their children");
+                _children.push_back(c);
+            }
+        }
+        else
+            DAI_THROWE(INVALID_FACTORGRAPH_FILE, "Unknown node type '" + type + "'");
+        n.end = _children.size();
+        _nodes.push_back(n);
+    }
+    if (!is || (_nodes.size() != nrNodes) || _nodes.empty())
+        DAI_THROWE(INVALID_FACTORGRAPH_FILE, "Truncated arithmetic circuit");
+}
+
+ACEngine::ACEngine(const dai::FactorGraph &fg, const dai::PropertySet &opts) : props()
+{
+    props.inference = Properties::InfType::SUMPROD;
+    if (opts.hasKey("inference"))
+        props.inference = opts.getStringAs<Properties::InfType>("inference");
+    if (opts.hasKey("circuit"))
+        props.circuit = opts.getStringAs<std::string>("circuit");
+
+    if (props.circuit.empty())
+        _circuit = ArithmeticCircuit(fg);
+    else
+    {
+        std::ifstream in(props.circuit);
+        if (!in)
+            DAI_THROWE(CANNOT_READ_FILE, "Cannot read circuit " + props.circuit);
+        _circuit.read(in);
+        if (_circuit.network() != contentHash(fg))
+            DAI_THROWE(INVALID_FACTORGRAPH_FILE, "Circuit " + props.circuit + " was not compiled from this network (its content hash differs)");
+    }
+
+    _vars = fg.vars();
+    std::map<size_t, size_t> circuitIndex;
+    for (size_t c = 0; c < _circuit.vars().size(); c++)
+        circuitIndex[_circuit.vars()[c].label()] = c;
+    for (size_t i = 0; i < _vars.size(); i++)
+    {
+        _label2index[_vars[i].label()] = i;
+        auto c = circuitIndex.find(_vars[i].label());
+        if ((c == circuitIndex.end()) || (_circuit.vars()[c->second].states() != _vars[i].states()))
+            DAI_THROWE(INVALID_FACTORGRAPH_FILE, "Circuit " + props.circuit + " does not have the variables of this network");
+        _circuitVar.push_back(c->second);
+    }
+
+    _lambda.resize(_circuit.vars().size());
+    for (size_t c = 0; c < _lambda.size(); c++)
+        _lambda[c].assign(_circuit.vars()[c].states(), 1.0);
+    _evidence.assign(_vars.size(), npos);
+}
+
+void ACEngine::upward(bool maximize)
+{
+    const std::vector<ArithmeticCircuit::Node> &nodes = _circuit.nodes();
+    const std::vector<size_t> &children = _circuit.children();
+    _value.resize(nodes.size());
+
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        const ArithmeticCircuit::Node &n = nodes[i];
+        dai::Real v = 0.0;
+        switch (n.type)
+        {
+            case ArithmeticCircuit::INDICATOR:
+                v = _lambda[n.var][n.state];
+                break;
+            case ArithmeticCircuit::PARAMETER:
+                v = n.value;
+                break;
+            case ArithmeticCircuit::PRODUCT:
+                v = 1.0;
+                for (size_t c = n.begin; c < n.end; c++)
+                    v *= _value[children[c]];
+                break;
+            case ArithmeticCircuit::SUM:
+                for (size_t c = n.begin; c < n.end; c++)
+                    v = maximize ? std::max(v, _value[children[c]]) : v + _value[children[c]];
+                break;
+        }
+        _value[i] = v;
+    }
+}
+
+void ACEngine::backward()
+{
+    // partial derivatives of the root, children after their parents
+    const std::vector<ArithmeticCircuit::Node> &nodes = _circuit.nodes();
+    const std::vector<size_t> &children = _circuit.children();
+    _derivative.assign(nodes.size(), 0.0);
+    _derivative.back() = 1.0;
+
+    for (size_t i = nodes.size(); (i--) != 0; )
+    {
+        const ArithmeticCircuit::Node &n = nodes[i];
+        dai::Real d = _derivative[i];
+        if (d == 0.0)
+            continue;
+        if (n.type == ArithmeticCircuit::SUM)
+        {
+            for (size_t c = n.begin; c < n.end; c++)
+                _derivative[children[c]] += d;
+        }
+        else if (n.type == ArithmeticCircuit::PRODUCT)
+        {
+            // product of the other children, without dividing by zero
+            size_t zeros = 0;
+            dai::Real nonzero = 1.0;
+            for (size_t c = n.begin; c < n.end; c++)
+            {
+                if (_value[children[c]] == 0.0)
+                    zeros++;
+                else
+                    nonzero *= _value[children[c]];
+            }
+            for (size_t c = n.begin; (c < n.end) && (zeros < 2); c++)
+            {
+                dai::Real v = _value[children[c]];
+                if (zeros == 0)
+                    _derivative[children[c]] += d * nonzero / v;
+                else if (v == 0.0)
+                    _derivative[children[c]] += d * nonzero;
+            }
+        }
+    }
+}
+
+void ACEngine::run(const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues)
+{
+    for (size_t i = 0; i < _vars.size(); i++)
+        if (_evidence[i] != npos)
+        {
+            std::fill(_lambda[_circuitVar[i]].begin(), _lambda[_circuitVar[i]].end(), 1.0);
+            _evidence[i] = npos;
+        }
+    for (size_t k = 0; k < evidenceVars.size(); k++)
+    {
+        std::vector<dai::Real> &lambda = _lambda[_circuitVar[evidenceVars[k]]];
+        std::fill(lambda.begin(), lambda.end(), 0.0);
+        lambda[evidenceValues[k]] = 1.0;
+        _evidence[evidenceVars[k]] = evidenceValues[k];
+    }
+
+    bool maximize = (props.inference == Properties::InfType::MAXPROD);
+    upward(maximize);
+    if (!maximize)
+        backward();
+}
+
+dai::Factor ACEngine::belief(const dai::Var &v)
+{
+    if (props.inference == Properties::InfType::MAXPROD)
+        return calcMarginal(dai::VarSet(v));
+
+    // P(v = x, e) is the derivative with respect to lambda(v = x) for unobserved v
+    size_t i = _label2index[v.label()];
+    dai::Factor result(v, 0.0);
+    if (probability() <= 0.0)
+        return result;
+    if (_evidence[i] != npos)
+        result.set(_evidence[i], 1.0);
+    else
+    {
+        for (size_t x = 0; x < v.states(); x++)
+            result.set(x, _derivative[_circuit.indicator(_circuitVar[i], x)]);
+        if (result.sum() > 0.0)
+            result.normalize();
+    }
+    return result;
+}
+
+dai::Factor ACEngine::calcMarginal(const dai::VarSet &vs)
+{
+    bool maximize = (props.inference == Properties::InfType::MAXPROD);
+    if ((vs.size() == 1) && !maximize)
+        return belief(*vs.begin());
+
+    // one upward pass per joint state of vs, with vs entered as extra evidence
+    std::vector<std::vector<dai::Real> > saved;
+    for (auto const& v: vs)
+        saved.push_back(_lambda[_circuitVar[_label2index[v.label()]]]);
+
+    dai::Factor result(vs, 0.0);
+    for (size_t x = 0; x < result.nrStates(); x++)
+    {
+        std::map<dai::Var, size_t> state = dai::calcState(vs, x);
+        size_t k = 0;
+        for (auto const& v: vs)
+        {
+            std::vector<dai::Real> &lambda = _lambda[_circuitVar[_label2index[v.label()]]];
+            std::fill(lambda.begin(), lambda.end(), 0.0);
+            lambda[state[v]] = saved[k++][state[v]];
+        }
+        upward(maximize);
+        result.set(x, _value.back());
+    }
+
+    size_t k = 0;
+    for (auto const& v: vs)
+        _lambda[_circuitVar[_label2index[v.label()]]] = saved[k++];
+    upward(maximize);
+    if (!maximize)
+        backward();
+
+    if (result.sum() > 0.0)
+        result.normalize();
+    return result;
+}
+
+void ACEngine::calcMarginal(const dai::VarSet &vs, std::vector<dai::Real> &marginal)
+{
+    dai::Factor result = calcMarginal(vs);
+    marginal.assign(result.p().begin(), result.p().end());
+}
+
+std::vector<size_t> ACEngine::findMaximum()
+{
+    bool maximize = (props.inference == Properties::InfType::MAXPROD);
+    if (!maximize)
+        upward(true);
+    if (_value.back() <= 0.0)
+        DAI_THROWE(RUNTIME_ERROR, "Failed to decode the MAP state");
+
+    // follow the best child of every max node and all children of every product node
+    const std::vector<ArithmeticCircuit::Node> &nodes = _circuit.nodes();
+    const std::vector<size_t> &children = _circuit.children();
+    std::vector<size_t> fgVar(_circuit.vars().size(), npos);
+    for (size_t i = 0; i < _vars.size(); i++)
+        fgVar[_circuitVar[i]] = i;
+
+    std::vector<size_t> maximum(_vars.size(), 0);
+    std::vector<bool> visited(nodes.size(), false);
+    std::vector<size_t> stack(1, nodes.size() - 1);
+    while (!stack.empty())
+    {
+        size_t i = stack.back();
+        stack.pop_back();
+        if (visited[i])
+            continue;
+        visited[i] = true;
+
+        const ArithmeticCircuit::Node &n = nodes[i];
+        if (n.type == ArithmeticCircuit::INDICATOR)
+        {
+            if (fgVar[n.var] != npos)
+                maximum[fgVar[n.var]] = n.state;
+        }
+        else if (n.type == ArithmeticCircuit::PRODUCT)
+        {
+            for (size_t c = n.begin; c < n.end; c++)
+                stack.push_back(children[c]);
+        }
+        else if (n.type == ArithmeticCircuit::SUM)
+        {
+            size_t best = children[n.begin];
+            for (size_t c = n.begin; c < n.end; c++)
+                if (_value[children[c]] > _value[best])
+                    best = children[c];
+            stack.push_back(best);
+        }
+    }
+
+    if (!maximize)
+    {
+        upward(false);
+        backward();
+    }
+    return maximum;
+}
@@ -0,0 +1,115 @@
+#ifndef ACHEADER
+#define ACHEADER
+
+// STL includes
+#include <vector>
+#include <map>
+#include <string>
+#include <iostream>
+#include <cstdint>
+#include "dai/factorgraph.h"
+#include "dai/varset.h"
+#include "dai/enum.h"
+#include "dai/properties.h"
+#include "engine.h"
+
+// Arithmetic circuit of a network: the network polynomial (sum over all joint states of the product of
+// the factor entries and the evidence indicators) factorized by symbolic variable elimination.
+// Parameters that are zero or one are folded away (determinism), equal parameters share one node and
+// identical subcircuits are merged (local structure). Nodes are stored children first, the root last.
+class ArithmeticCircuit
+{
+    public:
+        enum NodeType { INDICATOR, PARAMETER, PRODUCT, SUM };
+
+        struct Node
+        {
+            NodeType type;
+            size_t var, state;      // INDICATOR: lambda(var = state)
+            dai::Real value;        // PARAMETER
+            size_t begin, end;      // PRODUCT, SUM: children in children()
+        };
+
+        ArithmeticCircuit() : _network(0) {}
+        explicit ArithmeticCircuit(const dai::FactorGraph &fg);
+
+        // text format: a header with the content hash of the network (contentHash in network.h) and the variables
+        // (label and number of states), then one node per line
+        void write(std::ostream &os) const;
+        void read(std::istream &is);
+
+        // the content hash of the network the circuit was compiled from
+        uint64_t network() const { return _network; }
+        const std::vector<dai::Var> &vars() const { return _vars; }
+        const std::vector<Node> &nodes() const { return _nodes; }
+        const std::vector<size_t> &children() const { return _children; }
+        size_t indicator(size_t var, size_t state) const { return _indicators[var][state]; }
+        size_t nrEdges() const { return _children.size(); }
+
+    private:
+        struct Symbolic
+        {
+            dai::VarSet vars;
+            std::vector<size_t> nodes;      // one node per joint state (libDAI order)
+        };
+
+        size_t parameter(dai::Real value);
+        size_t combine(NodeType type, std::vector<size_t> args);
+
+        uint64_t _network;
+        std::vector<dai::Var> _vars;
+        std::vector<Node> _nodes;
+        std::vector<size_t> _children;
+        std::vector<std::vector<size_t> > _indicators;
+
+        // used while compiling only
+        std::map<dai::Real, size_t> _parameters;
+        std::map<std::pair<int, std::vector<size_t> >, size_t> _unique;
+};
+
+// Inference by evaluating an arithmetic circuit: after one upward pass the root holds P(e) and one
+// backward pass (derivatives with respect to the indicators) yields all posterior marginals, in time
+// linear in the size of the circuit. With max instead of sum the circuit yields the MPE. The circuit
+// is read from the "circuit" property (a file written by fg2ac) or compiled from the network.
+class ACEngine : public InferenceEngine
+{
+    public:
+        struct Properties
+        {
+            DAI_ENUM(InfType,SUMPROD,MAXPROD);
+            InfType inference;      // sum-product (marginals, MAP) or max-product (MPE)
+            std::string circuit;    // compiled circuit (empty = compile on construction)
+        } props;
+
+        ACEngine(const dai::FactorGraph &fg, const dai::PropertySet &opts);
+
+        std::string name() const { return "AC"; }
+
+        // set the indicators for the evidence and evaluate the circuit (up, and for SUMPROD also down)
+        void run(const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues);
+
+        dai::Factor belief(const dai::Var &v);
+        dai::Factor calcMarginal(const dai::VarSet &vs);
+        void calcMarginal(const dai::VarSet &vs, std::vector<dai::Real> &marginal);
+        std::vector<size_t> findMaximum();
+
+        const dai::Var &var(size_t i) const { return _vars[i]; }
+        size_t nrVars() const { return _vars.size(); }
+        size_t nrNodes() const { return _circuit.nodes().size(); }
+        dai::Real probability() const { return _value.empty() ? 0.0 : _value.back(); }
+
+    private:
+        void upward(bool maximize);
+        void backward();
+
+        ArithmeticCircuit _circuit;
+        std::vector<dai::Var> _vars;
+        std::map<size_t, size_t> _label2index;
+        std::vector<size_t> _circuitVar;                // per variable: its index in the circuit
+        std::vector<std::vector<dai::Real> > _lambda;    // per circuit variable: indicator values
+        std::vector<size_t> _evidence;                  // per variable: observed state (or npos)
+        std::vector<dai::Real> _value;                  // per node: value of the last upward pass
+        std::vector<dai::Real> _derivative;             // per node: d root / d node
+};
+
+#endif // defined ACHEADER
@@ -12,6 +12,8 @@
 
 // headers
 #include "mfesim.h"
+#include "metrics.h"
+#include "rng.h"
 #include <cmath>
 #include <chrono>
 
@@ -35,15 +37,23 @@ const int iterations = 1000;    // if fixed i is used
 std::vector<unsigned long int> annealed_map(dai::FactorGraph fg, std::vector<unsigned int> hypothesis_vars, std::vector<unsigned int> evidence_vars,
 	std::vector<unsigned int> evidence_values, unsigned long int cutoffTime)
 {
-    unsigned long int timeBound = cutoffTime * 1000000000UL;
+    // the junction tree is built once; evidence and sampled hypothesis values are entered per propagation
+    std::unique_ptr<InferenceEngine> jt(newEngine(fg, engineOptions("inference",std::string("SUMPROD"))));
+    return annealed_map(*jt, hypothesis_vars, evidence_vars, evidence_values, cutoffTime);
+}
+
+std::vector<unsigned long int> annealed_map(InferenceEngine &jt, const std::vector<unsigned int> &hypothesis_vars, const std::vector<unsigned int> &evidence_vars,
+	const std::vector<unsigned int> &evidence_values, double cutoffTime, const SnapshotHook &snapshot)
+{
+    METRIC_SPAN("ANN.search", "hypotheses=" + std::to_string(hypothesis_vars.size()));
+    unsigned long int timeBound = (unsigned long int) (cutoffTime * 1e9);     // cutoffTime may have fractions of a second
 
     std::vector<unsigned long int> map;			// current best map
     std::vector<double> map_scores;	    		// current best map
 	
 	double score = 1.0, cscore = 0.0;			// score of current best / working map
 
-    std::random_device rd;                      // note C++11 code
-    std::mt19937 gen(rd());						// random numbers by Mersenne twister algorithm
+    std::mt19937 gen = taskStream("annealing");	// random numbers by Mersenne twister algorithm (see rng.h)
     std::uniform_real_distribution<> dis(0, 1); // uniform distribution between 0 and 1
     double u;                                   // current random number
     double T;                                   // current temperature
@@ -68,7 +78,7 @@ std::vector<unsigned long int> annealed_map(dai::FactorGraph fg, std::vector<uns
     // 1. initialize X0, T0, and set i = 0
     T = Tinit;
     i = 0;
-	map = local_prior_map(fg, hypothesis_vars, map_scores);
+	map = local_prior_map(jt, hypothesis_vars, map_scores);
     for (auto const& s: map_scores)
 		score *= s;
 
@@ -77,17 +87,14 @@ std::vector<unsigned long int> annealed_map(dai::FactorGraph fg, std::vector<uns
 	cscore = score;
 	currentScores.push_back(cscore);				// prior value
 
-    // clamp evidence
-    for (int j = 0; j < evidence_vars.size(); j++)
-    {
-        fg.clamp(evidence_vars[j], evidence_values[j], false);
-    }
-	
     // 2. while stopping rule is not satisfied
 	while (!stopping)
 	{	
         int xj_index = 0;
-        dai::FactorGraph *fgc = fg.clone();      // make a local copy of fg to work with
+
+        // local copy of the evidence; hypothesis variables are added as they are sampled
+        std::vector<unsigned int> sampled_vars(evidence_vars);
+        std::vector<unsigned int> sampled_values(evidence_values);
 
 		// 3. for each variable xj in hypothesis_vars do
 		for (auto const& xj: hypothesis_vars)
@@ -96,11 +103,8 @@ std::vector<unsigned long int> annealed_map(dai::FactorGraph fg, std::vector<uns
 			u = (double) dis(gen);
 
 			// 5. sample xj proportional to its parents and evidence (using inference)
-            dai::PropertySet opts;
-            dai::JTree jt = dai::JTree(*fgc, opts("updates",std::string("HUGIN"))("inference",std::string("SUMPROD")));
-            jt.init();
-            jt.run();
-            dai::Factor xjFact = jt.belief(fgc->var(xj));
+            jt.run(sampled_vars, sampled_values);
+            dai::Factor xjFact = jt.belief(jt.var(xj));
             int xj_val = sample(xjFact, ((double)dis(gen)));
 
 			// 6. accept sample according to temperature and probability
@@ -138,7 +142,8 @@ std::vector<unsigned long int> annealed_map(dai::FactorGraph fg, std::vector<uns
             {
                 DEBUG(std::cout << "nothing to update: d = 1 " << std::endl;)
             }
-            fgc->clamp(xj, map[xj_index], false);
+            sampled_vars.push_back(xj);
+            sampled_values.push_back(map[xj_index]);
             
 			// 7. keep track of best configuration so far (implicit in map[])
 
@@ -201,7 +206,7 @@ std::vector<unsigned long int> annealed_map(dai::FactorGraph fg, std::vector<uns
 
         if (std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() > timeBound)
         {
-            std::cout << "stopping computation - time bound" << std::endl;
+            std::cerr << "stopping computation - time bound" << std::endl;
             stopping = true;
         }
 
@@ -209,6 +214,8 @@ std::vector<unsigned long int> annealed_map(dai::FactorGraph fg, std::vector<uns
 		
 		// 9. increase i
 		i++;
+		if (snapshot)
+			snapshot(i, map);
 	}	
 	// 10 end while
 
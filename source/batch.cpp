@@ -0,0 +1,368 @@
+/************************************************************************/
+/* Batch queries on one network               					        */
+/* Version:			1.0													*/
+/* Last changed:	18-10-2026                                         	*/
+/*                                                                     	*/
+/* Version History:                                                    	*/
+/*                                                                     	*/
+/* Version Comments:                                                   	*/
+/* - every algorithm is called through its engine overload, so the     	*/
+/*   junction trees of the session are reused by all queries.           */
+/* - relevances are drawn from the stream of their variable (as in      */
+/*   QueryPlan), so stored and computed relevances agree                */
+/************************************************************************/
+
+// headers
+#include <sstream>
+#include <chrono>
+#include <cctype>
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include "mfesim.h"
+#include "batch.h"
+#include "plan.h"
+#include "metrics.h"
+#include "rng.h"
+
+// a comma separated list of numbers or, with names, of variables or states of vars; throws on unknown names
+static std::vector<unsigned int> parseList(const std::string &value, const NetworkNames *names, const std::vector<unsigned int> *vars = NULL)
+{
+    std::vector<unsigned int> list;
+    std::stringstream ss(value);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        if (item.empty())
+            continue;
+        if ((names == NULL) || (item.find_first_not_of("0123456789") == std::string::npos))
+            list.push_back(std::stoul(item));
+        else
+        {
+            size_t x = (vars == NULL) ? names->variable(item) : ((list.size() < vars->size()) ? names->state((*vars)[list.size()], item) : NetworkNames::npos);
+            if (x == NetworkNames::npos)
+                throw std::invalid_argument(item);
+            list.push_back(x);
+        }
+    }
+    return list;
+}
+
+bool parseQuery(const std::string &line, Query &query, std::string &error, const NetworkNames *names)
+{
+    std::stringstream ss(line);
+    std::string token, evidenceValues;
+    if (!(ss >> query.algorithm))
+    {
+        error = "empty query";
+        return false;
+    }
+    std::transform(query.algorithm.begin(), query.algorithm.end(), query.algorithm.begin(), [](unsigned char c) { return std::toupper(c); });
+
+    while (ss >> token)
+    {
+        size_t is = token.find('=');
+        if (is == std::string::npos)
+        {
+            error = "expected key=value instead of '" + token + "'";
+            return false;
+        }
+        std::string key = token.substr(0, is), value = token.substr(is + 1);
+        try
+        {
+            if (key == "id") query.id = value;
+            else if (key == "H") query.hypothesisVars = parseList(value, names);
+            else if (key == "E") query.evidenceVars = parseList(value, names);
+            else if (key == "e") evidenceValues = value;
+            else if (key == "R") query.relevantVars = parseList(value, names);
+            else if (key == "I") query.irrelevantVars = parseList(value, names);
+            else if (key == "D") query.independenceTestVars = parseList(value, names);
+            else if (key == "s") query.samples = std::stoul(value);
+            else if (key == "S") query.samplesRel = std::stoul(value);
+            else if (key == "t") query.relThreshold = std::stod(value);
+            else if (key == "T") query.cutoffTime = std::stod(value);
+            else if (key == "r") query.relevanceComputation = (std::stoul(value) != 0);
+            else if (key == "Q") query.quantified = (std::stoul(value) != 0);
+            else if (key == "q") query.maximum = (std::stoul(value) != 0);
+            else if (key == "m") query.mapList = (std::stoul(value) != 0);
+            else
+            {
+                error = "unknown key '" + key + "'";
+                return false;
+            }
+        }
+        catch (std::exception &)
+        {
+            error = "invalid value for '" + key + "'";
+            return false;
+        }
+    }
+
+    // state names need the evidence variables, which may come later on the line
+    if (!evidenceValues.empty())
+    {
+        try
+        {
+            query.evidenceValues = parseList(evidenceValues, names, &query.evidenceVars);
+        }
+        catch (std::exception &)
+        {
+            error = "invalid value for 'e'";
+            return false;
+        }
+    }
+    if (query.evidenceVars.size() != query.evidenceValues.size())
+    {
+        error = "E and e differ in length";
+        return false;
+    }
+    return true;
+}
+
+std::string jsonString(const std::string &s)
+{
+    std::string json = "\"";
+    for (auto c: s)
+    {
+        if ((c == '"') || (c == '\\'))
+            json += '\\';
+        if ((unsigned char) c < 0x20)
+            json += ' ';
+        else
+            json += c;
+    }
+    return json + "\"";
+}
+
+template<class T> static std::string jsonArray(const std::vector<T> &values)
+{
+    std::ostringstream json;
+    json << "[";
+    for (size_t k = 0; k < values.size(); k++)
+        json << (k ? "," : "") << values[k];
+    json << "]";
+    return json.str();
+}
+
+QuerySession::QuerySession(const dai::FactorGraph &fg, const NetworkNames &names, size_t cacheSize, ResultStore *store) : _fg(fg), _names(names),
+    _cacheSize(cacheSize), _cacheHits(0), _store(store), _network(0), _stored(0)
+{
+    if (_store != NULL)
+    {
+        _network = contentHash(_fg);
+        _engine = storeEngine(_fg);
+    }
+}
+
+InferenceEngine &QuerySession::sumEngine()
+{
+    if (!_sum)
+        _sum.reset(newEngine(_fg, engineOptions("inference",std::string("SUMPROD"))));
+    return *_sum;
+}
+
+InferenceEngine &QuerySession::maxEngine()
+{
+    if (!_max)
+        _max.reset(newEngine(_fg, engineOptions("inference",std::string("MAXPROD"))));
+    return *_max;
+}
+
+static std::string realString(double x)
+{
+    std::ostringstream os;
+    os << std::setprecision(std::numeric_limits<double>::max_digits10) << x;
+    return os.str();
+}
+
+bool QuerySession::lookup(const std::string &key, std::string &value)
+{
+    if ((_store == NULL) || !_store->get(key, value))
+        return false;
+    METRIC_COUNT(CACHE_HITS, 1);
+    _stored++;
+    return true;
+}
+
+std::vector<unsigned long int> QuerySession::map(const Query &q)
+{
+    std::string key, value;
+    std::vector<unsigned long int> map;
+    if (_store != NULL)
+    {
+        key = mapKey(storeQuery(_network, _engine, q.hypothesisVars, q.evidenceVars, q.evidenceValues));
+        if (lookup(key, value))
+        {
+            std::istringstream is(value);
+            for (unsigned long int h; is >> h; )
+                map.push_back(h);
+            return map;
+        }
+    }
+    map = get_map(sumEngine(), q.hypothesisVars, q.evidenceVars, q.evidenceValues, false);
+    if (_store != NULL)
+    {
+        std::ostringstream os;
+        for (auto h: map)
+            os << h << " ";
+        _store->put(key, os.str());
+    }
+    return map;
+}
+
+// on the stream of the variable, as in QueryPlan, so the answer does not depend on the queries before it
+double QuerySession::relevance(const Query &q, unsigned int node, const std::vector<unsigned int> &intermediateVars)
+{
+    std::string key, value;
+    if (_store != NULL)
+    {
+        key = relevanceKey(storeQuery(_network, _engine, q.hypothesisVars, q.evidenceVars, q.evidenceValues), node, q.samplesRel, intermediateVars);
+        if (lookup(key, value))
+            return std::atof(value.c_str());
+    }
+    std::mt19937 gen = indexedStream("relevance", node);
+    double rel = ::relevance(maxEngine(), node, q.evidenceVars, q.evidenceValues, q.hypothesisVars, intermediateVars, q.samplesRel, gen);
+    if (_store != NULL)
+        _store->put(key, realString(rel));
+    return rel;
+}
+
+double QuerySession::independence(const Query &q, bool strong, bool decision, const std::vector<unsigned int> &hypothesisValues)
+{
+    std::string key, value;
+    if (_store != NULL)
+    {
+        key = independenceKey(storeQuery(_network, _engine, q.hypothesisVars, q.evidenceVars, q.evidenceValues), strong, decision, hypothesisValues,
+            q.independenceTestVars);
+        if (lookup(key, value))
+            return std::atof(value.c_str());
+    }
+    double measure = strong ?
+        strong_map_indep_measure(sumEngine(), q.evidenceVars, q.evidenceValues, q.hypothesisVars, hypothesisValues, q.independenceTestVars, q.cutoffTime, decision) :
+        weak_map_indep_measure(sumEngine(), q.evidenceVars, q.evidenceValues, q.hypothesisVars, hypothesisValues, q.independenceTestVars, q.cutoffTime, decision);
+    if (_store != NULL)
+        _store->put(key, realString(measure));
+    return measure;
+}
+
+std::string QuerySession::answer(const Query &q)
+{
+    std::ostringstream json;
+    json << "{\"id\":" << jsonString(q.id) << ",\"algorithm\":" << jsonString(q.algorithm) << ",";
+    auto start = std::chrono::steady_clock::now();
+    try
+    {
+        for (auto const& vars: { &q.hypothesisVars, &q.evidenceVars, &q.relevantVars, &q.irrelevantVars, &q.independenceTestVars })
+            for (auto v: *vars)
+                if (v >= _fg.nrVars())
+                    DAI_THROWE(OBJECT_NOT_FOUND, "Variable " + std::to_string(v) + " does not exist");
+        for (size_t k = 0; k < q.evidenceVars.size(); k++)
+            if (q.evidenceValues[k] >= _fg.var(q.evidenceVars[k]).states())
+                DAI_THROWE(OBJECT_NOT_FOUND, "Variable " + std::to_string(q.evidenceVars[k]) + " has no state " + std::to_string(q.evidenceValues[k]));
+
+        // MAP and MPE depend on nothing but the hypothesis and the evidence
+        std::string key;
+        if (((q.algorithm == "MAP") && !q.mapList) || (q.algorithm == "MPE"))
+            key = q.algorithm + " " + jsonArray(q.hypothesisVars) + " " + jsonArray(q.evidenceVars) + " " + jsonArray(q.evidenceValues);
+        auto cached = key.empty() ? _cache.end() : _cache.find(key);
+
+        std::string result;
+        if (cached != _cache.end())
+        {
+            result = cached->second.first;
+            _recent.splice(_recent.begin(), _recent, cached->second.second);
+            _cacheHits++;
+            METRIC_COUNT(CACHE_HITS, 1);
+        }
+        else if (q.algorithm == "MAP")
+            result = jsonArray(q.mapList ? get_map(sumEngine(), q.hypothesisVars, q.evidenceVars, q.evidenceValues, true) : map(q));
+        else if (q.algorithm == "MPE")
+            result = jsonArray(get_mpe(maxEngine(), q.evidenceVars, q.evidenceValues));
+        else if (q.algorithm == "ANN")
+            result = jsonArray(annealed_map(sumEngine(), q.hypothesisVars, q.evidenceVars, q.evidenceValues, q.cutoffTime));
+        else if (q.algorithm == "MFE")
+        {
+            // with relevance computation, all intermediate variables start out irrelevant (as on the command line)
+            std::vector<unsigned int> irrelevantVars = q.relevanceComputation ? getIntermediateVars(_fg, q.hypothesisVars, q.evidenceVars) : q.irrelevantVars;
+            result = jsonArray(compute_MFE(_fg, sumEngine(), q.relevanceComputation ? maxEngine() : sumEngine(), q.evidenceVars, q.evidenceValues,
+                q.hypothesisVars, q.relevantVars, irrelevantVars, q.relevanceComputation, q.samplesRel, q.relThreshold, q.samples, q.cutoffTime));
+        }
+        else if (q.algorithm == "REL")
+        {
+            std::vector<unsigned int> intermediateVars = getIntermediateVars(_fg, q.hypothesisVars, q.evidenceVars);
+            std::ostringstream rel;
+            rel << "{";
+            for (size_t k = 0; k < intermediateVars.size(); k++)
+                rel << (k ? "," : "") << "\"" << intermediateVars[k] << "\":" << relevance(q, intermediateVars[k], intermediateVars);
+            rel << "}";
+            result = rel.str();
+        }
+        else if ((q.algorithm == "WEAK") || (q.algorithm == "STRONG"))
+        {
+            if (q.quantified && q.maximum)
+                DAI_THROWE(RUNTIME_ERROR, "Q and q cannot be combined");
+            std::vector<unsigned long int> mapValues = map(q);
+            std::vector<unsigned int> hypValues(mapValues.begin(), mapValues.end());
+            bool weak = (q.algorithm == "WEAK");
+            std::ostringstream indep;
+            if (q.quantified)
+                indep << independence(q, !weak, false, hypValues);
+            else if (q.maximum)
+                indep << jsonArray(weak ? max_weak_map_indep(sumEngine(), q.evidenceVars, q.evidenceValues, q.hypothesisVars, hypValues, q.independenceTestVars, q.cutoffTime) :
+                    max_strong_map_indep(sumEngine(), q.evidenceVars, q.evidenceValues, q.hypothesisVars, hypValues, q.independenceTestVars, q.cutoffTime));
+            else
+                indep << ((independence(q, !weak, true, hypValues) == 1.0) ? "true" : "false");
+            result = indep.str();
+        }
+        else
+            DAI_THROWE(UNKNOWN_DAI_ALGORITHM, "Unknown algorithm");
+
+        if (!key.empty() && (cached == _cache.end()) && (_cacheSize > 0))
+        {
+            if (_cache.size() >= _cacheSize)
+            {
+                _cache.erase(_recent.back());
+                _recent.pop_back();
+            }
+            _recent.push_front(key);
+            _cache[key] = std::make_pair(result, _recent.begin());
+        }
+
+        auto end = std::chrono::steady_clock::now();
+        json << "\"result\":" << result << ",\"ns\":" << std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() << "}";
+    }
+    catch (dai::Exception &e)
+    {
+        json << "\"error\":" << jsonString(e.getMsg() + (e.getDetailedMsg().empty() ? "" : ": " + e.getDetailedMsg())) << "}";
+    }
+    catch (std::exception &e)
+    {
+        json << "\"error\":" << jsonString(e.what()) << "}";
+    }
+    return json.str();
+}
+
+size_t runBatch(QuerySession &session, const Query &defaults, std::istream &in, std::ostream &out)
+{
+    size_t failed = 0, lineNr = 0;
+    std::string line, error;
+    while (std::getline(in, line))
+    {
+        lineNr++;
+        size_t first = line.find_first_not_of(" \t\r");
+        if ((first == std::string::npos) || (line[first] == '#'))
+            continue;
+
+        Query query(defaults);
+        query.id = std::to_string(lineNr);
+        std::string result;
+        if (parseQuery(line, query, error, &session.names()))
+            result = session.answer(query);
+        else
+            result = "{\"id\":" + jsonString(query.id) + ",\"error\":" + jsonString(error) + "}";
+        if (result.find("\"error\":") != std::string::npos)
+            failed++;
+        out << result << std::endl;
+    }
+    return failed;
+}
@@ -0,0 +1,96 @@
+#ifndef BATCHHEADER
+#define BATCHHEADER
+
+// STL includes
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <list>
+#include <memory>
+#include "dai/factorgraph.h"
+#include "engine.h"
+#include "network.h"
+#include "store.h"
+
+// One query of the batch mode: an algorithm with the same settings as on the command line. On a query line
+// it reads "ALGORITHM key=value ...", with the short command line options as keys (H, E, e, R, I, D for the
+// variables, comma separated; s, S, t, T for samples, relevance samples, relevance threshold and cutoff time;
+// r, Q, q, m = 1 for the switches) and an optional id. Algorithms: MAP, MPE, MFE, ANN, REL, WEAK and STRONG.
+// Variables and evidence values may be given by name when the network has names (see network.h).
+struct Query
+{
+    std::string id;
+    std::string algorithm;
+    std::vector<unsigned int> hypothesisVars;
+    std::vector<unsigned int> evidenceVars;
+    std::vector<unsigned int> evidenceValues;
+    std::vector<unsigned int> relevantVars;
+    std::vector<unsigned int> irrelevantVars;
+    std::vector<unsigned int> independenceTestVars;
+    bool relevanceComputation = false;      // MFE: assess relevance instead of using R and I
+    bool quantified = false;                // WEAK/STRONG: degree of independence
+    bool maximum = false;                   // WEAK/STRONG: largest independent subset
+    bool mapList = false;                   // MAP: list all explanations (on standard error)
+    unsigned long int samples = 100;
+    unsigned long int samplesRel = 10;
+    double relThreshold = 0.1;
+    double cutoffTime = 3600;               // seconds (the server passes what is left of a deadline)
+};
+
+// parses a query line into query (which holds the defaults), resolving names with names (if any); returns
+// false with a message on errors
+bool parseQuery(const std::string &line, Query &query, std::string &error, const NetworkNames *names = NULL);
+
+// Answers queries on one network. The sum- and max-product engines are built at the first query that
+// needs them and kept for all later queries, so only the first query pays for compiling the network.
+// MAP and MPE results are cached per hypothesis and evidence (up to cacheSize results, the least recently
+// used one is dropped to make room). With a result store, MAPs, relevances and independence measures are
+// looked up there first and stored once computed, under the same keys as in QueryPlan (plan.h), so batch
+// queries, the server and single runs share them.
+class QuerySession
+{
+    public:
+        explicit QuerySession(const dai::FactorGraph &fg, const NetworkNames &names = NetworkNames(), size_t cacheSize = 65536,
+            ResultStore *store = NULL);
+
+        // the result as one line of JSON: {"id":...,"algorithm":...,"result":...,"ns":...} or {"id":...,"error":...}
+        std::string answer(const Query &query);
+
+        const dai::FactorGraph &factorGraph() const { return _fg; }
+        const NetworkNames &names() const { return _names; }
+        size_t cacheHits() const { return _cacheHits; }
+
+        // the number of results found in the result store
+        size_t stored() const { return _stored; }
+
+    private:
+        InferenceEngine &sumEngine();
+        InferenceEngine &maxEngine();
+        bool lookup(const std::string &key, std::string &value);
+        std::vector<unsigned long int> map(const Query &q);
+        double relevance(const Query &q, unsigned int node, const std::vector<unsigned int> &intermediateVars);
+        double independence(const Query &q, bool strong, bool decision, const std::vector<unsigned int> &hypothesisValues);
+
+        dai::FactorGraph _fg;
+        NetworkNames _names;
+        std::unique_ptr<InferenceEngine> _sum;
+        std::unique_ptr<InferenceEngine> _max;
+        std::list<std::string> _recent;                // cached keys, most recently used first
+        std::map<std::string, std::pair<std::string, std::list<std::string>::iterator> > _cache;   // "algorithm H E e" -> result, place in _recent
+        size_t _cacheSize;
+        size_t _cacheHits;
+        ResultStore *_store;
+        uint64_t _network;                              // contentHash of the network (with a store)
+        std::string _engine;                            // storeEngine of the network (with a store)
+        size_t _stored;
+};
+
+// answers every query line of in (empty lines and lines starting with # are skipped) with one JSON line on out,
+// flushed per query; returns the number of queries that failed
+size_t runBatch(QuerySession &session, const Query &defaults, std::istream &in, std::ostream &out);
+
+// s as a JSON string literal
+std::string jsonString(const std::string &s);
+
+#endif // defined BATCHHEADER
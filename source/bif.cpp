@@ -0,0 +1,201 @@
+/************************************************************************/
+/* Reader for .bif networks                    					        */
+/* Version:			1.0													*/
+/* Last changed:	18-10-2026                                         	*/
+/*                                                                     	*/
+/* Version History:                                                    	*/
+/*                                                                     	*/
+/* Version Comments:                                                   	*/
+/* - replaces the line based parsing of bif2fg 1.0, which assumed one   */
+/*   declaration per line and the rows of a CPT in canonical order      */
+/* - every variable needs exactly one probability block                 */
+/* - the lexer and the builder are shared with the other formats        */
+/*   (netparse.h)                                                       */
+/* - make check-bif compares check/table.bif with the same CPTs written */
+/*   as rows in check/rows.bif                                          */
+/************************************************************************/
+
+// headers
+#include <algorithm>
+#include "bif.h"
+#include "netparse.h"
+
+// a list of numbers, with or without commas, up to the ';'
+static void numbers(NetworkLexer &lex, std::vector<dai::Real> &values)
+{
+    values.clear();
+    double x;
+    while (lex.next() && !lex.is(";"))
+    {
+        if (lex.is(","))
+            continue;
+        if (!lex.number(x))
+            lex.fail("expected a probability instead of '" + lex.text() + "'");
+        values.push_back(x);
+    }
+    if (!lex.is(";"))
+        lex.fail("expected ';'");
+}
+
+dai::FactorGraph parseBif(const std::string &text, const std::string &source, NetworkNames *names)
+{
+    NetworkLexer lex(text, source, "{}()[],;|", "//");
+    NetworkBuilder builder(source);
+    std::vector<bool> hasCPT;
+    std::vector<dai::Real> values, table, defaults;
+    std::vector<char> filled;
+
+    auto variable = [&lex, &builder](const std::string &name)
+    {
+        size_t v = builder.find(name);
+        if (v == NetworkNames::npos)
+            lex.fail("unknown variable '" + name + "'");
+        return v;
+    };
+
+    while (lex.next())
+    {
+        if (lex.is("network"))
+        {
+            lex.name();
+            lex.expect("{");
+            while (lex.next() && !lex.is("}"))
+                ;
+        }
+        else if (lex.is("variable"))
+        {
+            std::string name = lex.name();
+            if (builder.find(name) != NetworkNames::npos)
+                lex.fail("variable '" + name + "' is declared twice");
+            std::vector<std::string> states;
+            size_t card = 0;
+            lex.expect("{");
+            while (lex.next() && !lex.is("}"))
+            {
+                if (lex.is("type"))
+                {
+                    lex.expect("discrete");
+                    lex.expect("[");
+                    if (!lex.next() || !lex.count(card) || (card == 0))
+                        lex.fail("expected the number of states");
+                    lex.expect("]");
+                    lex.expect("{");
+                    do
+                        states.push_back(lex.name());
+                    while (lex.next() && lex.is(","));
+                    if (!lex.is("}"))
+                        lex.fail("expected '}'");
+                    lex.expect(";");
+                    if (states.size() != card)
+                        lex.fail("variable '" + name + "' has " + std::to_string(card) + " states but " + std::to_string(states.size()) + " state names");
+                }
+                else if (lex.is("property"))
+                    lex.skipStatement();
+                else
+                    lex.fail("unexpected '" + lex.text() + "' in variable '" + name + "'");
+            }
+            if (card == 0)
+                lex.fail("variable '" + name + "' has no discrete type");
+            builder.addVariable(name, states);
+            hasCPT.push_back(false);
+        }
+        else if (lex.is("probability"))
+        {
+            // the parents first, then the child: the order of the table
+            std::vector<size_t> vars;
+            lex.expect("(");
+            size_t child = variable(lex.name());
+            lex.next();
+            if (lex.is("|"))
+                do
+                    vars.push_back(variable(lex.name()));
+                while (lex.next() && lex.is(","));
+            if (!lex.is(")"))
+                lex.fail("expected ')'");
+            vars.push_back(child);
+            const std::string &name = builder.name(child);
+            if (hasCPT[child])
+                lex.fail("variable '" + name + "' has two probability blocks");
+            hasCPT[child] = true;
+
+            size_t card = builder.states(child).size(), rows = 1;
+            for (size_t k = 0; k + 1 < vars.size(); k++)
+                rows *= builder.states(vars[k]).size();
+            table.assign(rows * card, 0.0);
+            filled.assign(rows, 0);
+            defaults.clear();
+
+            lex.expect("{");
+            while (lex.next() && !lex.is("}"))
+            {
+                if (lex.is("table"))
+                {
+                    // one block of parent configurations per state of the child: transposed into rows
+                    numbers(lex, values);
+                    if (values.size() != table.size())
+                        lex.fail("table of '" + name + "' has " + std::to_string(values.size()) + " entries instead of " + std::to_string(table.size()));
+                    for (size_t row = 0; row < rows; row++)
+                        for (size_t x = 0; x < card; x++)
+                            table[row * card + x] = values[x * rows + row];
+                    filled.assign(rows, 1);
+                }
+                else if (lex.is("default"))
+                {
+                    numbers(lex, defaults);
+                    if (defaults.size() != card)
+                        lex.fail("default of '" + name + "' has " + std::to_string(defaults.size()) + " entries instead of " + std::to_string(card));
+                }
+                else if (lex.is("("))
+                {
+                    // the row of these parent states, the last parent changing fastest
+                    size_t row = 0;
+                    for (size_t k = 0; k + 1 < vars.size(); k++)
+                    {
+                        std::string state = lex.name();
+                        const std::vector<std::string> &s = builder.states(vars[k]);
+                        size_t x = std::find(s.begin(), s.end(), state) - s.begin();
+                        if (x == s.size())
+                            lex.fail("variable '" + builder.name(vars[k]) + "' has no state '" + state + "'");
+                        row = row * s.size() + x;
+                        lex.next();
+                        if (!lex.is((k + 2 < vars.size()) ? "," : ")"))
+                            lex.fail("expected " + std::to_string(vars.size() - 1) + " parent states");
+                    }
+                    if (vars.size() == 1)
+                        lex.expect(")");
+                    numbers(lex, values);
+                    if (values.size() != card)
+                        lex.fail("row of '" + name + "' has " + std::to_string(values.size()) + " entries instead of " + std::to_string(card));
+                    std::copy(values.begin(), values.end(), table.begin() + row * card);
+                    filled[row] = 1;
+                }
+                else if (lex.is("property"))
+                    lex.skipStatement();
+                else
+                    lex.fail("unexpected '" + lex.text() + "' in the probability of '" + name + "'");
+            }
+
+            // rows without an entry take the default
+            for (size_t row = 0; row < rows; row++)
+                if (!filled[row])
+                {
+                    if (defaults.empty())
+                        lex.fail("probability of '" + name + "' is missing rows");
+                    std::copy(defaults.begin(), defaults.end(), table.begin() + row * card);
+                }
+            builder.addFactor(vars, table);
+        }
+        else
+            lex.fail("unexpected '" + lex.text() + "'");
+    }
+
+    for (size_t i = 0; i < builder.nrVars(); i++)
+        if (!hasCPT[i])
+            DAI_THROWE(INVALID_FACTORGRAPH_FILE, source + ": variable '" + builder.name(i) + "' has no probability block");
+    return builder.build(names);
+}
+
+dai::FactorGraph readBif(const std::string &path, NetworkNames *names)
+{
+    return parseBif(readText(path), path, names);
+}
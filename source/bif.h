@@ -0,0 +1,24 @@
+#ifndef BIFHEADER
+#define BIFHEADER
+
+// STL includes
+#include <string>
+#include <vector>
+#include "dai/factorgraph.h"
+#include "network.h"
+
+// Reader for Bayesian networks in the Bayesian Interchange Format (.bif). The file is read at once and
+// tokenized in a single pass; names are resolved through a hash map and numbers are parsed without
+// exceptions. Variable i (in the order of declaration) becomes the libDAI variable with label i, and every
+// probability block becomes one factor, in the order of the file. A block may hold
+//   table p, p, ...;           all entries, the child changing slowest and the last parent fastest (as JavaBayes)
+//   (s1, s2, ...) p, p, ...;   the distribution of the child for one configuration of the parents
+//   default p, p, ...;         the distribution for configurations without a row
+// in any order. Comments (// and /* */) and property statements are skipped. Errors are reported as
+// INVALID_FACTORGRAPH_FILE with the file and line.
+dai::FactorGraph readBif(const std::string &path, NetworkNames *names = NULL);
+
+// the same for a .bif text in memory; source names the text in error messages
+dai::FactorGraph parseBif(const std::string &text, const std::string &source, NetworkNames *names = NULL);
+
+#endif // defined BIFHEADER
@@ -0,0 +1,353 @@
+/************************************************************************/
+/* Cutset conditioning junction tree          					        */
+/* Version:			1.0													*/
+/* Last changed:	18-10-2026                                         	*/
+/*                                                                     	*/
+/* Version History:                                                    	*/
+/*                                                                     	*/
+/* Version Comments:                                                   	*/
+/* - the cutset is chosen greedily: the variable that takes part in    	*/
+/*   the largest share of the (min-fill) elimination cliques is added  	*/
+/*   until the cliques fit in maxmem, using the same estimate as       	*/
+/*   libDAI's JTree uses to refuse a network.                           */
+/* - all instantiations share one tree structure; per instantiation     */
+/*   only the factor values are reloaded into the arena.                */
+/************************************************************************/
+
+// headers
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "dai/clustergraph.h"
+#include "cutset.h"
+
+static const size_t npos = (size_t) -1;
+static const dai::Real impossible = -std::numeric_limits<dai::Real>::max();
+
+CutsetJTree::CutsetJTree(const dai::FactorGraph &fg, const dai::PropertySet &opts) : props(), _cached(0)
+{
+    props.inference = Properties::InfType::SUMPROD;
+    if (opts.hasKey("inference"))
+        props.inference = opts.getStringAs<Properties::InfType>("inference");
+    props.maxmem = 0;
+    if (opts.hasKey("maxmem"))
+        props.maxmem = opts.getStringAs<size_t>("maxmem");
+    props.threads = 1;
+    if (opts.hasKey("threads"))
+        props.threads = opts.getStringAs<size_t>("threads");
+    props.cache = props.maxmem;
+    if (opts.hasKey("cache"))
+        props.cache = opts.getStringAs<size_t>("cache");
+    _pool = (props.threads > 1) ? &ThreadPool::shared(props.threads) : NULL;
+
+    _vars = fg.vars();
+    for (size_t i = 0; i < _vars.size(); i++)
+        _label2index[_vars[i].label()] = i;
+    _factors = fg.factors();
+
+    // grow the cutset until the elimination cliques of the remaining network fit in maxmem
+    while (props.maxmem > 0)
+    {
+        std::vector<dai::VarSet> clusters;
+        for (auto const& f: _factors)
+        {
+            dai::VarSet rest = f.vars() / _cutset;
+            if (!rest.empty())
+                clusters.push_back(rest);
+        }
+        dai::ClusterGraph cg(clusters);
+        std::vector<dai::VarSet> cliques = cg.VarElim(dai::greedyVariableElimination(dai::eliminationCost_MinFill)).clusters();
+
+        double total = 0.0;
+        size_t width = 0;
+        std::map<dai::Var, double> share;
+        for (auto const& cl: cliques)
+        {
+            double states = 1.0;
+            for (auto const& v: cl)
+                states *= v.states();
+            total += states;
+            width = std::max(width, cl.size());
+            for (auto const& v: cl)
+                share[v] += states;
+        }
+        if ((total * sizeof(dai::Real) <= props.maxmem) || (width <= 1))
+            break;
+
+        auto best = std::max_element(share.begin(), share.end(),
+            [](const std::pair<const dai::Var, double> &a, const std::pair<const dai::Var, double> &b) { return a.second < b.second; });
+        _cutset.insert(best->first);
+    }
+
+    // the network without the cutset; only its structure matters, values are loaded per instantiation
+    std::vector<dai::Factor> structure;
+    for (auto const& f: _factors)
+    {
+        dai::VarSet rest = f.vars() / _cutset;
+        if (!rest.empty())
+            structure.push_back(dai::Factor(rest, 1.0));
+    }
+    dai::FactorGraph inner(structure);
+    _inner.assign(_vars.size(), npos);
+    for (size_t i = 0; i < inner.nrVars(); i++)
+        _inner[_label2index[inner.var(i).label()]] = i;
+
+    dai::PropertySet innerOpts(opts);
+    innerOpts.set("threads", (size_t) 1);
+    innerOpts.set("maxmem", (size_t) 0);
+    size_t trees = (_pool != NULL) ? _pool->size() + 1 : 1;
+    for (size_t t = 0; t < trees; t++)
+        _arenas.push_back(std::unique_ptr<JTArena>(new JTArena(inner, innerOpts)));
+}
+
+JTArena &CutsetJTree::arena()
+{
+    // every worker propagates its instantiations on its own tree
+    return *_arenas[(_pool != NULL) ? _pool->worker() : 0];
+}
+
+void CutsetJTree::forEach(const std::function<void(size_t)> &body)
+{
+    if (_pool == NULL)
+    {
+        for (size_t k = 0; k < _instances.size(); k++)
+            body(k);
+        return;
+    }
+    _pool->parallel_for(_instances.size(), 1, [&body](size_t begin, size_t end)
+    {
+        for (size_t k = begin; k < end; k++)
+            body(k);
+    });
+}
+
+void CutsetJTree::prepare(JTArena &jt, size_t k)
+{
+    // condition the factors on instance k of the cutset and propagate the remaining evidence
+    std::map<dai::Var, size_t> state = dai::calcState(_cutset, _instances[k]);
+    std::vector<dai::Factor> sliced;
+    sliced.reserve(_factors.size());
+    for (auto const& f: _factors)
+    {
+        if ((f.vars() / _cutset).empty())
+            continue;               // constant given the cutset, see run()
+        dai::VarSet conditioned = f.vars() & _cutset;
+        if (conditioned.empty())
+            sliced.push_back(f);
+        else
+            sliced.push_back(f.slice(conditioned, dai::calcLinearState(conditioned, state)));
+    }
+    jt.load(sliced);
+    jt.run(_innerEvidenceVars, _innerEvidenceValues);
+}
+
+bool CutsetJTree::decode(JTArena &jt, size_t k, std::vector<size_t> &maximum, dai::Real &logScore)
+{
+    // the best joint state given instance k, scored on the original factors
+    std::vector<size_t> inner;
+    try
+    {
+        inner = jt.findMaximum();
+    }
+    catch (dai::Exception &e)
+    {
+        return false;
+    }
+
+    std::map<dai::Var, size_t> state = dai::calcState(_cutset, _instances[k]);
+    maximum.assign(_vars.size(), 0);
+    for (size_t i = 0; i < _vars.size(); i++)
+        maximum[i] = (_inner[i] == npos) ? state[_vars[i]] : inner[_inner[i]];
+
+    logScore = 0.0;
+    for (auto const& f: _factors)
+    {
+        std::map<dai::Var, size_t> fstate;
+        for (auto const& v: f.vars())
+            fstate[v] = maximum[_label2index[v.label()]];
+        dai::Real p = f[dai::calcLinearState(f.vars(), fstate)];
+        if (p <= 0.0)
+            return false;
+        logScore += std::log(p);
+    }
+    return true;
+}
+
+void CutsetJTree::run(const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues)
+{
+    bool maximize = (props.inference == Properties::InfType::MAXPROD);
+
+    std::map<dai::Var, size_t> cutsetEvidence;
+    _innerEvidenceVars.clear();
+    _innerEvidenceValues.clear();
+    for (size_t k = 0; k < evidenceVars.size(); k++)
+    {
+        size_t i = evidenceVars[k];
+        if (_inner[i] == npos)
+            cutsetEvidence[_vars[i]] = evidenceValues[k];
+        else
+        {
+            _innerEvidenceVars.push_back(_inner[i]);
+            _innerEvidenceValues.push_back(evidenceValues[k]);
+        }
+    }
+
+    // instantiations of the cutset that agree with the evidence
+    _instances.clear();
+    size_t nrStates = 1;
+    for (auto const& v: _cutset)
+        nrStates *= v.states();
+    for (size_t c = 0; c < nrStates; c++)
+    {
+        std::map<dai::Var, size_t> state = dai::calcState(_cutset, c);
+        bool agrees = true;
+        for (auto const& e: cutsetEvidence)
+            agrees = agrees && (state[e.first] == e.second);
+        if (agrees)
+            _instances.push_back(c);
+    }
+
+    _logZ.assign(_instances.size(), impossible);
+    _tables.assign(_instances.size(), std::vector<dai::Real>());
+    _cached = 0;
+
+    forEach([this, maximize](size_t k)
+    {
+        JTArena &jt = arena();
+        prepare(jt, k);
+        if (maximize)
+        {
+            std::vector<size_t> maximum;
+            dai::Real logScore;
+            if (decode(jt, k, maximum, logScore))
+                _logZ[k] = logScore;
+        }
+        else
+        {
+            // constant factors (all variables in the cutset) scale the whole instantiation
+            std::map<dai::Var, size_t> state = dai::calcState(_cutset, _instances[k]);
+            dai::Real logZ = jt.logZ();
+            for (auto const& f: _factors)
+                if ((f.vars() / _cutset).empty())
+                {
+                    dai::Real p = f[dai::calcLinearState(f.vars(), state)];
+                    logZ = (p > 0.0) ? logZ + std::log(p) : impossible;
+                }
+            if (logZ > impossible)
+                _logZ[k] = logZ;
+        }
+
+        size_t bytes = jt.tablesSize() * sizeof(dai::Real);
+        if (_cached.fetch_add(bytes) + bytes <= props.cache)
+            jt.saveTables(_tables[k]);
+        else
+            _cached -= bytes;
+    });
+}
+
+dai::Factor CutsetJTree::belief(const dai::Var &v)
+{
+    return calcMarginal(dai::VarSet(v));
+}
+
+dai::Factor CutsetJTree::calcMarginal(const dai::VarSet &vs)
+{
+    bool maximize = (props.inference == Properties::InfType::MAXPROD);
+    dai::VarSet inner = vs / _cutset;
+    dai::VarSet outer = vs & _cutset;
+
+    dai::Real maxLog = impossible;
+    for (auto l: _logZ)
+        maxLog = std::max(maxLog, l);
+
+    // weigh the marginal of every instantiation by its probability and add (or maximize) them up per worker
+    std::vector<dai::Factor> partial(_arenas.size(), dai::Factor(vs, 0.0));
+    forEach([&](size_t k)
+    {
+        if (_logZ[k] == impossible)
+            return;
+        JTArena &jt = arena();
+        if (!_tables[k].empty())
+            jt.restoreTables(_tables[k]);
+        else
+            prepare(jt, k);
+
+        dai::Factor m;
+        if (!inner.empty())
+            m = jt.calcMarginal(inner);
+        dai::Real weight = std::exp(_logZ[k] - maxLog);
+        if (maximize && (m.max() > 0.0))
+            weight /= m.max();
+        m *= weight;
+
+        std::map<dai::Var, size_t> state = dai::calcState(_cutset, _instances[k]);
+        for (auto const& v: outer)
+        {
+            dai::Factor point(v, 0.0);
+            point.set(state[v], 1.0);
+            m *= point;
+        }
+
+        dai::Factor &acc = partial[(_pool != NULL) ? _pool->worker() : 0];
+        if (maximize)
+        {
+            for (size_t x = 0; x < acc.nrStates(); x++)
+                acc.set(x, std::max(acc[x], m[x]));
+        }
+        else
+            acc += m;
+    });
+
+    dai::Factor result = partial[0];
+    for (size_t w = 1; w < partial.size(); w++)
+    {
+        for (size_t x = 0; x < result.nrStates(); x++)
+            result.set(x, maximize ? std::max(result[x], partial[w][x]) : result[x] + partial[w][x]);
+    }
+    if (result.sum() > 0.0)
+        result.normalize();
+    return result;
+}
+
+void CutsetJTree::calcMarginal(const dai::VarSet &vs, std::vector<dai::Real> &marginal)
+{
+    dai::Factor result = calcMarginal(vs);
+    marginal.assign(result.p().begin(), result.p().end());
+}
+
+std::vector<size_t> CutsetJTree::findMaximum()
+{
+    // best joint state per worker; ties go to the lowest instantiation so the answer does not depend on threads
+    std::vector<dai::Real> bestScore(_arenas.size(), impossible);
+    std::vector<size_t> bestInstance(_arenas.size(), npos);
+    std::vector<std::vector<size_t> > best(_arenas.size());
+    forEach([&](size_t k)
+    {
+        if (_logZ[k] == impossible)
+            return;
+        JTArena &jt = arena();
+        if (!_tables[k].empty())
+            jt.restoreTables(_tables[k]);
+        else
+            prepare(jt, k);
+
+        std::vector<size_t> maximum;
+        dai::Real logScore;
+        size_t w = (_pool != NULL) ? _pool->worker() : 0;
+        if (decode(jt, k, maximum, logScore) && ((logScore > bestScore[w]) || ((logScore == bestScore[w]) && (k < bestInstance[w]))))
+        {
+            bestScore[w] = logScore;
+            bestInstance[w] = k;
+            best[w].swap(maximum);
+        }
+    });
+
+    size_t winner = npos;
+    for (size_t w = 0; w < best.size(); w++)
+        if ((bestInstance[w] != npos) && ((winner == npos) || (bestScore[w] > bestScore[winner]) ||
+            ((bestScore[w] == bestScore[winner]) && (bestInstance[w] < bestInstance[winner]))))
+            winner = w;
+    if (winner == npos)
+        DAI_THROWE(RUNTIME_ERROR, "Failed to decode the MAP state");
+    return best[winner];
+}
@@ -0,0 +1,76 @@
+#ifndef CUTSETHEADER
+#define CUTSETHEADER
+
+// STL includes
+#include <vector>
+#include <map>
+#include <string>
+#include <atomic>
+#include <memory>
+#include "dai/factorgraph.h"
+#include "dai/varset.h"
+#include "dai/enum.h"
+#include "dai/properties.h"
+#include "engine.h"
+#include "jtarena.h"
+#include "threadpool.h"
+
+// Exact inference for networks whose junction tree does not fit in memory. Variables are added to
+// a conditioning cutset until the junction tree of the network without them fits in maxmem; every
+// instantiation of the cutset is then propagated on that (smaller) tree and the results are summed
+// (or maximized) over the instantiations. Instantiations are propagated in parallel, and the
+// calibrated tables of up to 'cache' bytes worth of instantiations are kept between queries on the
+// same evidence: a smaller maxmem trades memory for time, a larger cache trades it back.
+class CutsetJTree : public InferenceEngine
+{
+    public:
+        struct Properties
+        {
+            DAI_ENUM(InfType,SUMPROD,MAXPROD);
+            InfType inference;      // sum-product (marginals, MAP) or max-product (MPE)
+            size_t maxmem;          // bytes allowed for the clique tables of the junction tree (0 = no conditioning)
+            size_t threads;         // number of instantiations propagated at the same time
+            size_t cache;           // bytes of calibrated tables kept between queries (default maxmem)
+        } props;
+
+        CutsetJTree(const dai::FactorGraph &fg, const dai::PropertySet &opts);
+
+        std::string name() const { return "CUTSET"; }
+
+        // enter the evidence and propagate every instantiation of the cutset that agrees with it
+        void run(const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues);
+
+        dai::Factor belief(const dai::Var &v);
+        dai::Factor calcMarginal(const dai::VarSet &vs);
+        void calcMarginal(const dai::VarSet &vs, std::vector<dai::Real> &marginal);
+        std::vector<size_t> findMaximum();
+
+        const dai::Var &var(size_t i) const { return _vars[i]; }
+        size_t nrVars() const { return _vars.size(); }
+        const dai::VarSet &cutset() const { return _cutset; }
+        size_t nrInstantiations() const { return _instances.size(); }
+
+    private:
+        JTArena &arena();
+        void prepare(JTArena &jt, size_t k);
+        bool decode(JTArena &jt, size_t k, std::vector<size_t> &maximum, dai::Real &logScore);
+        void forEach(const std::function<void(size_t)> &body);
+
+        std::vector<dai::Var> _vars;
+        std::map<size_t, size_t> _label2index;
+        std::vector<dai::Factor> _factors;              // the factors of the network
+        dai::VarSet _cutset;                            // conditioning variables
+        std::vector<size_t> _inner;                     // per variable: index in the inner trees (npos for the cutset)
+
+        ThreadPool *_pool;
+        std::vector<std::unique_ptr<JTArena> > _arenas; // one tree per worker and one for the calling thread
+
+        std::vector<unsigned int> _innerEvidenceVars;   // evidence outside the cutset (inner indices)
+        std::vector<unsigned int> _innerEvidenceValues;
+        std::vector<size_t> _instances;                 // linear states of the cutset that agree with the evidence
+        std::vector<dai::Real> _logZ;                   // per instance: log P(instance, evidence) (MAXPROD: log max)
+        std::vector<std::vector<dai::Real> > _tables;   // per instance: calibrated tables (empty if not cached)
+        std::atomic<size_t> _cached;                    // bytes in _tables
+};
+
+#endif // defined CUTSETHEADER
@@ -0,0 +1,103 @@
+/************************************************************************/
+/* libDAI inference algorithms as engines     					        */
+/* Version:			1.0													*/
+/* Last changed:	18-10-2026                                         	*/
+/*                                                                     	*/
+/* Version History:                                                    	*/
+/*                                                                     	*/
+/* Version Comments:                                                   	*/
+/* - evidence is clamped in a copy of the factor graph and the         	*/
+/*   algorithm is rebuilt per run, as libDAI's backups cannot undo two  */
+/*   clamps that touch the same factor.                                 */
+/************************************************************************/
+
+// headers
+#include "daiengine.h"
+
+const std::map<std::string, std::string> &DAIEngine::defaults()
+{
+    static const std::map<std::string, std::string> algorithms =
+    {
+        { "BP", "BP[updates=SEQMAX,tol=1e-9,maxiter=10000,logdomain=0]" },
+        { "TRWBP", "TRWBP[updates=SEQFIX,tol=1e-9,maxiter=10000,logdomain=0,nrtrees=0]" },
+        { "GIBBS", "GIBBS[maxiter=100000,burnin=1000]" },
+        { "DECMAP", "DECMAP[ianame=BP,iaopts=[updates=SEQMAX,tol=1e-9,maxiter=10000,logdomain=0],reinit=1]" },
+        { "TREEEP", "TREEEP[type=ORG,tol=1e-9,maxiter=10000]" }
+    };
+    return algorithms;
+}
+
+DAIEngine::DAIEngine(const dai::FactorGraph &fg, const dai::PropertySet &opts) : props(), _fg(fg)
+{
+    props.inference = Properties::InfType::SUMPROD;
+    if (opts.hasKey("inference"))
+        props.inference = opts.getStringAs<Properties::InfType>("inference");
+    props.algorithm = "BP";
+    if (opts.hasKey("algorithm"))
+        props.algorithm = opts.getStringAs<std::string>("algorithm");
+
+    // the defaults act as aliases, so properties given in the algorithm string override them
+    std::pair<std::string, dai::PropertySet> nameOpts = dai::parseNameProperties(props.algorithm, defaults());
+    _name = nameOpts.first;
+    _algOpts = nameOpts.second;
+    if (((_name == "BP") || (_name == "TRWBP")) && !_algOpts.hasKey("inference"))
+        _algOpts.set("inference", std::string((props.inference == Properties::InfType::MAXPROD) ? "MAXPROD" : "SUMPROD"));
+
+    // fail on an unknown algorithm or property now rather than at the first run
+    _alg.reset(dai::newInfAlg(_name, _fg, _algOpts));
+}
+
+void DAIEngine::run(const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues)
+{
+    dai::FactorGraph clamped(_fg);
+    for (size_t k = 0; k < evidenceVars.size(); k++)
+        clamped.clamp(evidenceVars[k], evidenceValues[k]);
+
+    _alg.reset(dai::newInfAlg(_name, clamped, _algOpts));
+    _alg->init();
+    _alg->run();
+}
+
+dai::Factor DAIEngine::belief(const dai::Var &v)
+{
+    return _alg->belief(v);
+}
+
+dai::Factor DAIEngine::calcMarginal(const dai::VarSet &vs)
+{
+    try
+    {
+        return _alg->belief(vs);
+    }
+    catch (dai::Exception &e)
+    {
+        if (e.getCode() != dai::Exception::BELIEF_NOT_AVAILABLE)
+            throw;
+    }
+    return dai::calcMarginal(*_alg, vs, true);
+}
+
+void DAIEngine::calcMarginal(const dai::VarSet &vs, std::vector<dai::Real> &marginal)
+{
+    dai::Factor result = calcMarginal(vs);
+    marginal.assign(result.p().begin(), result.p().end());
+}
+
+std::vector<size_t> DAIEngine::findMaximum()
+{
+    try
+    {
+        return _alg->findMaximum();
+    }
+    catch (dai::Exception &e)
+    {
+        if (e.getCode() != dai::Exception::NOT_IMPLEMENTED)
+            throw;
+    }
+
+    // most likely state of every variable on its own
+    std::vector<size_t> maximum;
+    for (size_t i = 0; i < _fg.nrVars(); i++)
+        maximum.push_back(_alg->beliefV(i).p().argmax().first);
+    return maximum;
+}
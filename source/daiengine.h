@@ -0,0 +1,54 @@
+#ifndef DAIENGINEHEADER
+#define DAIENGINEHEADER
+
+// STL includes
+#include <vector>
+#include <string>
+#include <memory>
+#include "dai/alldai.h"
+#include "dai/factorgraph.h"
+#include "dai/enum.h"
+#include "dai/properties.h"
+#include "engine.h"
+
+// Any libDAI inference algorithm (BP, TRWBP, GIBBS, DECMAP, TREEEP, ...) behind the engine interface.
+// The "algorithm" property is a libDAI name with optional properties, e.g. "BP[maxiter=100]"; the
+// properties missing from it are taken from defaults per algorithm. These engines are approximate:
+// marginals over several variables that the algorithm does not keep are computed by clamping
+// (libDAI's calcMarginal), and algorithms without findMaximum decode from single-variable beliefs.
+class DAIEngine : public InferenceEngine
+{
+    public:
+        struct Properties
+        {
+            DAI_ENUM(InfType,SUMPROD,MAXPROD);
+            InfType inference;      // sum-product (marginals, MAP) or max-product (MPE)
+            std::string algorithm;  // libDAI name[properties]
+        } props;
+
+        DAIEngine(const dai::FactorGraph &fg, const dai::PropertySet &opts);
+
+        std::string name() const { return _name; }
+
+        // clamp the evidence and run the algorithm from scratch
+        void run(const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues);
+
+        dai::Factor belief(const dai::Var &v);
+        dai::Factor calcMarginal(const dai::VarSet &vs);
+        void calcMarginal(const dai::VarSet &vs, std::vector<dai::Real> &marginal);
+        std::vector<size_t> findMaximum();
+
+        const dai::Var &var(size_t i) const { return _fg.var(i); }
+        size_t nrVars() const { return _fg.nrVars(); }
+
+        // libDAI algorithms with defaults for all of their required properties
+        static const std::map<std::string, std::string> &defaults();
+
+    private:
+        dai::FactorGraph _fg;
+        std::string _name;
+        dai::PropertySet _algOpts;
+        std::unique_ptr<dai::InfAlg> _alg;
+};
+
+#endif // defined DAIENGINEHEADER
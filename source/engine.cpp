@@ -0,0 +1,237 @@
+/************************************************************************/
+/* Inference engine selection                 					        */
+/* Version:			1.2													*/
+/* Last changed:	18-10-2026                                         	*/
+/*                                                                     	*/
+/* Version History:                                                    	*/
+/* - 1.1: engines are looked up in a registry; AUTO picks one from the 	*/
+/*   predicted size of the junction tree                               	*/
+/* - 1.2: with METRICS every engine is wrapped in a MeteredEngine      	*/
+/*                                                                     	*/
+/* Version Comments:                                                   	*/
+/* - AUTO uses the min-fill triangulation that libDAI's JTree would    	*/
+/*   build: the junction tree if its tables fit in the budget, cutset  	*/
+/*   conditioning if they are at most 64 times too large, and an        */
+/*   approximate algorithm otherwise (parallel max-product BP for MPE,  */
+/*   multi-chain Gibbs sampling for marginals).                         */
+/************************************************************************/
+
+// headers
+#include <algorithm>
+#include <cctype>
+#include "mfesim.h"
+#include "jtarena.h"
+#include "lazyjt.h"
+#include "cutset.h"
+#include "ac.h"
+#include "daiengine.h"
+#include "rbp.h"
+#include "mcgibbs.h"
+#include "metrics.h"
+
+static const size_t defaultBudget = ((size_t) 1) << 30;     // AUTO without maxmem: 1 GiB
+static const double conditioningRange = 64.0;               // AUTO conditions up to this factor over budget
+
+static std::map<std::string, EngineFactory> builtinEngines()
+{
+    std::map<std::string, EngineFactory> engines;
+    engines["JTREE"] = [](const dai::FactorGraph &fg, const dai::PropertySet &opts) -> InferenceEngine * { return new JTArena(fg, opts); };
+    engines["LAZY"] = [](const dai::FactorGraph &fg, const dai::PropertySet &opts) -> InferenceEngine * { return new LazyJTree(fg, opts); };
+    engines["CUTSET"] = [](const dai::FactorGraph &fg, const dai::PropertySet &opts) -> InferenceEngine * { return new CutsetJTree(fg, opts); };
+    engines["AC"] = [](const dai::FactorGraph &fg, const dai::PropertySet &opts) -> InferenceEngine * { return new ACEngine(fg, opts); };
+    engines["RBP"] = [](const dai::FactorGraph &fg, const dai::PropertySet &opts) -> InferenceEngine * { return new ParallelRBP(fg, opts); };
+    engines["MCGIBBS"] = [](const dai::FactorGraph &fg, const dai::PropertySet &opts) -> InferenceEngine * { return new MultiChainGibbs(fg, opts); };
+    for (auto const& a: DAIEngine::defaults())
+        engines[a.first] = [](const dai::FactorGraph &fg, const dai::PropertySet &opts) -> InferenceEngine * { return new DAIEngine(fg, opts); };
+    return engines;
+}
+
+static std::map<std::string, EngineFactory> &registry()
+{
+    static std::map<std::string, EngineFactory> engines = builtinEngines();
+    return engines;
+}
+
+void registerEngine(const std::string &name, EngineFactory factory)
+{
+    registry()[name] = factory;
+}
+
+std::vector<std::string> engineNames()
+{
+    std::vector<std::string> names(1, "AUTO");
+    for (auto const& e: registry())
+        names.push_back(e.first);
+    return names;
+}
+
+// splits "name[properties]" into the upper-case name and the properties part
+static std::string engineName(const dai::PropertySet &opts, std::string &properties)
+{
+    std::string spec = "JTREE";
+    if (opts.hasKey("engine"))
+        spec = opts.getStringAs<std::string>("engine");
+    size_t bracket = std::min(spec.find('['), spec.size());
+    std::string name = spec.substr(0, bracket);
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::toupper(c); });
+    properties = spec.substr(bracket);
+    return name;
+}
+
+EngineChoice chooseEngine(const dai::FactorGraph &fg, const dai::PropertySet &opts)
+{
+    EngineChoice choice;
+    std::string properties;
+    std::string name = engineName(opts, properties);
+
+    // the junction tree libDAI would build: its largest clique and the size of all its tables
+    std::pair<size_t, dai::BigInt> bound = dai::boundTreewidth(fg, &dai::eliminationCost_MinFill);
+    choice.width = bound.first;
+    std::vector<dai::VarSet> clusters;
+    for (size_t I = 0; I < fg.nrFactors(); I++)
+        clusters.push_back(fg.factor(I).vars());
+    choice.states = 0.0;
+    for (auto const& cl: dai::ClusterGraph(clusters).VarElim(dai::greedyVariableElimination(dai::eliminationCost_MinFill)).clusters())
+    {
+        double states = 1.0;
+        for (auto const& v: cl)
+            states *= v.states();
+        choice.states += states;
+    }
+    choice.bytes = 2.0 * choice.states * sizeof(dai::Real);     // tables without and with evidence
+
+    choice.budget = defaultBudget;
+    if (opts.hasKey("maxmem") && (opts.getStringAs<size_t>("maxmem") > 0))
+        choice.budget = opts.getStringAs<size_t>("maxmem");
+
+    bool maximize = opts.hasKey("inference") && (opts.getStringAs<std::string>("inference") == "MAXPROD");
+    if (name != "AUTO")
+    {
+        choice.engine = name + properties;
+        choice.reason = "as requested";
+    }
+    else if (choice.bytes <= choice.budget)
+    {
+        choice.engine = "JTREE";
+        choice.reason = "junction tree fits in the budget";
+    }
+    else if (choice.bytes <= conditioningRange * choice.budget)
+    {
+        choice.engine = "CUTSET";
+        choice.reason = "junction tree exceeds the budget, exact by cutset conditioning";
+    }
+    else
+    {
+        choice.engine = maximize ? "RBP" : "MCGIBBS";
+        choice.reason = maximize ? "junction tree far exceeds the budget, approximate by parallel max-product BP" :
+            "junction tree far exceeds the budget, approximate by multi-chain Gibbs sampling";
+    }
+    return choice;
+}
+
+std::ostream& operator<<(std::ostream& os, const EngineChoice &choice)
+{
+    os << choice.engine << " (" << choice.reason << "; largest clique " << choice.width << " variables, "
+        << choice.states << " table entries, " << choice.bytes << " bytes predicted, budget " << choice.budget << " bytes)";
+    return os;
+}
+
+#ifdef METRICS
+// counts the propagations, clamped variables and marginals of the engine it wraps (see metrics.h)
+class MeteredEngine : public InferenceEngine
+{
+    public:
+        explicit MeteredEngine(InferenceEngine *engine) : _engine(engine) {}
+
+        std::string name() const { return _engine->name(); }
+
+        void run(const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues)
+        {
+            METRIC_COUNT(PROPAGATIONS, 1);
+            METRIC_COUNT(CLAMPS, evidenceVars.size());
+            METRIC_RECORD(EVIDENCE_SIZE, evidenceVars.size());
+            METRIC_SPAN("ENGINE.run", "engine=" + _engine->name() + " evidence=" + std::to_string(evidenceVars.size()));
+            _engine->run(evidenceVars, evidenceValues);
+        }
+
+        dai::Factor belief(const dai::Var &v)
+        {
+            METRIC_COUNT(MARGINALS, 1);
+            METRIC_RECORD(MARGINAL_SIZE, v.states());
+            METRIC_SPAN("ENGINE.marginal", "states=" + std::to_string(v.states()));
+            return _engine->belief(v);
+        }
+
+        dai::Factor calcMarginal(const dai::VarSet &vs)
+        {
+            METRIC_COUNT(MARGINALS, 1);
+            METRIC_RECORD(MARGINAL_SIZE, dai::BigInt_size_t(vs.nrStates()));
+            METRIC_SPAN("ENGINE.marginal", "states=" + std::to_string(dai::BigInt_size_t(vs.nrStates())));
+            return _engine->calcMarginal(vs);
+        }
+
+        void calcMarginal(const dai::VarSet &vs, std::vector<dai::Real> &marginal)
+        {
+            METRIC_COUNT(MARGINALS, 1);
+            METRIC_RECORD(MARGINAL_SIZE, dai::BigInt_size_t(vs.nrStates()));
+            METRIC_SPAN("ENGINE.marginal", "states=" + std::to_string(dai::BigInt_size_t(vs.nrStates())));
+            _engine->calcMarginal(vs, marginal);
+        }
+
+        std::vector<size_t> findMaximum()
+        {
+            METRIC_PHASE("ENGINE.maximize");
+            return _engine->findMaximum();
+        }
+
+        const dai::Var &var(size_t i) const { return _engine->var(i); }
+        size_t nrVars() const { return _engine->nrVars(); }
+
+    private:
+        std::unique_ptr<InferenceEngine> _engine;
+};
+#endif // defined METRICS
+
+InferenceEngine *newEngine(const dai::FactorGraph &fg, const dai::PropertySet &opts)
+{
+    std::string properties;
+    std::string name = engineName(opts, properties);
+    dai::PropertySet engineOpts(opts);
+
+    if (name == "AUTO")
+    {
+        EngineChoice choice = chooseEngine(fg, opts);
+        DEBUG(std::cout << "Engine " << choice << std::endl)
+        if (choice.engine == "CUTSET")
+            engineOpts.set("maxmem", (size_t) (choice.budget / 2));
+        engineOpts.set("engine", choice.engine);
+        return newEngine(fg, engineOpts);
+    }
+
+    auto e = registry().find(name);
+    if (e == registry().end())
+        DAI_THROWE(UNKNOWN_DAI_ALGORITHM, "Unknown inference engine '" + name + "'");
+    engineOpts.set("engine", name);
+    engineOpts.set("algorithm", name + properties);
+
+    // a junction tree that does not fit in maxmem falls back on cutset conditioning instead of failing
+    METRIC_SPAN("ENGINE.build", "engine=" + name);
+    METRIC_COUNT(ENGINE_BUILDS, 1);
+    InferenceEngine *engine;
+    try
+    {
+        engine = e->second(fg, engineOpts);
+    }
+    catch (dai::Exception &ex)
+    {
+        if ((ex.getCode() != dai::Exception::OUT_OF_MEMORY) || ((name != "JTREE") && (name != "LAZY")))
+            throw;
+        DEBUG(std::cout << "Junction tree exceeds maxmem, conditioning on a cutset" << std::endl)
+        engine = new CutsetJTree(fg, engineOpts);
+    }
+#ifdef METRICS
+    return new MeteredEngine(engine);
+#else
+    return engine;
+#endif
+}
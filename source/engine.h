@@ -0,0 +1,62 @@
+#ifndef ENGINEHEADER
+#define ENGINEHEADER
+
+// STL includes
+#include <vector>
+#include <string>
+#include <iostream>
+#include "dai/factorgraph.h"
+#include "dai/varset.h"
+#include "dai/properties.h"
+
+// Exact inference engine on one network. The MAP, MPE and relevance computations only talk to
+// this interface, so the junction tree implementation can be chosen per run (see newEngine).
+class InferenceEngine
+{
+    public:
+        virtual ~InferenceEngine() {}
+
+        virtual std::string name() const = 0;
+
+        // enter the evidence; queries after this call are conditioned on it
+        virtual void run(const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues) = 0;
+
+        // (max-)marginals given the evidence of the last run()
+        virtual dai::Factor belief(const dai::Var &v) = 0;
+        virtual dai::Factor calcMarginal(const dai::VarSet &vs) = 0;
+        virtual void calcMarginal(const dai::VarSet &vs, std::vector<dai::Real> &marginal) = 0;
+
+        // joint state of all variables with maximum probability (max-product engines only)
+        virtual std::vector<size_t> findMaximum() = 0;
+
+        virtual const dai::Var &var(size_t i) const = 0;
+        virtual size_t nrVars() const = 0;
+};
+
+typedef InferenceEngine *(*EngineFactory)(const dai::FactorGraph &fg, const dai::PropertySet &opts);
+
+// makes an engine selectable through the "engine" property (register before creating engines)
+void registerEngine(const std::string &name, EngineFactory factory);
+std::vector<std::string> engineNames();
+
+// the engine that newEngine() will use, with the predicted size of the junction tree
+struct EngineChoice
+{
+    std::string engine;
+    std::string reason;
+    size_t width;           // variables in the largest clique (min-fill, as in libDAI's boundTreewidth)
+    double states;          // entries in all clique tables
+    double bytes;           // predicted memory of the junction tree tables
+    size_t budget;          // maxmem, or 1 GiB when no maxmem is given
+};
+EngineChoice chooseEngine(const dai::FactorGraph &fg, const dai::PropertySet &opts);
+std::ostream& operator<<(std::ostream& os, const EngineChoice &choice);
+
+// creates the engine named by the "engine" property: JTREE (the default), LAZY, CUTSET, AC, RBP, MCGIBBS, a libDAI
+// algorithm (BP, TRWBP, GIBBS, DECMAP, TREEEP, optionally with [properties]) or AUTO, which chooses
+// one by the predicted size of the junction tree. The remaining properties are passed on to the
+// engine. A junction tree that would need more than the "maxmem" property is replaced by cutset
+// conditioning within the same budget
+InferenceEngine *newEngine(const dai::FactorGraph &fg, const dai::PropertySet &opts);
+
+#endif // defined ENGINEHEADER
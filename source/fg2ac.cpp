@@ -0,0 +1,66 @@
+/************************************************************************/
+/* fg2ac .fg to arithmetic circuit compiler   					        */
+/* Version:			1.0													*/
+/* Last changed:	18-10-2026                                         	*/
+/*                                                                     	*/
+/* Version History:                                                    	*/
+/*                                                                     	*/
+/* Version Comments:                                                   	*/
+/* - use fg2ac network.fg network.ac                                   	*/
+/* - the circuit is read by mfesim with --engine AC --circuit network.ac*/
+/* - the circuit names the content hash of the network: mfesim refuses */
+/*   it for any other network                                           */
+/************************************************************************/
+
+// STL includes
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include "dai/factorgraph.h"
+#include "ac.h"
+#include "network.h"
+
+// function prototypes
+int main(int argc, char *argv[]);
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3)
+    {
+        std::cout << "fg2ac: compiles a libDAI factor graph into an arithmetic circuit." << std::endl;
+        std::cout << "Use of this programme is governed by a BSD-style license" << std::endl;
+        std::cout << "that can be found in the LICENSE file." << std::endl;
+        std::cout << "Use: " << argv[0] << " network.fg network.ac" << std::endl;
+        return 0;
+    }
+
+    try
+    {
+        dai::FactorGraph fg = readNetwork(argv[1]);
+
+        auto start = std::chrono::steady_clock::now();
+        ArithmeticCircuit ac(fg);
+        auto end = std::chrono::steady_clock::now();
+
+        std::ofstream outFile;
+        outFile.open(argv[2], std::ios::binary | std::ios::trunc);
+        ac.write(outFile);
+        if (!outFile)
+        {
+            std::cerr << "Cannot write " << argv[2] << std::endl;
+            exit(1);
+        }
+
+        std::cout << argv[1] << ": " << fg.nrVars() << " variables, " << fg.nrFactors() << " factors, content hash "
+            << std::hex << ac.network() << std::dec << std::endl;
+        std::cout << argv[2] << ": " << ac.nodes().size() << " nodes, " << ac.nrEdges() << " edges, compiled in "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << " ms" << std::endl;
+    }
+    catch (dai::Exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        exit(1);
+    }
+}
@@ -0,0 +1,116 @@
+/************************************************************************/
+/* fgconvert .fg to binary network converter   					        */
+/* Version:			1.0													*/
+/* Last changed:	18-10-2026                                         	*/
+/*                                                                     	*/
+/* Version History:                                                    	*/
+/*                                                                     	*/
+/* Version Comments:                                                   	*/
+/* - use fgconvert [-v] network.fg network.fgb (or the other way round) */
+/* - the format of each file follows from its contents (input) or its   */
+/*   extension (output), see network.h; .bif files are read as well     */
+/* - with -v the output is read back and compared with the input, entry */
+/*   by entry: the round trip must be exact                             */
+/* - fgconvert -c a b only compares two networks (the exit code is 1 if */
+/*   they differ); make check runs the round trip fg -> fgb -> fg of    */
+/*   check/roundtrip.fg with it                                         */
+/************************************************************************/
+
+// STL includes
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include "dai/factorgraph.h"
+#include "network.h"
+
+// function prototypes
+int main(int argc, char *argv[]);
+static std::string difference(const dai::FactorGraph &a, const dai::FactorGraph &b);
+
+// the first difference between two networks, or an empty string if they are identical
+static std::string difference(const dai::FactorGraph &a, const dai::FactorGraph &b)
+{
+    if ((a.nrVars() != b.nrVars()) || (a.nrFactors() != b.nrFactors()))
+        return "different number of variables or factors";
+    for (size_t i = 0; i < a.nrVars(); i++)
+        if ((a.var(i).label() != b.var(i).label()) || (a.var(i).states() != b.var(i).states()))
+            return "variable " + std::to_string(i) + " differs";
+    for (size_t I = 0; I < a.nrFactors(); I++)
+    {
+        if (a.factor(I).vars() != b.factor(I).vars())
+            return "scope of factor " + std::to_string(I) + " differs";
+        for (size_t k = 0; k < a.factor(I).nrStates(); k++)
+            if (a.factor(I)[k] != b.factor(I)[k])
+                return "entry " + std::to_string(k) + " of factor " + std::to_string(I) + " differs";
+    }
+    if (structureHash(a) != structureHash(b))
+        return "structure hashes differ";
+    if (contentHash(a) != contentHash(b))
+        return "content hashes differ";
+    return "";
+}
+
+int main(int argc, char *argv[])
+{
+    bool verify = (argc == 4) && (std::strcmp(argv[1], "-v") == 0);
+    bool compare = (argc == 4) && (std::strcmp(argv[1], "-c") == 0);
+    if ((argc != 3) && !verify && !compare)
+    {
+        std::cout << "fgconvert: converts libDAI factor graphs between the .fg and the binary .fgb format." << std::endl;
+        std::cout << "Use of this programme is governed by a BSD-style license" << std::endl;
+        std::cout << "that can be found in the LICENSE file." << std::endl;
+        std::cout << "Use: " << argv[0] << " [-v] network.fg network.fgb (-v: verify the round trip)" << std::endl;
+        std::cout << "  or " << argv[0] << " -c network network (compare two networks)" << std::endl;
+        return 0;
+    }
+    const char *in = argv[argc - 2], *out = argv[argc - 1];
+
+    try
+    {
+        if (compare)
+        {
+            dai::FactorGraph a = readNetwork(in), b = readNetwork(out);
+            std::string diff = difference(a, b);
+            if (!diff.empty())
+            {
+                std::cerr << in << " and " << out << " differ: " << diff << std::endl;
+                exit(1);
+            }
+            std::cout << in << " and " << out << " are identical (structure hash " << std::hex << structureHash(a)
+                << ", content hash " << contentHash(a) << std::dec << ")" << std::endl;
+            return 0;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        dai::FactorGraph fg = readNetwork(in);
+        auto read = std::chrono::steady_clock::now();
+        writeNetwork(fg, out);
+        auto written = std::chrono::steady_clock::now();
+
+        std::cout << in << ": " << fg.nrVars() << " variables, " << fg.nrFactors() << " factors, structure hash "
+            << std::hex << structureHash(fg) << std::dec << ", read in "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(read - start).count() << " ms" << std::endl;
+        std::cout << out << ": written in " << std::chrono::duration_cast<std::chrono::milliseconds>(written - read).count() << " ms" << std::endl;
+
+        if (verify)
+        {
+            dai::FactorGraph back = readNetwork(out);
+            auto reread = std::chrono::steady_clock::now();
+            std::string diff = difference(fg, back);
+            if (!diff.empty())
+            {
+                std::cerr << "Round trip failed: " << diff << std::endl;
+                exit(1);
+            }
+            std::cout << out << ": read back in " << std::chrono::duration_cast<std::chrono::milliseconds>(reread - written).count()
+                << " ms, identical to " << in << std::endl;
+        }
+    }
+    catch (dai::Exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        exit(1);
+    }
+}
@@ -0,0 +1,241 @@
+/************************************************************************/
+/* Forward and likelihood-weighted sampling   					        */
+/* Version:			1.0													*/
+/* Last changed:	18-10-2026                                         	*/
+/*                                                                     	*/
+/* Version History:                                                    	*/
+/*                                                                     	*/
+/* Version Comments:                                                   	*/
+/* - a factor that is normalized over more than one of its variables    */
+/*   (e.g. a root with one state) may take any of them as its child, as */
+/*   long as every variable gets exactly one CPT and the result is a    */
+/*   DAG: the product of the factors is the same joint distribution.    */
+/* - alias tables after Vose (1991).                                    */
+/************************************************************************/
+
+// headers
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include "forward.h"
+#include "rng.h"
+
+static const size_t npos = (size_t) -1;
+static const dai::Real cptTolerance = 1e-6;     // how far the sum of a CPT row may be from one
+
+ForwardSampler::ForwardSampler(const dai::FactorGraph &fg, const dai::PropertySet &opts) : props(), _stream(0)
+{
+    props.threads = 1;
+    if (opts.hasKey("threads"))
+        props.threads = opts.getStringAs<size_t>("threads");
+    props.block = 4096;
+    if (opts.hasKey("block"))
+        props.block = opts.getStringAs<size_t>("block");
+    props.seed = 0;
+    if (opts.hasKey("seed"))
+        props.seed = opts.getStringAs<size_t>("seed");
+    props.block = std::max((size_t) 1, props.block);
+    _pool = (props.threads > 1) ? &ThreadPool::shared(props.threads) : NULL;
+    _seed = (props.seed != 0) ? props.seed : taskSeed("forward");
+    std::seed_seq seq = { _seed };
+    _rng.seed(seq);
+
+    size_t n = fg.nrVars();
+    for (size_t i = 0; i < n; i++)
+        _card.push_back(fg.var(i).states());
+
+    // the variables over which each factor is a conditional distribution
+    std::vector<std::vector<size_t> > candidates(fg.nrFactors());
+    for (size_t I = 0; I < fg.nrFactors(); I++)
+    {
+        const dai::Factor &f = fg.factor(I);
+        for (auto const& v: f.vars())
+        {
+            dai::Factor rows = f.marginal(f.vars() / v, false);
+            bool normalized = true;
+            for (size_t r = 0; (r < rows.nrStates()) && normalized; r++)
+                normalized = (std::fabs(rows[r] - 1.0) < cptTolerance);
+            if (normalized)
+                candidates[I].push_back(fg.findVar(v));
+        }
+    }
+
+    // give every factor a child, factors with the fewest choices first
+    std::vector<size_t> factors(fg.nrFactors()), cpt(n, npos);
+    for (size_t I = 0; I < factors.size(); I++)
+        factors[I] = I;
+    std::stable_sort(factors.begin(), factors.end(), [&candidates](size_t a, size_t b) { return candidates[a].size() < candidates[b].size(); });
+    for (auto I: factors)
+    {
+        size_t child = npos;
+        for (auto c: candidates[I])
+            if (cpt[c] == npos)
+            {
+                child = c;
+                break;
+            }
+        if (child == npos)
+            DAI_THROWE(RUNTIME_ERROR, "Factor " + std::to_string(I) + " is not a conditional probability table of the network");
+        cpt[child] = I;
+    }
+    for (size_t i = 0; i < n; i++)
+        if (cpt[i] == npos)
+            DAI_THROWE(RUNTIME_ERROR, "Variable " + std::to_string(fg.var(i).label()) + " has no conditional probability table");
+
+    _dag = dai::DAG(n);
+    for (size_t i = 0; i < n; i++)
+        for (auto const& v: fg.factor(cpt[i]).vars())
+            if (fg.findVar(v) != i)
+                _dag.addEdge(fg.findVar(v), i, false);
+
+    // topological order (Kahn)
+    std::vector<size_t> missing(n);
+    std::queue<size_t> ready;
+    for (size_t i = 0; i < n; i++)
+        if ((missing[i] = _dag.pa(i).size()) == 0)
+            ready.push(i);
+    while (!ready.empty())
+    {
+        size_t i = ready.front();
+        ready.pop();
+        _order.push_back(i);
+        for (auto const& c: _dag.ch(i))
+            if (--missing[c.node] == 0)
+                ready.push(c.node);
+    }
+    if (_order.size() < n)
+        DAI_THROWE(RUNTIME_ERROR, "The conditional probability tables form a cycle");
+
+    // CPT rows with their alias tables
+    for (size_t i = 0; i < n; i++)
+    {
+        const dai::Factor &f = fg.factor(cpt[i]);
+        std::vector<size_t> factorStride;
+        size_t childStride = 1, stride = 1, rowStride = 1;
+        _parentBegin.push_back(_parents.size());
+        for (auto const& v: f.vars())
+        {
+            size_t j = fg.findVar(v);
+            if (j == i)
+                childStride = stride;
+            else
+            {
+                _parents.push_back(j);
+                _parentStride.push_back(rowStride);
+                factorStride.push_back(stride);
+                rowStride *= v.states();
+            }
+            stride *= v.states();
+        }
+
+        size_t card = _card[i];
+        size_t parents = factorStride.size();
+        _rowBegin.push_back(_prob.size());
+        std::vector<dai::Real> scaled(card);
+        std::vector<size_t> small, large;
+        for (size_t row = 0; row < rowStride; row++)
+        {
+            size_t base = 0, rest = row;
+            for (size_t k = 0; k < parents; k++)
+            {
+                size_t parentCard = _card[_parents[_parentBegin[i] + k]];
+                base += (rest % parentCard) * factorStride[k];
+                rest /= parentCard;
+            }
+
+            size_t first = _prob.size();
+            dai::Real sum = 0.0;
+            for (size_t x = 0; x < card; x++)
+            {
+                _prob.push_back(f[base + x * childStride]);
+                sum += _prob.back();
+            }
+            small.clear();
+            large.clear();
+            for (size_t x = 0; x < card; x++)
+            {
+                scaled[x] = (sum > 0.0) ? _prob[first + x] * card / sum : 1.0;
+                (scaled[x] < 1.0 ? small : large).push_back(x);
+            }
+            _keep.resize(_prob.size(), 1.0);
+            _alias.resize(_prob.size());
+            for (size_t x = 0; x < card; x++)
+                _alias[first + x] = x;
+            while (!small.empty() && !large.empty())
+            {
+                size_t s = small.back(), l = large.back();
+                small.pop_back();
+                large.pop_back();
+                _keep[first + s] = scaled[s];
+                _alias[first + s] = l;
+                scaled[l] = scaled[l] + scaled[s] - 1.0;
+                (scaled[l] < 1.0 ? small : large).push_back(l);
+            }
+        }
+    }
+    _parentBegin.push_back(_parents.size());
+    _evidence.assign(n, npos);
+}
+
+void ForwardSampler::setEvidence(const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues)
+{
+    std::fill(_evidence.begin(), _evidence.end(), npos);
+    for (size_t k = 0; k < evidenceVars.size(); k++)
+        _evidence[evidenceVars[k]] = evidenceValues[k];
+}
+
+template<class RNG> dai::Real ForwardSampler::sample(unsigned int *state, RNG &rng) const
+{
+    std::uniform_real_distribution<dai::Real> uniform(0.0, 1.0);
+    dai::Real weight = 1.0;
+    for (auto i: _order)
+    {
+        size_t card = _card[i];
+        size_t row = 0;
+        for (size_t k = _parentBegin[i]; k < _parentBegin[i + 1]; k++)
+            row += state[_parents[k]] * _parentStride[k];
+        size_t first = _rowBegin[i] + row * card;
+
+        if (_evidence[i] != npos)
+        {
+            state[i] = _evidence[i];
+            weight *= _prob[first + state[i]];
+            continue;
+        }
+        dai::Real u = uniform(rng) * card;
+        size_t x = std::min((size_t) u, card - 1);
+        state[i] = (u - x < _keep[first + x]) ? x : _alias[first + x];
+    }
+    return weight;
+}
+
+void ForwardSampler::generate(size_t n, std::vector<unsigned int> &states, std::vector<dai::Real> &weights)
+{
+    size_t vars = nrVars();
+    states.resize(n * vars);
+    weights.resize(n);
+    size_t blocks = (n + props.block - 1) / props.block;
+    size_t stream = _stream;
+    _stream += blocks;
+
+    auto body = [this, n, vars, stream, &states, &weights](size_t begin, size_t end)
+    {
+        for (size_t b = begin; b < end; b++)
+        {
+            std::seed_seq seq = { _seed, stream + b + 1 };
+            std::mt19937_64 rng(seq);
+            for (size_t s = b * props.block; s < std::min(n, (b + 1) * props.block); s++)
+                weights[s] = sample(&states[s * vars], rng);
+        }
+    };
+    if (_pool != NULL)
+        _pool->parallel_for(blocks, 1, body);
+    else
+        body(0, blocks);
+}
+
+dai::Real ForwardSampler::draw(std::vector<unsigned int> &state)
+{
+    state.resize(nrVars());
+    return sample(state.data(), _rng);
+}
@@ -0,0 +1,68 @@
+#ifndef FORWARDHEADER
+#define FORWARDHEADER
+
+// STL includes
+#include <vector>
+#include <map>
+#include <random>
+#include "dai/factorgraph.h"
+#include "dai/dag.h"
+#include "dai/properties.h"
+#include "threadpool.h"
+
+// Forward sampling from the Bayesian network behind a factor graph, with likelihood weighting for the
+// evidence. The network is recovered from the factors: every factor must be normalized over one of its
+// variables (the child) and the parent-child edges must form a DAG, whose topological order is the
+// sampling order. Every row of every CPT is turned into a Walker alias table once, so drawing a state
+// takes one random number and one table lookup, whatever the number of states. Samples are generated
+// in blocks of 'block' samples, in parallel on the shared thread pool; each block has its own random
+// stream, so the samples do not depend on the number of threads.
+class ForwardSampler
+{
+    public:
+        struct Properties
+        {
+            size_t threads;         // 1 = sequential
+            size_t block;           // samples per block (and per random stream)
+            size_t seed;            // 0 = the next "forward" stream of the run seed (see rng.h)
+        } props;
+
+        ForwardSampler(const dai::FactorGraph &fg, const dai::PropertySet &opts);
+
+        // evidence is not sampled but weighs every sample with its probability given the parents
+        void setEvidence(const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues);
+
+        // n samples; states holds the state of every variable per sample (n rows of nrVars()), weights one weight per sample
+        void generate(size_t n, std::vector<unsigned int> &states, std::vector<dai::Real> &weights);
+
+        // one sample of all variables, returns its weight
+        dai::Real draw(std::vector<unsigned int> &state);
+
+        size_t nrVars() const { return _card.size(); }
+        const dai::DAG &dag() const { return _dag; }
+        const std::vector<size_t> &order() const { return _order; }
+
+    private:
+        template<class RNG> dai::Real sample(unsigned int *state, RNG &rng) const;
+
+        dai::DAG _dag;
+        std::vector<size_t> _order;                     // topological order of the variables
+        std::vector<size_t> _card;                      // states per variable
+
+        // per variable: parents with the stride of each in the row number of the variable's CPT
+        std::vector<size_t> _parentBegin, _parents, _parentStride;
+
+        // per variable: rows of card entries starting at _rowBegin[i], with the probabilities and the
+        // alias table (probability of keeping an entry, and the entry taken otherwise) of every row
+        std::vector<size_t> _rowBegin;
+        std::vector<dai::Real> _prob, _keep;
+        std::vector<unsigned int> _alias;
+
+        std::vector<size_t> _evidence;                  // per variable: observed state (or npos)
+        size_t _seed;
+        size_t _stream;                                 // random streams used so far
+        std::mt19937_64 _rng;                           // for draw()
+        ThreadPool *_pool;
+};
+
+#endif // defined FORWARDHEADER
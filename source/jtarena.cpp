@@ -0,0 +1,864 @@
+/************************************************************************/
+/* Arena-based junction tree                  					        */
+/* Version:			1.0													*/
+/* Last changed:	18-10-2026                                         	*/
+/*                                                                     	*/
+/* Version History:                                                    	*/
+/*                                                                     	*/
+/* Version Comments:                                                   	*/
+/* - the junction tree is built once per network by libDAI; all clique */
+/*   and separator tables are then copied into one contiguous arena and */
+/*   propagation (HUGIN) works in place on that arena. Evidence zeroes  */
+/*   table entries, so a propagation does not allocate memory.          */
+/* - marginals over variables that span several cliques follow JTree's  */
+/*   calcMarginal; their schedule and scratch space are set up on first */
+/*   use and reused for subsequent calls with the same variables.       */
+/************************************************************************/
+
+// headers
+#include <algorithm>
+#include <queue>
+#include <cmath>
+#include <limits>
+#include "jtarena.h"
+
+static const size_t npos = (size_t) -1;
+
+JTArena::JTArena(const dai::FactorGraph &fg, const dai::PropertySet &opts) : props(), _logZ(0.0)
+{
+    props.inference = Properties::InfType::SUMPROD;
+    if (opts.hasKey("inference"))
+        props.inference = opts.getStringAs<Properties::InfType>("inference");
+    props.maxmem = 0;
+    if (opts.hasKey("maxmem"))
+        props.maxmem = opts.getStringAs<size_t>("maxmem");
+    props.threads = 1;
+    if (opts.hasKey("threads"))
+        props.threads = opts.getStringAs<size_t>("threads");
+    props.grain = 65536;
+    if (opts.hasKey("grain"))
+        props.grain = std::max((size_t) 1, opts.getStringAs<size_t>("grain"));
+    _pool = (props.threads > 1) ? &ThreadPool::shared(props.threads) : NULL;
+
+    _vars = fg.vars();
+    for (size_t i = 0; i < _vars.size(); i++)
+        _label2index[_vars[i].label()] = i;
+
+    // let libDAI triangulate the network and root the junction tree; we only keep its structure
+    dai::PropertySet jtOpts;
+    jtOpts.set("updates", std::string("HUGIN"));
+    jtOpts.set("inference", std::string("SUMPROD"));
+    if (props.maxmem > 0)
+        jtOpts.set("maxmem", props.maxmem);
+    dai::JTree jt(fg, jtOpts);
+
+    size_t maxWidth = 1;
+    size_t offset = 0;
+
+    // clique tables (without evidence) followed by the working copies of those tables
+    for (size_t alpha = 0; alpha < jt.nrORs(); alpha++)
+    {
+        Table t;
+        t.offset = offset;
+        t.size = jt.OR(alpha).p().size();
+        t.varOffset = _tableVars.size();
+        t.nrVars = jt.OR(alpha).vars().size();
+        for (auto const& v: jt.OR(alpha).vars())
+        {
+            _tableVars.push_back(_label2index[v.label()]);
+            _tableCards.push_back(v.states());
+        }
+        maxWidth = std::max(maxWidth, t.nrVars);
+        offset += t.size;
+        _base.push_back(t);
+    }
+    _cliqueTotal = offset;
+    for (auto t: _base)
+    {
+        t.offset += _cliqueTotal;
+        _cliques.push_back(t);
+    }
+    offset += _cliqueTotal;
+
+    // separator tables, one per edge of the rooted tree
+    size_t maxSep = 1;
+    for (size_t beta = 0; beta < jt.nrIRs(); beta++)
+    {
+        Table t;
+        t.offset = offset;
+        t.size = jt.Qb[beta].p().size();
+        t.varOffset = _tableVars.size();
+        t.nrVars = jt.IR(beta).size();
+        for (auto const& v: jt.IR(beta))
+        {
+            _tableVars.push_back(_label2index[v.label()]);
+            _tableCards.push_back(v.states());
+        }
+        maxSep = std::max(maxSep, t.size);
+        offset += t.size;
+        _seps.push_back(t);
+    }
+    _scratchSep = offset;
+    offset += maxSep;
+    _scratchSize = offset;
+
+    _arena.resize(offset, 1.0);
+    for (size_t alpha = 0; alpha < _base.size(); alpha++)
+        std::copy(jt.OR(alpha).p().begin(), jt.OR(alpha).p().end(), _arena.begin() + _base[alpha].offset);
+
+    // edges and the strides that project both end points onto the separator
+    std::vector<bool> isChild(_cliques.size(), false);
+    for (size_t i = 0; i < jt.RTree.size(); i++)
+    {
+        Edge e;
+        e.parent = jt.RTree[i].first;
+        e.child = jt.RTree[i].second;
+        e.sep = i;
+        e.parentStrides = addStrides(_cliques[e.parent], _seps[i]);
+        e.childStrides = addStrides(_cliques[e.child], _seps[i]);
+        isChild[e.child] = true;
+        _edges.push_back(e);
+    }
+    for (size_t alpha = 0; alpha < _cliques.size(); alpha++)
+        if (!isChild[alpha])
+            _roots.push_back(alpha);
+
+    // every variable is clamped in (and read from) the smallest clique that contains it
+    _home.assign(_vars.size(), npos);
+    _homeStride.assign(_vars.size(), 0);
+    _homeProjection.assign(_vars.size(), 0);
+    for (size_t alpha = 0; alpha < _cliques.size(); alpha++)
+    {
+        const Table &t = _cliques[alpha];
+        size_t stride = 1;
+        for (size_t j = 0; j < t.nrVars; j++)
+        {
+            size_t i = _tableVars[t.varOffset + j];
+            if ((_home[i] == npos) || (t.size < _cliques[_home[i]].size))
+            {
+                _home[i] = alpha;
+                _homeStride[i] = stride;
+            }
+            stride *= _tableCards[t.varOffset + j];
+        }
+    }
+    for (size_t i = 0; i < _vars.size(); i++)
+    {
+        if (_home[i] == npos)
+            continue;
+        const Table &t = _cliques[_home[i]];
+        _homeProjection[i] = _strides.size();
+        for (size_t j = 0; j < t.nrVars; j++)
+            _strides.push_back((_tableVars[t.varOffset + j] == i) ? 1 : 0);
+    }
+
+    // remember where every factor went, so that other factor values can be loaded later
+    for (size_t I = 0; I < fg.nrFactors(); I++)
+    {
+        _factorClique.push_back(jt.fac2OR(I));
+        _factorStrides.push_back(addStrides(_base[jt.fac2OR(I)], fg.factor(I).vars()));
+    }
+
+    _maxWidth = maxWidth;
+    _counters.resize(maxWidth, 0);
+
+    if (_pool != NULL)
+    {
+        // tree structure for scheduling, a message table per edge and, for edges with large
+        // cliques, partial tables so that a projection can be split over the workers
+        _children.resize(_cliques.size());
+        _parentEdge.assign(_cliques.size(), npos);
+        for (size_t i = 0; i < _edges.size(); i++)
+        {
+            _children[_edges[i].parent].push_back(i);
+            _parentEdge[_edges[i].child] = i;
+        }
+        _pending.reset(new std::atomic<size_t>[_cliques.size()]);
+        _sepZ.assign(_edges.size(), 1.0);
+        _rootZ.assign(_cliques.size(), 1.0);
+
+        offset = _arena.size();
+        for (size_t i = 0; i < _edges.size(); i++)
+        {
+            _msgs.push_back(offset);
+            offset += _seps[i].size;
+            if (std::max(_cliques[_edges[i].parent].size, _cliques[_edges[i].child].size) >= props.grain)
+            {
+                _partials.push_back(offset);
+                offset += (_pool->size() - 1) * _seps[i].size;
+            }
+            else
+                _partials.push_back(npos);
+        }
+        _scratchSize = offset;
+        _arena.resize(offset, 0.0);
+        _counters.resize((_pool->size() + 1) * maxWidth, 0);
+    }
+}
+
+size_t *JTArena::counters()
+{
+    // every worker walks tables with its own odometer
+    return &_counters[(_pool != NULL) ? _pool->worker() * _maxWidth : 0];
+}
+
+size_t JTArena::addStrides(const Table &from, const Table &onto)
+{
+    // for each variable of 'from', its stride in 'onto' (0 if 'onto' does not contain it)
+    size_t offset = _strides.size();
+    for (size_t j = 0; j < from.nrVars; j++)
+    {
+        size_t var = _tableVars[from.varOffset + j];
+        size_t stride = 0, s = 1;
+        for (size_t k = 0; k < onto.nrVars; k++)
+        {
+            if (_tableVars[onto.varOffset + k] == var)
+            {
+                stride = s;
+                break;
+            }
+            s *= _tableCards[onto.varOffset + k];
+        }
+        _strides.push_back(stride);
+    }
+    return offset;
+}
+
+size_t JTArena::addStrides(const Table &from, const dai::VarSet &onto)
+{
+    size_t offset = _strides.size();
+    for (size_t j = 0; j < from.nrVars; j++)
+    {
+        const dai::Var &var = _vars[_tableVars[from.varOffset + j]];
+        size_t stride = 0, s = 1;
+        for (auto const& v: onto)
+        {
+            if (v == var)
+            {
+                stride = s;
+                break;
+            }
+            s *= v.states();
+        }
+        _strides.push_back(stride);
+    }
+    return offset;
+}
+
+size_t JTArena::start(const Table &t, const size_t *strides, size_t index, size_t *counters) const
+{
+    // set the odometer to entry 'index' of t and return the matching entry of the projection
+    const size_t *cards = &_tableCards[t.varOffset];
+    size_t sub = 0;
+    for (size_t j = 0; j < t.nrVars; j++)
+    {
+        counters[j] = index % cards[j];
+        index /= cards[j];
+        sub += counters[j] * strides[j];
+    }
+    return sub;
+}
+
+void JTArena::projectRange(const Table &from, const size_t *strides, dai::Real *to, size_t begin, size_t end, bool maximize)
+{
+    // marginalize (sum or max) entries [begin, end) of 'from' onto 'to', walking 'from' with an odometer
+    const dai::Real *src = &_arena[from.offset];
+    const size_t *cards = &_tableCards[from.varOffset];
+    size_t *count = counters();
+    size_t sub = start(from, strides, begin, count);
+
+    for (size_t i = begin; i < end; i++)
+    {
+        if (maximize)
+        {
+            if (src[i] > to[sub])
+                to[sub] = src[i];
+        }
+        else
+            to[sub] += src[i];
+
+        for (size_t j = 0; j < from.nrVars; j++)
+        {
+            sub += strides[j];
+            if (++count[j] < cards[j])
+                break;
+            sub -= strides[j] * cards[j];
+            count[j] = 0;
+        }
+    }
+}
+
+void JTArena::project(const Table &from, const size_t *strides, dai::Real *to, size_t toSize, bool maximize, size_t partial)
+{
+    std::fill(to, to + toSize, 0.0);
+
+    size_t chunks = (_pool != NULL) && (partial != npos) ? std::min(_pool->size(), from.size / props.grain) : 1;
+    if (chunks <= 1)
+    {
+        projectRange(from, strides, to, 0, from.size, maximize);
+        return;
+    }
+
+    // intra-clique parallelism: each chunk projects onto its own partial table, which are combined afterwards
+    ThreadPool::Group group;
+    size_t step = (from.size + chunks - 1) / chunks;
+    size_t used = 0;
+    for (size_t begin = step; begin < from.size; begin += step)
+    {
+        dai::Real *part = &_arena[partial + (used++) * toSize];
+        size_t end = std::min(from.size, begin + step);
+        _pool->submit(group, [this, from, strides, part, toSize, begin, end, maximize]
+        {
+            std::fill(part, part + toSize, 0.0);
+            projectRange(from, strides, part, begin, end, maximize);
+        });
+    }
+    projectRange(from, strides, to, 0, step, maximize);
+    _pool->wait(group);
+
+    for (size_t c = 0; c < used; c++)
+    {
+        const dai::Real *part = &_arena[partial + c * toSize];
+        for (size_t k = 0; k < toSize; k++)
+        {
+            if (maximize)
+                to[k] = std::max(to[k], part[k]);
+            else
+                to[k] += part[k];
+        }
+    }
+}
+
+void JTArena::absorbRange(const Table &into, const size_t *strides, const dai::Real *ratio, size_t begin, size_t end)
+{
+    dai::Real *dst = &_arena[into.offset];
+    const size_t *cards = &_tableCards[into.varOffset];
+    size_t *count = counters();
+    size_t sub = start(into, strides, begin, count);
+
+    for (size_t i = begin; i < end; i++)
+    {
+        dst[i] *= ratio[sub];
+
+        for (size_t j = 0; j < into.nrVars; j++)
+        {
+            sub += strides[j];
+            if (++count[j] < cards[j])
+                break;
+            sub -= strides[j] * cards[j];
+            count[j] = 0;
+        }
+    }
+}
+
+void JTArena::absorb(const Table &into, const size_t *strides, const dai::Real *newSep, dai::Real *oldSep, size_t sepSize, bool split)
+{
+    // HUGIN update: into *= newSep / oldSep (0/0 = 0), after which oldSep holds newSep
+    for (size_t k = 0; k < sepSize; k++)
+        oldSep[k] = (oldSep[k] == 0.0) ? 0.0 : newSep[k] / oldSep[k];
+
+    if (split && (_pool != NULL))
+        _pool->parallel_for(into.size, props.grain, [this, &into, strides, oldSep](size_t begin, size_t end)
+        {
+            absorbRange(into, strides, oldSep, begin, end);
+        });
+    else
+        absorbRange(into, strides, oldSep, 0, into.size);
+
+    std::copy(newSep, newSep + sepSize, oldSep);
+}
+
+dai::Real JTArena::normalize(dai::Real *table, size_t size)
+{
+    dai::Real sum = 0.0;
+    for (size_t i = 0; i < size; i++)
+        sum += table[i];
+    if (sum > 0.0)
+    {
+        dai::Real inv = 1.0 / sum;
+        for (size_t i = 0; i < size; i++)
+            table[i] *= inv;
+    }
+    return sum;
+}
+
+void JTArena::clamp(const Table &t, size_t stride, size_t card, size_t state)
+{
+    // zero all entries in which the variable (with given stride and cardinality) is not in 'state'
+    dai::Real *dst = &_arena[t.offset];
+    size_t block = stride * card;
+    for (size_t b = 0; b < t.size; b += block)
+    {
+        std::fill(dst + b, dst + b + state * stride, 0.0);
+        std::fill(dst + b + (state + 1) * stride, dst + b + block, 0.0);
+    }
+}
+
+void JTArena::run(const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues)
+{
+    bool maximize = (props.inference == Properties::InfType::MAXPROD);
+
+    // start from the clique tables without evidence and uniform separators
+    if (_pool != NULL)
+        _pool->parallel_for(_cliqueTotal, props.grain, [this](size_t begin, size_t end)
+        {
+            std::copy(_arena.begin() + begin, _arena.begin() + end, _arena.begin() + _cliqueTotal + begin);
+        });
+    else
+        std::copy(_arena.begin(), _arena.begin() + _cliqueTotal, _arena.begin() + _cliqueTotal);
+    if (!_seps.empty())
+        std::fill(_arena.begin() + _seps.front().offset, _arena.begin() + _scratchSep, 1.0);
+
+    // enter evidence in the home clique of each evidence variable
+    for (size_t k = 0; k < evidenceVars.size(); k++)
+    {
+        size_t i = evidenceVars[k];
+        if (_home[i] == npos)
+            continue;
+        clamp(_cliques[_home[i]], _homeStride[i], _vars[i].states(), evidenceValues[k]);
+    }
+
+    if (_pool != NULL)
+    {
+        runParallel(maximize);
+        return;
+    }
+
+    dai::Real *tmp = &_arena[_scratchSep];
+
+    // collect evidence towards the root(s)
+    _logZ = 0.0;
+    for (size_t i = _edges.size(); (i--) != 0; )
+    {
+        const Edge &e = _edges[i];
+        const Table &sep = _seps[e.sep];
+        project(_cliques[e.child], &_strides[e.childStrides], tmp, sep.size, maximize, npos);
+        _logZ += std::log(normalize(tmp, sep.size));
+        absorb(_cliques[e.parent], &_strides[e.parentStrides], tmp, &_arena[sep.offset], sep.size, false);
+    }
+    for (auto root: _roots)
+        _logZ += std::log(normalize(&_arena[_cliques[root].offset], _cliques[root].size));
+
+    // distribute evidence from the root(s)
+    for (size_t i = 0; i < _edges.size(); i++)
+    {
+        const Edge &e = _edges[i];
+        const Table &sep = _seps[e.sep];
+        project(_cliques[e.parent], &_strides[e.parentStrides], tmp, sep.size, maximize, npos);
+        absorb(_cliques[e.child], &_strides[e.childStrides], tmp, &_arena[sep.offset], sep.size, false);
+    }
+
+    for (auto const& t: _cliques)
+        normalize(&_arena[t.offset], t.size);
+}
+
+void JTArena::runParallel(bool maximize)
+{
+    // collect: a clique becomes a task as soon as all of its children have sent their message,
+    // so independent subtrees are processed concurrently
+    ThreadPool::Group group;
+    for (size_t alpha = 0; alpha < _cliques.size(); alpha++)
+        _pending[alpha] = _children[alpha].size();
+    for (size_t alpha = 0; alpha < _cliques.size(); alpha++)
+        if (_children[alpha].empty())
+            _pool->submit(group, [this, alpha, maximize, &group]{ collect(alpha, maximize, group); });
+    _pool->wait(group);
+
+    // sum the normalization constants in a fixed order, independent of the schedule
+    _logZ = 0.0;
+    for (auto z: _sepZ)
+        _logZ += std::log(z);
+    for (auto root: _roots)
+        _logZ += std::log(_rootZ[root]);
+
+    // distribute: every edge becomes a task once its parent clique is final
+    for (auto root: _roots)
+        for (auto e: _children[root])
+            _pool->submit(group, [this, e, maximize, &group]{ distribute(e, maximize, group); });
+    _pool->wait(group);
+}
+
+void JTArena::collect(size_t alpha, bool maximize, ThreadPool::Group &group)
+{
+    const Table &t = _cliques[alpha];
+    for (auto e: _children[alpha])
+        absorb(t, &_strides[_edges[e].parentStrides], &_arena[_msgs[e]], &_arena[_seps[e].offset], _seps[e].size, true);
+
+    size_t e = _parentEdge[alpha];
+    if (e == npos)
+    {
+        _rootZ[alpha] = normalize(&_arena[t.offset], t.size);
+        return;
+    }
+
+    project(t, &_strides[_edges[e].childStrides], &_arena[_msgs[e]], _seps[e].size, maximize, _partials[e]);
+    _sepZ[e] = normalize(&_arena[_msgs[e]], _seps[e].size);
+
+    size_t parent = _edges[e].parent;
+    if (--_pending[parent] == 0)
+        _pool->submit(group, [this, parent, maximize, &group]{ collect(parent, maximize, group); });
+}
+
+void JTArena::distribute(size_t e, bool maximize, ThreadPool::Group &group)
+{
+    const Edge &edge = _edges[e];
+    const Table &child = _cliques[edge.child];
+    project(_cliques[edge.parent], &_strides[edge.parentStrides], &_arena[_msgs[e]], _seps[e].size, maximize, _partials[e]);
+    absorb(child, &_strides[edge.childStrides], &_arena[_msgs[e]], &_arena[_seps[e].offset], _seps[e].size, true);
+    normalize(&_arena[child.offset], child.size);
+
+    for (auto c: _children[edge.child])
+        _pool->submit(group, [this, c, maximize, &group]{ distribute(c, maximize, group); });
+}
+
+void JTArena::load(const std::vector<dai::Factor> &factors)
+{
+    std::fill(_arena.begin(), _arena.begin() + _cliqueTotal, 1.0);
+    for (size_t I = 0; I < factors.size(); I++)
+        absorbRange(_base[_factorClique[I]], &_strides[_factorStrides[I]], &factors[I].p().p()[0], 0, _base[_factorClique[I]].size);
+}
+
+void JTArena::saveTables(std::vector<dai::Real> &tables) const
+{
+    tables.assign(_arena.begin() + _cliqueTotal, _arena.begin() + _scratchSep);
+    tables.push_back(_logZ);
+}
+
+void JTArena::restoreTables(const std::vector<dai::Real> &tables)
+{
+    std::copy(tables.begin(), tables.end() - 1, _arena.begin() + _cliqueTotal);
+    _logZ = tables.back();
+}
+
+dai::Factor JTArena::belief(const dai::Var &v)
+{
+    size_t i = _label2index[v.label()];
+    dai::Factor result(v, 0.0);
+    std::vector<dai::Real> p(v.states(), 0.0);
+    project(_cliques[_home[i]], &_strides[_homeProjection[i]], &p[0], p.size(), false, npos);
+    normalize(&p[0], p.size());
+    for (size_t x = 0; x < p.size(); x++)
+        result.set(x, p[x]);
+    return result;
+}
+
+dai::Factor JTArena::calcMarginal(const dai::VarSet &vs)
+{
+    std::vector<dai::Real> marginal;
+    calcMarginal(vs, marginal);
+    return dai::Factor(vs, marginal);
+}
+
+void JTArena::calcMarginal(const dai::VarSet &vs, std::vector<dai::Real> &marginal)
+{
+    const MarginalPlan &p = plan(vs);       // may grow the arena, so take pointers afterwards
+
+    marginal.assign(p.nrStates, 0.0);
+    dai::Real *tmp = &_arena[p.tmpSep];
+    std::fill(_state.begin(), _state.end(), 0);
+    size_t base = 0;
+
+    // for each joint state of the variables outside the root, clamp them and collect towards the root
+    for (size_t s = 0; s < p.nrRemStates; s++)
+    {
+        for (size_t c = 0; c < p.copySource.size(); c++)
+            std::copy(_arena.begin() + p.copySource[c], _arena.begin() + p.copySource[c] + p.copySize[c],
+                _arena.begin() + p.copyTarget[c]);
+
+        dai::Real scale = 1.0;
+        for (auto const& e: p.edges)
+        {
+            for (size_t k = 0; k < e.clampVar.size(); k++)
+                clamp(e.child, e.clampStride[k], e.clampCard[k], _state[e.clampVar[k]]);
+            project(e.child, &_strides[e.childStrides], tmp, e.sep.size, false, npos);
+            scale *= normalize(tmp, e.sep.size);
+            if (scale == 0.0)
+                break;
+            absorb(e.parent, &_strides[e.parentStrides], tmp, &_arena[e.sep.offset], e.sep.size, false);
+        }
+
+        if (scale > 0.0)
+        {
+            // accumulate the root onto the result, offset by the current state of the remaining variables
+            const dai::Real *src = &_arena[p.root.offset];
+            const size_t *cards = &_tableCards[p.root.varOffset];
+            const size_t *strides = &_strides[p.rootProjection];
+            size_t *count = counters();
+            size_t sub = base;
+            std::fill(count, count + p.root.nrVars, 0);
+            for (size_t i = 0; i < p.root.size; i++)
+            {
+                marginal[sub] += scale * src[i];
+                for (size_t j = 0; j < p.root.nrVars; j++)
+                {
+                    sub += strides[j];
+                    if (++count[j] < cards[j])
+                        break;
+                    sub -= strides[j] * cards[j];
+                    count[j] = 0;
+                }
+            }
+        }
+
+        // next joint state of the remaining variables
+        for (size_t r = 0; r < p.remCards.size(); r++)
+        {
+            base += p.remStrides[r];
+            if (++_state[r] < p.remCards[r])
+                break;
+            base -= p.remStrides[r] * p.remCards[r];
+            _state[r] = 0;
+        }
+    }
+
+    normalize(&marginal[0], marginal.size());
+}
+
+const JTArena::MarginalPlan &JTArena::plan(const dai::VarSet &vs)
+{
+    std::map<dai::VarSet, MarginalPlan>::const_iterator it = _plans.find(vs);
+    if (it != _plans.end())
+        return it->second;
+
+    MarginalPlan p;
+    p.nrStates = 1;
+    for (auto const& v: vs)
+        p.nrStates *= v.states();
+    p.nrRemStates = 1;
+    p.tmpSep = _scratchSep;
+    size_t scratch = _scratchSize;
+
+    // a separator or clique that contains all of vs can simply be marginalized (prefer the smallest one)
+    const Table *smallest = NULL;
+    for (size_t pass = 0; pass < 2; pass++)
+    {
+        const std::vector<Table> &tables = (pass == 0) ? _seps : _cliques;
+        for (auto const& t: tables)
+        {
+            if ((smallest != NULL) && (smallest->size <= t.size))
+                continue;
+            size_t found = 0;
+            for (size_t j = 0; j < t.nrVars; j++)
+                if (vs.contains(_vars[_tableVars[t.varOffset + j]]))
+                    found++;
+            if (found == vs.size())
+                smallest = &t;
+        }
+    }
+
+    if (smallest != NULL)
+    {
+        p.root = *smallest;
+        p.rootProjection = addStrides(p.root, vs);
+    }
+    else
+    {
+        // new root: the clique with the largest state space overlap with vs (as JTree::findEfficientTree)
+        size_t root = 0, maxval = 0;
+        for (size_t alpha = 0; alpha < _cliques.size(); alpha++)
+        {
+            const Table &t = _cliques[alpha];
+            size_t val = 1;
+            for (size_t j = 0; j < t.nrVars; j++)
+                if (vs.contains(_vars[_tableVars[t.varOffset + j]]))
+                    val *= _tableCards[t.varOffset + j];
+            if (val > maxval)
+            {
+                maxval = val;
+                root = alpha;
+            }
+        }
+
+        // re-root the tree at the new root (breadth first)
+        std::vector<std::vector<size_t> > adjacent(_cliques.size());
+        for (size_t i = 0; i < _edges.size(); i++)
+        {
+            adjacent[_edges[i].parent].push_back(i);
+            adjacent[_edges[i].child].push_back(i);
+        }
+        std::vector<size_t> order, parentOf(_cliques.size(), npos), edgeOf(_cliques.size(), npos);
+        std::vector<bool> visited(_cliques.size(), false);
+        std::queue<size_t> todo;
+        todo.push(root);
+        visited[root] = true;
+        while (!todo.empty())
+        {
+            size_t alpha = todo.front();
+            todo.pop();
+            for (auto i: adjacent[alpha])
+            {
+                size_t other = (_edges[i].parent == alpha) ? _edges[i].child : _edges[i].parent;
+                if (visited[other])
+                    continue;
+                visited[other] = true;
+                parentOf[other] = alpha;
+                edgeOf[other] = i;
+                order.push_back(other);
+                todo.push(other);
+            }
+        }
+
+        // the subtree that connects the root with every clique containing a variable of vs outside the root
+        dai::VarSet vsrem;
+        for (auto const& v: vs)
+        {
+            bool inRoot = false;
+            for (size_t j = 0; j < _cliques[root].nrVars; j++)
+                if (_vars[_tableVars[_cliques[root].varOffset + j]] == v)
+                    inRoot = true;
+            if (!inRoot)
+                vsrem.insert(v);
+        }
+        std::vector<bool> inSubtree(_cliques.size(), false);
+        for (auto alpha: order)
+        {
+            const Table &t = _cliques[alpha];
+            bool contains = false;
+            for (size_t j = 0; j < t.nrVars; j++)
+                if (vsrem.contains(_vars[_tableVars[t.varOffset + j]]))
+                    contains = true;
+            for (size_t beta = alpha; contains && (beta != root) && !inSubtree[beta]; beta = parentOf[beta])
+                inSubtree[beta] = true;
+        }
+
+        // scratch copies of the root and all subtree cliques and separators
+        std::vector<size_t> copyOf(_cliques.size(), npos);
+        p.root = _cliques[root];
+        p.root.offset = scratch;
+        copyOf[root] = scratch;
+        p.copySource.push_back(_cliques[root].offset);
+        p.copyTarget.push_back(scratch);
+        p.copySize.push_back(p.root.size);
+        scratch += p.root.size;
+        for (auto alpha: order)
+        {
+            if (!inSubtree[alpha])
+                continue;
+            copyOf[alpha] = scratch;
+            p.copySource.push_back(_cliques[alpha].offset);
+            p.copyTarget.push_back(scratch);
+            p.copySize.push_back(_cliques[alpha].size);
+            scratch += _cliques[alpha].size;
+        }
+
+        for (size_t k = order.size(); (k--) != 0; )
+        {
+            size_t alpha = order[k];
+            if (!inSubtree[alpha])
+                continue;
+            const Edge &edge = _edges[edgeOf[alpha]];
+            PlanEdge e;
+            e.parent = _cliques[parentOf[alpha]];
+            e.parent.offset = copyOf[parentOf[alpha]];
+            e.child = _cliques[alpha];
+            e.child.offset = copyOf[alpha];
+            e.sep = _seps[edge.sep];
+            e.sep.offset = scratch;
+            p.copySource.push_back(_seps[edge.sep].offset);
+            p.copyTarget.push_back(scratch);
+            p.copySize.push_back(e.sep.size);
+            scratch += e.sep.size;
+            e.parentStrides = (edge.parent == parentOf[alpha]) ? edge.parentStrides : edge.childStrides;
+            e.childStrides = (edge.child == alpha) ? edge.childStrides : edge.parentStrides;
+
+            size_t r = 0;
+            for (auto const& v: vsrem)
+            {
+                size_t stride = 1;
+                for (size_t j = 0; j < e.child.nrVars; j++)
+                {
+                    if (_vars[_tableVars[e.child.varOffset + j]] == v)
+                    {
+                        e.clampVar.push_back(r);
+                        e.clampStride.push_back(stride);
+                        e.clampCard.push_back(v.states());
+                    }
+                    stride *= _tableCards[e.child.varOffset + j];
+                }
+                r++;
+            }
+            p.edges.push_back(e);
+        }
+
+        // strides of the remaining variables in the result
+        size_t stride = 1;
+        for (auto const& v: vs)
+        {
+            if (vsrem.contains(v))
+            {
+                p.remCards.push_back(v.states());
+                p.remStrides.push_back(stride);
+                p.nrRemStates *= v.states();
+            }
+            stride *= v.states();
+        }
+        p.rootProjection = addStrides(p.root, vs);
+        if (_state.size() < p.remCards.size())
+            _state.resize(p.remCards.size(), 0);
+    }
+
+    // scratch space is shared between plans, as only one plan is evaluated at a time
+    if (_arena.size() < scratch)
+        _arena.resize(scratch, 0.0);
+
+    return _plans.insert(std::make_pair(vs, p)).first->second;
+}
+
+std::vector<size_t> JTArena::findMaximum()
+{
+    // decode the max-product assignment clique by clique, starting at the root(s) and following the tree
+    std::vector<size_t> maximum(_vars.size(), 0);
+    std::vector<bool> assigned(_vars.size(), false);
+    std::vector<size_t> order(_roots);
+    for (auto const& e: _edges)
+        order.push_back(e.child);
+
+    for (auto alpha: order)
+    {
+        const Table &t = _cliques[alpha];
+        const dai::Real *src = &_arena[t.offset];
+        const size_t *vars = &_tableVars[t.varOffset];
+        const size_t *cards = &_tableCards[t.varOffset];
+        dai::Real maxProb = -1.0;
+        size_t maxEntry = 0;
+        size_t *count = counters();
+
+        std::fill(count, count + t.nrVars, 0);
+        for (size_t i = 0; i < t.size; i++)
+        {
+            bool allowed = true;
+            for (size_t j = 0; j < t.nrVars; j++)
+            {
+                if (assigned[vars[j]] && (maximum[vars[j]] != count[j]))
+                {
+                    allowed = false;
+                    break;
+                }
+            }
+            if (allowed && (src[i] > maxProb))
+            {
+                maxProb = src[i];
+                maxEntry = i;
+            }
+            for (size_t j = 0; j < t.nrVars; j++)
+            {
+                if (++count[j] < cards[j])
+                    break;
+                count[j] = 0;
+            }
+        }
+        if (maxProb <= 0.0)
+            DAI_THROWE(RUNTIME_ERROR, "Failed to decode the MAP state");
+
+        for (size_t j = 0; j < t.nrVars; j++)
+        {
+            if (!assigned[vars[j]])
+            {
+                assigned[vars[j]] = true;
+                maximum[vars[j]] = maxEntry % cards[j];
+            }
+            maxEntry /= cards[j];
+        }
+    }
+    return maximum;
+}
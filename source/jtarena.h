@@ -0,0 +1,164 @@
+#ifndef JTARENAHEADER
+#define JTARENAHEADER
+
+// STL includes
+#include <vector>
+#include <map>
+#include <string>
+#include <atomic>
+#include <memory>
+#include "dai/factorgraph.h"
+#include "dai/jtree.h"
+#include "dai/varset.h"
+#include "dai/enum.h"
+#include "dai/properties.h"
+#include "threadpool.h"
+#include "engine.h"
+
+// Junction tree whose clique and separator tables all live in one contiguous arena.
+// The tree structure is taken once from libDAI's JTree; after that, evidence is entered by
+// zeroing table entries instead of clamping (and copying) factors, and HUGIN propagation
+// reuses the same storage, so repeated propagations on one network do not touch the heap.
+// With threads > 1 the collect and distribute passes run as a task graph on the shared thread
+// pool (sibling subtrees in parallel) and tables of at least 'grain' entries are split over workers.
+class JTArena : public InferenceEngine
+{
+    public:
+        struct Properties
+        {
+            DAI_ENUM(InfType,SUMPROD,MAXPROD);
+            InfType inference;      // sum-product (marginals, MAP) or max-product (MPE)
+            size_t maxmem;          // passed on to libDAI's JTree (0 = unlimited)
+            size_t threads;         // 1 = sequential propagation, more = task-parallel propagation
+            size_t grain;           // smallest table that is split over several threads
+        } props;
+
+        JTArena(const dai::FactorGraph &fg, const dai::PropertySet &opts);
+
+        std::string name() const { return "JTREE"; }
+
+        // enter the evidence and propagate over the whole tree (collect + distribute)
+        void run(const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues);
+
+        // queries on the calibrated tree (call run() first)
+        dai::Factor belief(const dai::Var &v);
+        dai::Factor calcMarginal(const dai::VarSet &vs);
+        void calcMarginal(const dai::VarSet &vs, std::vector<dai::Real> &marginal);
+        std::vector<size_t> findMaximum();
+
+        // replace the factor values; factors must have the variables (and order) of the factor graph
+        // the tree was built from. Takes effect at the next run()
+        void load(const std::vector<dai::Factor> &factors);
+
+        // the calibrated tables of the last run(), so a propagation can be kept and restored later
+        void saveTables(std::vector<dai::Real> &tables) const;
+        void restoreTables(const std::vector<dai::Real> &tables);
+        size_t tablesSize() const { return _scratchSep - _cliqueTotal + 1; }
+
+        const dai::Var &var(size_t i) const { return _vars[i]; }
+        size_t nrVars() const { return _vars.size(); }
+        size_t nrCliques() const { return _cliques.size(); }
+        size_t arenaSize() const { return _arena.size(); }
+        dai::Real logZ() const { return _logZ; }
+
+    private:
+        // a table stored in the arena; variables are kept in libDAI order (first variable changes fastest)
+        struct Table
+        {
+            size_t offset;          // first entry in _arena
+            size_t size;            // number of entries
+            size_t varOffset;       // first entry in _tableVars and _tableCards
+            size_t nrVars;
+        };
+
+        // a tree edge between two cliques; the strides project both cliques onto the separator
+        struct Edge
+        {
+            size_t parent, child, sep;
+            size_t parentStrides;   // offset into _strides (one stride per variable of the parent clique)
+            size_t childStrides;
+        };
+
+        // an edge of the subtree used for a marginal over variables that are not in a single clique
+        struct PlanEdge
+        {
+            Table parent, child, sep;                   // scratch copies
+            size_t parentStrides, childStrides;
+            std::vector<size_t> clampVar;               // position in vsrem of each variable clamped in the child
+            std::vector<size_t> clampStride;
+            std::vector<size_t> clampCard;
+        };
+
+        // schedule and scratch layout for calcMarginal(vs), built on first use
+        struct MarginalPlan
+        {
+            Table root;                                 // (copy of) the clique or separator that is marginalized
+            size_t rootProjection;                      // offset into _strides: root variables onto vs
+            std::vector<size_t> copySource;             // calibrated tables copied to scratch per state of vsrem
+            std::vector<size_t> copyTarget;
+            std::vector<size_t> copySize;
+            std::vector<PlanEdge> edges;                // collect order (leaves first)
+            std::vector<size_t> remCards;               // variables of vs outside the root (vsrem)
+            std::vector<size_t> remStrides;             // and their strides in vs
+            size_t tmpSep;
+            size_t nrStates;
+            size_t nrRemStates;
+        };
+
+        size_t addStrides(const Table &from, const Table &onto);
+        size_t addStrides(const Table &from, const dai::VarSet &onto);
+        size_t *counters();
+        size_t start(const Table &t, const size_t *strides, size_t index, size_t *counters) const;
+        void projectRange(const Table &from, const size_t *strides, dai::Real *to, size_t begin, size_t end, bool maximize);
+        void project(const Table &from, const size_t *strides, dai::Real *to, size_t toSize, bool maximize, size_t partial);
+        void absorbRange(const Table &into, const size_t *strides, const dai::Real *ratio, size_t begin, size_t end);
+        void absorb(const Table &into, const size_t *strides, const dai::Real *newSep, dai::Real *oldSep, size_t sepSize, bool split);
+        void runParallel(bool maximize);
+        void collect(size_t alpha, bool maximize, ThreadPool::Group &group);
+        void distribute(size_t e, bool maximize, ThreadPool::Group &group);
+        void clamp(const Table &t, size_t stride, size_t card, size_t state);
+        dai::Real normalize(dai::Real *table, size_t size);
+        const MarginalPlan &plan(const dai::VarSet &vs);
+
+        std::vector<dai::Var> _vars;
+        std::map<size_t, size_t> _label2index;
+
+        std::vector<dai::Real> _arena;          // base cliques | working cliques | separators | scratch
+        std::vector<Table> _base;               // cliques with all factors multiplied in (no evidence)
+        std::vector<Table> _cliques;            // working (calibrated) cliques
+        std::vector<Table> _seps;               // separators, separator i belongs to edge i
+        std::vector<Edge> _edges;               // in the order of libDAI's RTree
+        std::vector<size_t> _roots;             // cliques that are not the child of any edge
+        size_t _cliqueTotal;                    // number of entries of all clique tables together
+        size_t _scratchSep;                     // separator-sized scratch table used during propagation
+        size_t _scratchSize;                    // start of the scratch space used by marginal plans
+
+        std::vector<size_t> _tableVars;         // variable indices per table
+        std::vector<size_t> _tableCards;        // cardinalities per table
+        std::vector<size_t> _strides;           // projection strides
+
+        std::vector<size_t> _home;              // per variable: smallest clique containing it
+        std::vector<size_t> _homeStride;        // stride of the variable in its home clique
+        std::vector<size_t> _homeProjection;    // offset into _strides: home clique onto the variable
+
+        std::vector<size_t> _factorClique;      // per factor: clique it is multiplied into
+        std::vector<size_t> _factorStrides;     // offset into _strides: that clique onto the factor
+
+        std::map<dai::VarSet, MarginalPlan> _plans;
+        std::vector<size_t> _counters;          // odometers used while walking tables, one per worker
+        size_t _maxWidth;                       // largest number of variables in a clique
+        std::vector<size_t> _state;             // joint state of vsrem while evaluating a plan
+        dai::Real _logZ;
+
+        // task-parallel propagation (only set up when threads > 1)
+        ThreadPool *_pool;
+        std::vector<std::vector<size_t> > _children;    // per clique: edges to its children
+        std::vector<size_t> _parentEdge;                // per clique: edge to its parent
+        std::unique_ptr<std::atomic<size_t>[]> _pending; // per clique: children that still have to send
+        std::vector<size_t> _msgs;                      // per edge: message table in the arena
+        std::vector<size_t> _partials;                  // per edge: partial tables for split projections
+        std::vector<dai::Real> _sepZ;                   // per edge: normalization of the upward message
+        std::vector<dai::Real> _rootZ;                  // per root: normalization of the root clique
+};
+
+#endif // defined JTARENAHEADER
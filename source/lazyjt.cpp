@@ -0,0 +1,340 @@
+/************************************************************************/
+/* Lazy propagation junction tree             					        */
+/* Version:			1.0													*/
+/* Last changed:	18-10-2026                                         	*/
+/*                                                                     	*/
+/* Version History:                                                    	*/
+/*                                                                     	*/
+/* Version Comments:                                                   	*/
+/* - the junction tree is built by libDAI, but its clique tables are    */
+/*   never used: cliques keep their factors as a list and messages are  */
+/*   lists of factors as well (Madsen & Jensen, 1999).                  */
+/* - a marginal over variables that span several cliques keeps those    */
+/*   variables in the messages towards the clique with the largest      */
+/*   overlap, so no per-state recomputation is needed.                  */
+/************************************************************************/
+
+// headers
+#include <algorithm>
+#include <queue>
+#include <cmath>
+#include <limits>
+#include "lazyjt.h"
+
+static const size_t npos = (size_t) -1;
+
+LazyJTree::LazyJTree(const dai::FactorGraph &fg, const dai::PropertySet &opts) : props()
+{
+    props.inference = Properties::InfType::SUMPROD;
+    if (opts.hasKey("inference"))
+        props.inference = opts.getStringAs<Properties::InfType>("inference");
+    props.maxmem = 0;
+    if (opts.hasKey("maxmem"))
+        props.maxmem = opts.getStringAs<size_t>("maxmem");
+
+    _vars = fg.vars();
+    for (size_t i = 0; i < _vars.size(); i++)
+        _label2index[_vars[i].label()] = i;
+    for (size_t I = 0; I < fg.nrFactors(); I++)
+        _factors.push_back(std::make_shared<const dai::Factor>(fg.factor(I)));
+
+    // let libDAI triangulate the network; we keep the cliques, the tree and the factor assignment
+    dai::PropertySet jtOpts;
+    jtOpts.set("updates", std::string("HUGIN"));
+    jtOpts.set("inference", std::string("SUMPROD"));
+    if (props.maxmem > 0)
+        jtOpts.set("maxmem", props.maxmem);
+    dai::JTree jt(fg, jtOpts);
+
+    for (size_t alpha = 0; alpha < jt.nrORs(); alpha++)
+        _cliques.push_back(jt.OR(alpha).vars());
+    _assigned.resize(_cliques.size());
+    for (size_t I = 0; I < fg.nrFactors(); I++)
+        _assigned[jt.fac2OR(I)].push_back(I);
+
+    _nbs.resize(_cliques.size());
+    std::vector<bool> isChild(_cliques.size(), false);
+    for (auto const& e: jt.RTree)
+    {
+        _nbs[e.first].push_back(e.second);
+        _nbs[e.second].push_back(e.first);
+        isChild[e.second] = true;
+    }
+    for (size_t alpha = 0; alpha < _cliques.size(); alpha++)
+        if (!isChild[alpha])
+            _roots.push_back(alpha);
+
+    _evidence.assign(_vars.size(), npos);
+    _reduced.resize(_cliques.size());
+    _reducedValid.assign(_cliques.size(), false);
+}
+
+void LazyJTree::run(const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues)
+{
+    std::fill(_evidence.begin(), _evidence.end(), npos);
+    for (size_t k = 0; k < evidenceVars.size(); k++)
+        _evidence[evidenceVars[k]] = evidenceValues[k];
+
+    std::fill(_reducedValid.begin(), _reducedValid.end(), false);
+    _messages.clear();
+}
+
+const LazyJTree::Potentials &LazyJTree::potentials(size_t alpha)
+{
+    // the factors assigned to alpha, sliced on the observed variables they contain
+    if (!_reducedValid[alpha])
+    {
+        Potentials &pots = _reduced[alpha];
+        pots.clear();
+        for (auto I: _assigned[alpha])
+        {
+            const Potential &f = _factors[I];
+            dai::VarSet observed;
+            std::map<dai::Var, size_t> state;
+            for (auto const& v: f->vars())
+            {
+                size_t i = _label2index[v.label()];
+                if (_evidence[i] != npos)
+                {
+                    observed.insert(v);
+                    state[v] = _evidence[i];
+                }
+            }
+            if (observed.empty())
+            {
+                pots.push_back(f);
+                continue;
+            }
+            dai::Factor sliced = f->slice(observed, dai::calcLinearState(observed, state));
+            // a constant only matters when it rules the evidence out
+            if (!sliced.vars().empty() || (sliced[0] == 0.0))
+                pots.push_back(std::make_shared<const dai::Factor>(sliced));
+        }
+        _reducedValid[alpha] = true;
+    }
+    return _reduced[alpha];
+}
+
+void LazyJTree::eliminate(Potentials &pots, const dai::VarSet &keep, bool maximize, std::vector<Step> *trace) const
+{
+    while (true)
+    {
+        dai::VarSet all;
+        for (auto const& p: pots)
+            all |= p->vars();
+        dai::VarSet elim = all / keep;
+        if (elim.empty())
+            return;
+
+        // eliminate the variable whose factors have the smallest product first
+        dai::Var best;
+        double bestSize = std::numeric_limits<double>::infinity();
+        for (auto const& v: elim)
+        {
+            dai::VarSet domain;
+            for (auto const& p: pots)
+                if (p->vars().contains(v))
+                    domain |= p->vars();
+            double size = 1.0;
+            for (auto const& u: domain)
+                size *= u.states();
+            if (size < bestSize)
+            {
+                bestSize = size;
+                best = v;
+            }
+        }
+
+        Potentials with, without;
+        for (auto const& p: pots)
+            (p->vars().contains(best) ? with : without).push_back(p);
+
+        dai::Factor product = *with[0];
+        for (size_t k = 1; k < with.size(); k++)
+            product *= *with[k];
+        dai::Factor message = maximize ? product.maxMarginal(product.vars() / best, false) : product.marginal(product.vars() / best, false);
+
+        pots.swap(without);
+        if (trace != NULL)
+            trace->push_back(Step{best, product});
+        else if (with.size() == 1)
+        {
+            // best is barren in this factor (e.g. a leaf of the network): summing it out leaves ones
+            bool barren = !maximize;
+            for (size_t x = 0; barren && (x < message.nrStates()); x++)
+                barren = (std::fabs(message[x] - 1.0) < 1e-9);
+            if (barren)
+                continue;
+        }
+        if (!message.vars().empty() || (message[0] == 0.0))
+            pots.push_back(std::make_shared<const dai::Factor>(message));
+    }
+}
+
+void LazyJTree::collect(size_t root, const dai::VarSet &vs, bool maximize, Potentials &result, std::vector<Step> *trace)
+{
+    // order the component of root breadth first
+    std::vector<size_t> order(1, root);
+    std::vector<size_t> parent(_cliques.size(), npos);
+    std::vector<bool> seen(_cliques.size(), false);
+    seen[root] = true;
+    for (size_t k = 0; k < order.size(); k++)
+        for (auto nb: _nbs[order[k]])
+            if (!seen[nb])
+            {
+                seen[nb] = true;
+                parent[nb] = order[k];
+                order.push_back(nb);
+            }
+
+    // cliques whose subtree contains variables of vs outside the root pass those variables on
+    dai::VarSet vsrem = vs / _cliques[root];
+    std::vector<bool> keeps(_cliques.size(), false);
+    for (size_t k = order.size(); (k--) > 1; )
+    {
+        size_t alpha = order[k];
+        if (_cliques[alpha].intersects(vsrem))
+            keeps[alpha] = true;
+        if (keeps[alpha])
+            keeps[parent[alpha]] = true;
+    }
+
+    // only messages that carry nothing but the separator are shared between queries
+    std::vector<Potentials> sent(_cliques.size());
+    auto incoming = [&](size_t from, size_t to) -> const Potentials &
+    {
+        if (keeps[from] || (trace != NULL))
+            return sent[from];
+        return _messages[std::make_pair(from, to)];
+    };
+
+    for (size_t k = order.size(); (k--) > 0; )
+    {
+        size_t alpha = order[k];
+        size_t to = parent[alpha];
+        bool shared = (to != npos) && !keeps[alpha] && (trace == NULL);
+        if (shared && (_messages.count(std::make_pair(alpha, to)) > 0))
+            continue;
+
+        Potentials pots = potentials(alpha);
+        for (auto nb: _nbs[alpha])
+            if (nb != to)
+            {
+                const Potentials &msg = incoming(nb, alpha);
+                pots.insert(pots.end(), msg.begin(), msg.end());
+            }
+
+        if (to == npos)
+        {
+            eliminate(pots, vs, maximize, trace);
+            result.swap(pots);
+        }
+        else
+        {
+            dai::VarSet keep = _cliques[alpha] & _cliques[to];
+            if (keeps[alpha])
+                keep |= vs;
+            eliminate(pots, keep, maximize, trace);
+            if (shared)
+                _messages[std::make_pair(alpha, to)].swap(pots);
+            else
+                sent[alpha].swap(pots);
+        }
+    }
+}
+
+dai::Factor LazyJTree::belief(const dai::Var &v)
+{
+    return calcMarginal(dai::VarSet(v));
+}
+
+dai::Factor LazyJTree::calcMarginal(const dai::VarSet &vs)
+{
+    bool maximize = (props.inference == Properties::InfType::MAXPROD);
+
+    // collect towards the smallest clique with the largest overlap with vs
+    size_t root = 0;
+    size_t overlap = 0;
+    for (size_t alpha = 0; alpha < _cliques.size(); alpha++)
+    {
+        size_t o = (_cliques[alpha] & vs).size();
+        if ((o > overlap) || ((o == overlap) && (_cliques[alpha].size() < _cliques[root].size())))
+        {
+            root = alpha;
+            overlap = o;
+        }
+    }
+
+    Potentials pots;
+    collect(root, vs, maximize, pots, NULL);
+
+    dai::Factor result(vs, 1.0);
+    for (auto const& p: pots)
+        result *= *p;
+
+    // observed variables of vs were sliced away: their mass goes to the observed state
+    for (auto const& v: vs)
+    {
+        size_t i = _label2index[v.label()];
+        if (_evidence[i] == npos)
+            continue;
+        dai::Factor point(v, 0.0);
+        point.set(_evidence[i], 1.0);
+        result *= point;
+    }
+
+    if (result.sum() > 0.0)
+        result.normalize();
+    return result;
+}
+
+void LazyJTree::calcMarginal(const dai::VarSet &vs, std::vector<dai::Real> &marginal)
+{
+    dai::Factor result = calcMarginal(vs);
+    marginal.assign(result.p().begin(), result.p().end());
+}
+
+std::vector<size_t> LazyJTree::findMaximum()
+{
+    // max-out every variable, remembering what it was maximized out of, and decode in reverse order:
+    // when a variable is decoded, all other variables of its table have been decoded already
+    std::vector<size_t> maximum(_vars.size(), 0);
+    for (size_t i = 0; i < _vars.size(); i++)
+        if (_evidence[i] != npos)
+            maximum[i] = _evidence[i];
+
+    std::vector<Step> trace;
+    for (auto root: _roots)
+    {
+        Potentials pots;
+        collect(root, dai::VarSet(), true, pots, &trace);
+        for (auto const& p: pots)
+            if ((*p)[0] == 0.0)
+                DAI_THROWE(RUNTIME_ERROR, "Failed to decode the MAP state");
+    }
+
+    for (size_t k = trace.size(); (k--) != 0; )
+    {
+        const Step &s = trace[k];
+        std::map<dai::Var, size_t> state;
+        for (auto const& v: s.table.vars())
+            state[v] = maximum[_label2index[v.label()]];
+
+        dai::Real maxProb = -1.0;
+        size_t maxState = 0;
+        for (size_t x = 0; x < s.var.states(); x++)
+        {
+            state[s.var] = x;
+            dai::Real p = s.table[dai::calcLinearState(s.table.vars(), state)];
+            if (p > maxProb)
+            {
+                maxProb = p;
+                maxState = x;
+            }
+        }
+        if (maxProb <= 0.0)
+            DAI_THROWE(RUNTIME_ERROR, "Failed to decode the MAP state");
+        maximum[_label2index[s.var.label()]] = maxState;
+    }
+    return maximum;
+}
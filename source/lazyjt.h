@@ -0,0 +1,78 @@
+#ifndef LAZYJTHEADER
+#define LAZYJTHEADER
+
+// STL includes
+#include <vector>
+#include <map>
+#include <string>
+#include <memory>
+#include "dai/factorgraph.h"
+#include "dai/jtree.h"
+#include "dai/varset.h"
+#include "dai/enum.h"
+#include "dai/properties.h"
+#include "engine.h"
+
+// Lazy propagation (Madsen & Jensen) on libDAI's junction tree. A clique keeps the list of factors
+// assigned to it instead of their product, and a message is a list of factors as well: it is
+// computed, by eliminating the variables outside the separator one at a time, only when a query
+// needs it and is then cached until the next run(). Evidence is entered by slicing the factors that
+// mention an observed variable, and a factor that sums to one over a variable it alone contains
+// (a barren variable, e.g. an unobserved leaf) is dropped without being multiplied in.
+class LazyJTree : public InferenceEngine
+{
+    public:
+        struct Properties
+        {
+            DAI_ENUM(InfType,SUMPROD,MAXPROD);
+            InfType inference;      // sum-product (marginals, MAP) or max-product (MPE)
+            size_t maxmem;          // passed on to libDAI's JTree (0 = unlimited)
+        } props;
+
+        LazyJTree(const dai::FactorGraph &fg, const dai::PropertySet &opts);
+
+        std::string name() const { return "LAZY"; }
+
+        // only records the evidence; messages are computed when a query needs them
+        void run(const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues);
+
+        dai::Factor belief(const dai::Var &v);
+        dai::Factor calcMarginal(const dai::VarSet &vs);
+        void calcMarginal(const dai::VarSet &vs, std::vector<dai::Real> &marginal);
+        std::vector<size_t> findMaximum();
+
+        const dai::Var &var(size_t i) const { return _vars[i]; }
+        size_t nrVars() const { return _vars.size(); }
+        size_t nrCliques() const { return _cliques.size(); }
+
+    private:
+        typedef std::shared_ptr<const dai::Factor> Potential;
+        typedef std::vector<Potential> Potentials;
+
+        // a variable eliminated by maximization and the product it was maximized out of (for decoding)
+        struct Step
+        {
+            dai::Var var;
+            dai::Factor table;
+        };
+
+        const Potentials &potentials(size_t alpha);
+        void collect(size_t root, const dai::VarSet &vs, bool maximize, Potentials &result, std::vector<Step> *trace);
+        void eliminate(Potentials &pots, const dai::VarSet &keep, bool maximize, std::vector<Step> *trace) const;
+
+        std::vector<dai::Var> _vars;
+        std::map<size_t, size_t> _label2index;
+
+        std::vector<Potential> _factors;                // the factors of the network
+        std::vector<dai::VarSet> _cliques;
+        std::vector<std::vector<size_t> > _assigned;    // per clique: factors assigned to it
+        std::vector<std::vector<size_t> > _nbs;         // per clique: neighbouring cliques
+        std::vector<size_t> _roots;                     // one clique per connected component
+
+        std::vector<size_t> _evidence;                  // per variable: observed state (or npos)
+        std::vector<Potentials> _reduced;               // per clique: assigned factors with evidence entered
+        std::vector<bool> _reducedValid;
+        std::map<std::pair<size_t, size_t>, Potentials> _messages;     // (from, to) -> message
+};
+
+#endif // defined LAZYJTHEADER
@@ -13,13 +13,15 @@
 
 // headers
 #include "mfesim.h"
+#include "metrics.h"
 #include "combinations.hpp"		// Howard Hinnant's combinations template
 #include <chrono>
 
 bool weak_map_indep(dai::FactorGraph fg, std::vector<unsigned int> evidenceVars, std::vector<unsigned int> evidenceValues, 
     std::vector<unsigned int> hypothesisVars, std::vector<unsigned int> hypothesisValues, std::vector<unsigned int> independenceTestVars, unsigned long int cutoffTime)
 {
-    if (weak_map_indep_measure(fg, evidenceVars, evidenceValues, hypothesisVars, hypothesisValues, independenceTestVars, cutoffTime, true) == 1.0)
+    std::unique_ptr<InferenceEngine> jt(newEngine(fg, engineOptions("inference",std::string("SUMPROD"))));
+    if (weak_map_indep_measure(*jt, evidenceVars, evidenceValues, hypothesisVars, hypothesisValues, independenceTestVars, cutoffTime, true) == 1.0)
         return true;
     else
         return false;        
@@ -29,6 +31,15 @@ double weak_map_indep_measure(dai::FactorGraph fg, std::vector<unsigned int> evi
     std::vector<unsigned int> hypothesisVars, std::vector<unsigned int> hypothesisValues, std::vector<unsigned int> independenceTestVars, 
     unsigned long int cutoffTime, bool decision)
 {
+    std::unique_ptr<InferenceEngine> jt(newEngine(fg, engineOptions("inference",std::string("SUMPROD"))));
+    return weak_map_indep_measure(*jt, evidenceVars, evidenceValues, hypothesisVars, hypothesisValues, independenceTestVars, cutoffTime, decision);
+}
+
+double weak_map_indep_measure(InferenceEngine &jt, const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues, 
+    const std::vector<unsigned int> &hypothesisVars, const std::vector<unsigned int> &hypothesisValues, const std::vector<unsigned int> &independenceTestVars, 
+    unsigned long int cutoffTime, bool decision)
+{
+    METRIC_SPAN("INDEP.weak", "tests=" + std::to_string(independenceTestVars.size()));
     int count = 0, different = 0;
     std::vector<unsigned long int> map;
     for (const unsigned int &e: hypothesisValues) { map.push_back((unsigned int) e); }
@@ -37,7 +48,7 @@ double weak_map_indep_measure(dai::FactorGraph fg, std::vector<unsigned int> evi
     for (auto varR = independenceTestVars.begin(); varR != independenceTestVars.end(); ++varR)
 	{
         // for each value r of R
-        for (unsigned int state = 0; state < fg.var(*varR).states(); state++)
+        for (unsigned int state = 0; state < jt.var(*varR).states(); state++)
         {
             // local copy of evidence nodes
             std::vector<unsigned int> mapTestVars(evidenceVars);
@@ -46,7 +57,7 @@ double weak_map_indep_measure(dai::FactorGraph fg, std::vector<unsigned int> evi
             std::vector<unsigned int> mapTestValues(evidenceValues);
             mapTestValues.push_back(state);
             // get the map
-            std::vector<unsigned long int> best = get_map(fg, hypothesisVars, mapTestVars, mapTestValues, false);
+            std::vector<unsigned long int> best = get_map(jt, hypothesisVars, mapTestVars, mapTestValues, false);
             if (best == map)
             {
                 DEBUG(std::cout << "Same for R = " << *varR << " and r = " << state << std::endl;)
@@ -66,6 +77,13 @@ double weak_map_indep_measure(dai::FactorGraph fg, std::vector<unsigned int> evi
 
 std::vector<unsigned long int> max_weak_map_indep(dai::FactorGraph fg, std::vector<unsigned int> evidenceVars, std::vector<unsigned int> evidenceValues, 
     std::vector<unsigned int> hypothesisVars, std::vector<unsigned int> hypothesisValues, std::vector<unsigned int> independenceTestVars, unsigned long int cutoffTime)
+{
+    std::unique_ptr<InferenceEngine> jt(newEngine(fg, engineOptions("inference",std::string("SUMPROD"))));
+    return max_weak_map_indep(*jt, evidenceVars, evidenceValues, hypothesisVars, hypothesisValues, independenceTestVars, cutoffTime);
+}
+
+std::vector<unsigned long int> max_weak_map_indep(InferenceEngine &jt, const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues, 
+    const std::vector<unsigned int> &hypothesisVars, const std::vector<unsigned int> &hypothesisValues, const std::vector<unsigned int> &independenceTestVars, unsigned long int cutoffTime)
 {
 	// we simply test for each of the variables in independenceTestVars whether they are
 	// weakly map independent and if so, we add them to the set 'weak'
@@ -75,7 +93,7 @@ std::vector<unsigned long int> max_weak_map_indep(dai::FactorGraph fg, std::vect
 	for (auto varR = independenceTestVars.begin(); varR != independenceTestVars.end(); ++varR)
 	{
 		std::vector<unsigned int> varVec(1, *varR);
-		if (weak_map_indep(fg, evidenceVars, evidenceValues, hypothesisVars, hypothesisValues, varVec, cutoffTime))
+		if (weak_map_indep_measure(jt, evidenceVars, evidenceValues, hypothesisVars, hypothesisValues, varVec, cutoffTime, true) == 1.0)
 			weak.push_back(*varR);
 	}
     return weak;
@@ -84,7 +102,8 @@ std::vector<unsigned long int> max_weak_map_indep(dai::FactorGraph fg, std::vect
 bool strong_map_indep(dai::FactorGraph fg, std::vector<unsigned int> evidenceVars, std::vector<unsigned int> evidenceValues, 
     std::vector<unsigned int> hypothesisVars, std::vector<unsigned int> hypothesisValues, std::vector<unsigned int> independenceTestVars, unsigned long int cutoffTime)
 {
-    if (strong_map_indep_measure(fg, evidenceVars, evidenceValues, hypothesisVars, hypothesisValues, independenceTestVars, cutoffTime, true) == 1.0)
+    std::unique_ptr<InferenceEngine> jt(newEngine(fg, engineOptions("inference",std::string("SUMPROD"))));
+    if (strong_map_indep_measure(*jt, evidenceVars, evidenceValues, hypothesisVars, hypothesisValues, independenceTestVars, cutoffTime, true) == 1.0)
         return true;
     else
         return false;        
@@ -94,6 +113,15 @@ double strong_map_indep_measure(dai::FactorGraph fg, std::vector<unsigned int> e
     std::vector<unsigned int> hypothesisVars, std::vector<unsigned int> hypothesisValues, std::vector<unsigned int> independenceTestVars, 
     unsigned long int cutoffTime, bool decision)
 {
+    std::unique_ptr<InferenceEngine> jt(newEngine(fg, engineOptions("inference",std::string("SUMPROD"))));
+    return strong_map_indep_measure(*jt, evidenceVars, evidenceValues, hypothesisVars, hypothesisValues, independenceTestVars, cutoffTime, decision);
+}
+
+double strong_map_indep_measure(InferenceEngine &jt, const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues, 
+    const std::vector<unsigned int> &hypothesisVars, const std::vector<unsigned int> &hypothesisValues, const std::vector<unsigned int> &independenceTestVars, 
+    unsigned long int cutoffTime, bool decision)
+{
+    METRIC_SPAN("INDEP.strong", "tests=" + std::to_string(independenceTestVars.size()));
     int count = 0, different = 0, nr_vars = 0;
     unsigned long int iteration = 0, max_iterations = 1;
 
@@ -115,7 +143,7 @@ double strong_map_indep_measure(dai::FactorGraph fg, std::vector<unsigned int> e
     {
         mapTestVars.push_back(inter);
 
-        unsigned int st = fg.var(inter).states();
+        unsigned int st = jt.var(inter).states();
          
         independenceValues.push_back(0);
         independenceMaxValues.push_back(st - 1);
@@ -138,7 +166,7 @@ double strong_map_indep_measure(dai::FactorGraph fg, std::vector<unsigned int> e
         DEBUG(std::cout << "Testing " << mapTestVars << " with value " << mapTestValues << std::endl;)
 
         // find MAP for this value
-        best = get_map(fg, hypothesisVars, mapTestVars, mapTestValues, false);
+        best = get_map(jt, hypothesisVars, mapTestVars, mapTestValues, false);
 
         if (best == map)
         {
@@ -162,6 +190,13 @@ double strong_map_indep_measure(dai::FactorGraph fg, std::vector<unsigned int> e
 
 std::vector<unsigned long int> max_strong_map_indep(dai::FactorGraph fg, std::vector<unsigned int> evidenceVars, std::vector<unsigned int> evidenceValues, 
     std::vector<unsigned int> hypothesisVars, std::vector<unsigned int> hypothesisValues, std::vector<unsigned int> independenceTestVars, unsigned long int cutoffTime)
+{
+    std::unique_ptr<InferenceEngine> jt(newEngine(fg, engineOptions("inference",std::string("SUMPROD"))));
+    return max_strong_map_indep(*jt, evidenceVars, evidenceValues, hypothesisVars, hypothesisValues, independenceTestVars, cutoffTime);
+}
+
+std::vector<unsigned long int> max_strong_map_indep(InferenceEngine &jt, const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues, 
+    const std::vector<unsigned int> &hypothesisVars, const std::vector<unsigned int> &hypothesisValues, std::vector<unsigned int> independenceTestVars, unsigned long int cutoffTime)
 {
 	// This is a very time-consuming algorithm: we iterate over all subsets of independenceTestVars,
 	// run strong_map_indep over this subset, and if it answers 'yes' we keep track of the largest size
@@ -180,8 +215,8 @@ std::vector<unsigned long int> max_strong_map_indep(dai::FactorGraph fg, std::ve
 			std::vector<unsigned int> testVars (first, last);
 			DEBUG(std::cout << "Testing set " << testVars << std::endl;)
 
-			if (strong_map_indep(fg, evidenceVars, evidenceValues, hypothesisVars, hypothesisValues,
-				testVars, cutoffTime))
+			if (strong_map_indep_measure(jt, evidenceVars, evidenceValues, hypothesisVars, hypothesisValues,
+				testVars, cutoffTime, true) == 1.0)
 			{
 				DEBUG(std::cout << "This is now the largest set of size " << k << std::endl;)
     
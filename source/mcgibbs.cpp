@@ -0,0 +1,370 @@
+/************************************************************************/
+/* Multi-chain Gibbs sampling                 					        */
+/* Version:			1.0													*/
+/* Last changed:	18-10-2026                                         	*/
+/*                                                                     	*/
+/* Version History:                                                    	*/
+/*                                                                     	*/
+/* Version Comments:                                                   	*/
+/* - chains keep their state between runs: a new run only enters the   */
+/*   evidence and burns in from where the previous run stopped.         */
+/* - the score of a state is kept as the number of zero factors and the */
+/*   log of the others, as -ffast-math gives no reliable log(0).        */
+/************************************************************************/
+
+// headers
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include "mcgibbs.h"
+#include "rng.h"
+
+static const size_t npos = (size_t) -1;
+
+MultiChainGibbs::MultiChainGibbs(const dai::FactorGraph &fg, const dai::PropertySet &opts) : props(), _sweeps(0), _next(0), _rhat(0.0)
+{
+    props.inference = Properties::InfType::SUMPROD;
+    if (opts.hasKey("inference"))
+        props.inference = opts.getStringAs<Properties::InfType>("inference");
+    props.threads = 1;
+    if (opts.hasKey("threads"))
+        props.threads = opts.getStringAs<size_t>("threads");
+    props.chains = 0;
+    if (opts.hasKey("chains"))
+        props.chains = opts.getStringAs<size_t>("chains");
+    props.burnin = 1000;
+    if (opts.hasKey("burnin"))
+        props.burnin = opts.getStringAs<size_t>("burnin");
+    props.samples = 10000;
+    if (opts.hasKey("samples"))
+        props.samples = opts.getStringAs<size_t>("samples");
+    props.block = 500;
+    if (opts.hasKey("block"))
+        props.block = opts.getStringAs<size_t>("block");
+    props.rhat = 1.01;
+    if (opts.hasKey("rhat"))
+        props.rhat = opts.getStringAs<dai::Real>("rhat");
+    props.maxtime = 0.0;
+    if (opts.hasKey("maxtime"))
+        props.maxtime = opts.getStringAs<dai::Real>("maxtime");
+    props.seed = 0;
+    if (opts.hasKey("seed"))
+        props.seed = opts.getStringAs<size_t>("seed");
+    if (props.chains == 0)
+        props.chains = std::max((size_t) 4, props.threads);
+    props.block = std::max((size_t) 1, props.block);
+    _pool = (props.threads > 1) ? &ThreadPool::shared(props.threads) : NULL;
+
+    _vars = fg.vars();
+    for (size_t i = 0; i < _vars.size(); i++)
+    {
+        _label2index[_vars[i].label()] = i;
+        _stateOffset.push_back((i == 0) ? 0 : _stateOffset[i - 1] + _vars[i - 1].states());
+    }
+
+    // factor tables in one array, and per variable the factors of its Markov blanket with its stride in them
+    std::vector<std::vector<std::pair<size_t, size_t> > > blanket(_vars.size());
+    for (size_t I = 0; I < fg.nrFactors(); I++)
+    {
+        const dai::Factor &f = fg.factor(I);
+        _factorVars.push_back(f.vars());
+        _tableOffset.push_back(_tables.size());
+        _tables.insert(_tables.end(), f.p().begin(), f.p().end());
+        size_t stride = 1;
+        for (auto const& v: f.vars())
+        {
+            blanket[_label2index[v.label()]].push_back(std::make_pair(I, stride));
+            stride *= v.states();
+        }
+    }
+    for (size_t i = 0; i < _vars.size(); i++)
+    {
+        _blanketBegin.push_back(_blanketFactor.size());
+        for (auto const& b: blanket[i])
+        {
+            _blanketFactor.push_back(b.first);
+            _blanketStride.push_back(b.second);
+        }
+    }
+    _blanketBegin.push_back(_blanketFactor.size());
+
+    _evidence.assign(_vars.size(), npos);
+    _seed = (props.seed != 0) ? props.seed : taskSeed("gibbs");
+    _chains.resize(props.chains);
+    for (size_t c = 0; c < _chains.size(); c++)
+    {
+        Chain &chain = _chains[c];
+        chain.rng.seed(_seed + c);
+        for (size_t i = 0; i < _vars.size(); i++)
+            chain.state.push_back(std::uniform_int_distribution<size_t>(0, _vars[i].states() - 1)(chain.rng));
+    }
+
+    // without a run the chains sample from the prior
+    for (size_t i = 0; i < _vars.size(); i++)
+        _free.push_back(i);
+    for (auto &chain: _chains)
+        start(chain);
+}
+
+void MultiChainGibbs::start(Chain &chain)
+{
+    // enter the evidence in the current state and recompute the factor indices and the score
+    for (size_t i = 0; i < _vars.size(); i++)
+        if (_evidence[i] != npos)
+            chain.state[i] = _evidence[i];
+    chain.index.assign(_factorVars.size(), 0);
+    for (size_t i = 0; i < _vars.size(); i++)
+        for (size_t b = _blanketBegin[i]; b < _blanketBegin[i + 1]; b++)
+            chain.index[_blanketFactor[b]] += chain.state[i] * _blanketStride[b];
+    chain.zeros = 0;
+    chain.logScore = 0.0;
+    for (size_t I = 0; I < _factorVars.size(); I++)
+    {
+        dai::Real value = _tables[_tableOffset[I] + chain.index[I]];
+        if (value > 0.0)
+            chain.logScore += std::log(value);
+        else
+            chain.zeros++;
+    }
+    chain.counts.assign(_stateOffset.back() + _vars.back().states(), 0);
+    chain.best = chain.state;
+    chain.bestZeros = chain.zeros;
+    chain.bestLogScore = chain.logScore;
+}
+
+void MultiChainGibbs::sweep(Chain &chain, bool count)
+{
+    for (auto i: _free)
+    {
+        size_t card = _vars[i].states();
+        size_t old = chain.state[i];
+
+        // conditional distribution of i from the factors of its Markov blanket
+        chain.dist.assign(card, 1.0);
+        for (size_t b = _blanketBegin[i]; b < _blanketBegin[i + 1]; b++)
+        {
+            size_t stride = _blanketStride[b];
+            const dai::Real *table = &_tables[_tableOffset[_blanketFactor[b]] + chain.index[_blanketFactor[b]] - old * stride];
+            for (size_t x = 0; x < card; x++)
+                chain.dist[x] *= table[x * stride];
+        }
+
+        size_t state = 0;
+        dai::Real sum = 0.0;
+        for (size_t x = 0; x < card; x++)
+            sum += chain.dist[x];
+        if (sum > 0.0)
+        {
+            dai::Real u = std::uniform_real_distribution<dai::Real>(0.0, sum)(chain.rng);
+            while ((state + 1 < card) && (u >= chain.dist[state]))
+                u -= chain.dist[state++];
+        }
+        else
+            state = std::uniform_int_distribution<size_t>(0, card - 1)(chain.rng);
+
+        if (state == old)
+            continue;
+        for (size_t b = _blanketBegin[i]; b < _blanketBegin[i + 1]; b++)
+        {
+            size_t I = _blanketFactor[b];
+            dai::Real before = _tables[_tableOffset[I] + chain.index[I]];
+            chain.index[I] = chain.index[I] - old * _blanketStride[b] + state * _blanketStride[b];
+            dai::Real after = _tables[_tableOffset[I] + chain.index[I]];
+            if (before > 0.0)
+                chain.logScore -= std::log(before);
+            else
+                chain.zeros--;
+            if (after > 0.0)
+                chain.logScore += std::log(after);
+            else
+                chain.zeros++;
+        }
+        chain.state[i] = state;
+    }
+
+    if ((chain.zeros < chain.bestZeros) || ((chain.zeros == chain.bestZeros) && (chain.logScore > chain.bestLogScore)))
+    {
+        chain.best = chain.state;
+        chain.bestZeros = chain.zeros;
+        chain.bestLogScore = chain.logScore;
+    }
+    if (count)
+        for (size_t i = 0; i < _vars.size(); i++)
+            chain.counts[_stateOffset[i] + chain.state[i]]++;
+}
+
+void MultiChainGibbs::forChains(const std::function<void(Chain &)> &body)
+{
+    if (_pool != NULL)
+        _pool->parallel_for(_chains.size(), 1, [this, &body](size_t begin, size_t end) { for (size_t c = begin; c < end; c++) body(_chains[c]); });
+    else
+        for (auto &chain: _chains)
+            body(chain);
+}
+
+dai::Real MultiChainGibbs::gelmanRubin() const
+{
+    // largest potential scale reduction over the frequencies of all states of the free variables
+    dai::Real m = _chains.size();
+    dai::Real n = _sweeps;
+    if ((m < 2) || (n < 2))
+        return std::numeric_limits<dai::Real>::max();
+
+    dai::Real worst = 1.0;
+    for (auto i: _free)
+        for (size_t x = 0; x < _vars[i].states(); x++)
+        {
+            dai::Real mean = 0.0, within = 0.0;
+            for (auto const& chain: _chains)
+            {
+                dai::Real p = chain.counts[_stateOffset[i] + x] / n;
+                mean += p / m;
+                within += p * (1.0 - p) * n / (n - 1.0) / m;
+            }
+            dai::Real between = 0.0;
+            for (auto const& chain: _chains)
+            {
+                dai::Real p = chain.counts[_stateOffset[i] + x] / n;
+                between += n * (p - mean) * (p - mean) / (m - 1.0);
+            }
+            if (within <= 0.0)
+            {
+                if (between > 0.0)
+                    return std::numeric_limits<dai::Real>::max();
+                continue;
+            }
+            dai::Real pooled = (n - 1.0) / n * within + between / n;
+            worst = std::max(worst, std::sqrt(pooled / within));
+        }
+    return worst;
+}
+
+void MultiChainGibbs::run(const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues)
+{
+    auto begin = std::chrono::steady_clock::now();
+    auto elapsed = [begin]() { return std::chrono::duration<dai::Real>(std::chrono::steady_clock::now() - begin).count(); };
+
+    std::fill(_evidence.begin(), _evidence.end(), npos);
+    for (size_t k = 0; k < evidenceVars.size(); k++)
+        _evidence[evidenceVars[k]] = evidenceValues[k];
+    _free.clear();
+    for (size_t i = 0; i < _vars.size(); i++)
+        if (_evidence[i] == npos)
+            _free.push_back(i);
+    _joint.clear();
+    _next = 0;
+
+    size_t burnin = props.burnin;
+    forChains([this, burnin](Chain &chain)
+    {
+        start(chain);
+        for (size_t s = 0; s < burnin; s++)
+            sweep(chain, false);
+    });
+
+    // sample in blocks until the sweeps are done, the chains agree, or the time is up
+    _sweeps = 0;
+    _rhat = std::numeric_limits<dai::Real>::max();
+    while (_sweeps < props.samples)
+    {
+        size_t block = std::min(props.block, props.samples - _sweeps);
+        forChains([this, block](Chain &chain) { for (size_t s = 0; s < block; s++) sweep(chain, true); });
+        _sweeps += block;
+        _rhat = gelmanRubin();
+        if ((props.rhat > 0.0) && (_rhat < props.rhat))
+            break;
+        if ((props.maxtime > 0.0) && (elapsed() > props.maxtime))
+            break;
+    }
+}
+
+dai::Factor MultiChainGibbs::belief(const dai::Var &v)
+{
+    size_t i = _label2index[v.label()];
+    dai::Factor result(v, 0.0);
+    for (auto const& chain: _chains)
+        for (size_t x = 0; x < v.states(); x++)
+            result.set(x, result[x] + chain.counts[_stateOffset[i] + x]);
+    if (result.sum() > 0.0)
+        result.normalize();
+    else
+        result.fill(1.0 / v.states());
+    return result;
+}
+
+dai::Factor MultiChainGibbs::calcMarginal(const dai::VarSet &vs)
+{
+    if (vs.size() == 1)
+        return belief(*vs.begin());
+    auto known = _joint.find(vs);
+    if (known != _joint.end())
+        return known->second;
+
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<size_t> vars, strides;
+    size_t stride = 1;
+    for (auto const& v: vs)
+    {
+        vars.push_back(_label2index[v.label()]);
+        strides.push_back(stride);
+        stride *= v.states();
+    }
+
+    // count the joint states of vs while continuing every chain for as many sweeps as the last run
+    std::vector<std::vector<size_t> > counts(_chains.size(), std::vector<size_t>(stride, 0));
+    size_t done = 0;
+    size_t target = std::max(_sweeps, (size_t) 1);
+    while (done < target)
+    {
+        size_t block = std::min(props.block, target - done);
+        forChains([this, block, &vars, &strides, &counts](Chain &chain)
+        {
+            std::vector<size_t> &local = counts[&chain - &_chains[0]];
+            for (size_t s = 0; s < block; s++)
+            {
+                sweep(chain, false);
+                size_t entry = 0;
+                for (size_t k = 0; k < vars.size(); k++)
+                    entry += chain.state[vars[k]] * strides[k];
+                local[entry]++;
+            }
+        });
+        done += block;
+        if ((props.maxtime > 0.0) && (std::chrono::duration<dai::Real>(std::chrono::steady_clock::now() - begin).count() > props.maxtime))
+            break;
+    }
+
+    dai::Factor result(vs, 0.0);
+    for (auto const& local: counts)
+        for (size_t entry = 0; entry < stride; entry++)
+            result.set(entry, result[entry] + local[entry]);
+    result.normalize();
+    _joint[vs] = result;
+    return result;
+}
+
+void MultiChainGibbs::calcMarginal(const dai::VarSet &vs, std::vector<dai::Real> &marginal)
+{
+    dai::Factor result = calcMarginal(vs);
+    marginal.assign(result.p().begin(), result.p().end());
+}
+
+std::vector<size_t> MultiChainGibbs::findMaximum()
+{
+    const Chain *best = &_chains[0];
+    for (auto const& chain: _chains)
+        if ((chain.bestZeros < best->bestZeros) || ((chain.bestZeros == best->bestZeros) && (chain.bestLogScore > best->bestLogScore)))
+            best = &chain;
+    return best->best;
+}
+
+void MultiChainGibbs::draw(const std::vector<unsigned int> &vars, std::vector<unsigned int> &values)
+{
+    Chain &chain = _chains[_next];
+    _next = (_next + 1) % _chains.size();
+    sweep(chain, false);
+    values.resize(vars.size());
+    for (size_t k = 0; k < vars.size(); k++)
+        values[k] = chain.state[vars[k]];
+}
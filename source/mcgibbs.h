@@ -0,0 +1,104 @@
+#ifndef MCGIBBSHEADER
+#define MCGIBBSHEADER
+
+// STL includes
+#include <vector>
+#include <map>
+#include <string>
+#include <random>
+#include <functional>
+#include "dai/factorgraph.h"
+#include "dai/varset.h"
+#include "dai/enum.h"
+#include "dai/properties.h"
+#include "engine.h"
+#include "threadpool.h"
+
+// Gibbs sampling with several independent chains, run in parallel on the shared thread pool. Every
+// chain keeps the table index of each factor in its current state, so the conditional distribution of
+// a variable is read from its Markov blanket with one strided lookup per factor and state. Sampling
+// stops after 'samples' sweeps per chain, when the Gelman-Rubin R-hat of all state frequencies drops
+// below 'rhat', or after 'maxtime' seconds, whichever comes first; this makes the engine usable as an
+// anytime backend for get_map. Marginals are sample frequencies; a marginal over several variables is
+// counted jointly by continuing the chains for as many sweeps as run() took. findMaximum returns the
+// most probable state visited by any chain.
+class MultiChainGibbs : public InferenceEngine
+{
+    public:
+        struct Properties
+        {
+            DAI_ENUM(InfType,SUMPROD,MAXPROD);
+            InfType inference;      // sum-product (marginals, MAP) or max-product (MPE)
+            size_t threads;         // 1 = sequential
+            size_t chains;          // independent chains (0 = one per thread, at least four)
+            size_t burnin;          // sweeps per chain discarded after every run
+            size_t samples;         // sweeps per chain that are counted
+            size_t block;           // sweeps between convergence checks
+            dai::Real rhat;         // stop when the largest R-hat is below this (0 = never stop early)
+            dai::Real maxtime;      // stop sampling after this many seconds (0 = no time bound)
+            size_t seed;            // seed of the first chain (0 = the next "gibbs" stream of the run seed, see rng.h)
+        } props;
+
+        MultiChainGibbs(const dai::FactorGraph &fg, const dai::PropertySet &opts);
+
+        std::string name() const { return "MCGIBBS"; }
+
+        void run(const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues);
+
+        dai::Factor belief(const dai::Var &v);
+        dai::Factor calcMarginal(const dai::VarSet &vs);
+        void calcMarginal(const dai::VarSet &vs, std::vector<dai::Real> &marginal);
+        std::vector<size_t> findMaximum();
+
+        const dai::Var &var(size_t i) const { return _vars[i]; }
+        size_t nrVars() const { return _vars.size(); }
+
+        // the next state of the given variables, taking the chains in turn one sweep further (after run)
+        void draw(const std::vector<unsigned int> &vars, std::vector<unsigned int> &values);
+
+        size_t sweeps() const { return _sweeps; }           // counted sweeps per chain in the last run
+        dai::Real rhatMax() const { return _rhat; }         // largest R-hat after the last run
+
+    private:
+        struct Chain
+        {
+            std::vector<size_t> state;          // per variable
+            std::vector<size_t> index;          // per factor: table entry of the current state
+            std::vector<size_t> counts;         // per variable and state (see _stateOffset)
+            std::vector<dai::Real> dist;        // scratch: conditional distribution
+            std::mt19937_64 rng;
+            size_t zeros;                       // factors that are zero in the current state
+            dai::Real logScore;                 // sum of the logarithms of the other factors
+            std::vector<size_t> best;           // most probable state visited
+            size_t bestZeros;
+            dai::Real bestLogScore;
+        };
+
+        void start(Chain &chain);
+        void sweep(Chain &chain, bool count);
+        void forChains(const std::function<void(Chain &)> &body);
+        dai::Real gelmanRubin() const;
+
+        std::vector<dai::Var> _vars;
+        std::map<size_t, size_t> _label2index;
+        std::vector<dai::VarSet> _factorVars;
+        std::vector<dai::Real> _tables;                 // all factor tables, one after the other
+        std::vector<size_t> _tableOffset;               // per factor: its first entry in _tables
+
+        // Markov blanket of variable i: the factors _blanketFactor[_blanketBegin[i] .. _blanketBegin[i+1])
+        // with the stride of i in each of them
+        std::vector<size_t> _blanketBegin, _blanketFactor, _blanketStride;
+        std::vector<size_t> _stateOffset;               // per variable: its first state in the counts
+
+        std::vector<size_t> _evidence;                  // per variable: observed state (or npos)
+        std::vector<size_t> _free;                      // variables without evidence, in sweep order
+        std::vector<Chain> _chains;
+        std::map<dai::VarSet, dai::Factor> _joint;      // joint frequencies counted since the last run
+        size_t _seed;
+        size_t _sweeps;
+        size_t _next;                                   // chain that draw() takes next
+        dai::Real _rhat;
+        ThreadPool *_pool;
+};
+
+#endif // defined MCGIBBSHEADER
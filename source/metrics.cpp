@@ -0,0 +1,311 @@
+/************************************************************************/
+/* Metrics and phase timers                    					        */
+/* Version:			1.0													*/
+/* Last changed:	18-10-2026                                         	*/
+/*                                                                     	*/
+/* Version History:                                                    	*/
+/*                                                                     	*/
+/* Version Comments:                                                   	*/
+/* - replaces the timing messages of DEBUGMODE; build with             	*/
+/*   make METRICS=0 to compile all instrumentation out                 	*/
+/* - the block of a finished thread is handed to the next new thread,  	*/
+/*   so the server (a thread per connection) keeps a bounded number    	*/
+/* - spans are kept per thread until the trace is written; the trace   	*/
+/*   is meant for single runs, not for the server                      	*/
+/************************************************************************/
+
+// headers
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include "dai/exceptions.h"
+#include "metrics.h"
+
+#ifdef METRICS
+
+namespace metrics
+{
+    thread_local Block *local = NULL;
+    std::atomic<bool> tracingOn(false);
+}
+
+static const char *counterNames[NR_METRIC_COUNTERS] = { "engine_builds", "propagations", "clamps", "marginals", "cache_hits", "samples" };
+static const char *histogramNames[NR_METRIC_HISTOGRAMS] = { "marginal_size", "evidence_size" };
+
+static std::mutex metricsMutex;
+static std::vector<metrics::Block *> allBlocks;         // never freed: the totals of finished threads still count
+static std::vector<metrics::Block *> freeBlocks;        // blocks of finished threads, ready for reuse
+static const char *phaseNames[metrics::maxPhases];        // written once, before the id is handed out
+static size_t nrPhases = 0;
+
+// the spans of one thread, kept after the thread has finished
+struct TraceBuffer
+{
+    struct Span
+    {
+        size_t id, depth;
+        uint64_t start, ns;
+        std::string args;
+    };
+    struct Frame
+    {
+        size_t id;
+        uint64_t childNs;
+    };
+
+    size_t tid;
+    std::vector<Frame> stack;                   // only used by the owning thread
+    std::mutex mutex;                           // guards the members below
+    std::vector<Span> spans;
+    uint64_t dropped = 0;
+    std::map<std::string, uint64_t> folded;     // self time per stack of phases
+};
+
+static std::atomic<std::chrono::steady_clock::rep> traceStart(0);
+static std::vector<std::unique_ptr<TraceBuffer>> traceBuffers;
+static thread_local TraceBuffer *localTrace = NULL;
+
+// hands the block of the current thread back when the thread finishes
+struct BlockOwner
+{
+    ~BlockOwner()
+    {
+        std::lock_guard<std::mutex> lock(metricsMutex);
+        freeBlocks.push_back(metrics::local);
+        metrics::local = NULL;
+    }
+};
+
+metrics::Block &metrics::registerThread()
+{
+    static thread_local BlockOwner owner;
+    std::lock_guard<std::mutex> lock(metricsMutex);
+    if (freeBlocks.empty())
+    {
+        allBlocks.push_back(new Block());
+        local = allBlocks.back();
+    }
+    else
+    {
+        local = freeBlocks.back();
+        freeBlocks.pop_back();
+    }
+    (void) owner;
+    return *local;
+}
+
+size_t metrics::phaseId(const char *name)
+{
+    std::lock_guard<std::mutex> lock(metricsMutex);
+    for (size_t i = 0; i < nrPhases; i++)
+        if (std::strcmp(phaseNames[i], name) == 0)
+            return i;
+    if (nrPhases == maxPhases)
+        DAI_THROWE(RUNTIME_ERROR, "Too many metric phases (raise metrics::maxPhases)");
+    phaseNames[nrPhases] = name;
+    return nrPhases++;
+}
+
+static TraceBuffer &traceBuffer()
+{
+    if (localTrace == NULL)
+    {
+        std::lock_guard<std::mutex> lock(metricsMutex);
+        traceBuffers.push_back(std::unique_ptr<TraceBuffer>(new TraceBuffer()));
+        traceBuffers.back()->tid = traceBuffers.size();
+        localTrace = traceBuffers.back().get();
+    }
+    return *localTrace;
+}
+
+void metrics::beginSpan(size_t id)
+{
+    TraceBuffer::Frame frame = { id, 0 };
+    traceBuffer().stack.push_back(frame);
+}
+
+void metrics::endSpan(size_t id, std::chrono::steady_clock::time_point start, uint64_t ns, const std::string &args)
+{
+    TraceBuffer &t = traceBuffer();
+    uint64_t childNs = t.stack.back().childNs;
+    t.stack.pop_back();
+    if (!t.stack.empty())
+        t.stack.back().childNs += ns;
+
+    std::string stack;
+    for (const TraceBuffer::Frame &f : t.stack)
+    {
+        stack += phaseNames[f.id];
+        stack += ';';
+    }
+    stack += phaseNames[id];
+
+    std::lock_guard<std::mutex> lock(t.mutex);
+    t.folded[stack] += (ns > childNs) ? ns - childNs : 0;
+    if (t.spans.size() < maxSpans)
+    {
+        TraceBuffer::Span span = { id, t.stack.size(), (uint64_t) (start.time_since_epoch().count() - traceStart.load()), ns, args };
+        t.spans.push_back(span);
+    }
+    else
+        t.dropped++;
+}
+
+bool startTrace()
+{
+    traceStart.store(std::chrono::steady_clock::now().time_since_epoch().count());
+    metrics::tracingOn.store(true);
+    return true;
+}
+
+// s as the contents of a JSON string
+static std::string jsonEscape(const std::string &s)
+{
+    std::string escaped;
+    for (char c : s)
+    {
+        if ((c == '"') || (c == '\\'))
+            escaped += '\\';
+        if ((unsigned char) c >= 0x20)
+            escaped += c;
+    }
+    return escaped;
+}
+
+void writeTrace(std::ostream &os)
+{
+    std::lock_guard<std::mutex> lock(metricsMutex);
+    std::ios_base::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+    const char *separator = "\n";
+    uint64_t dropped = 0;
+    for (const std::unique_ptr<TraceBuffer> &t : traceBuffers)
+    {
+        std::lock_guard<std::mutex> spansLock(t->mutex);
+        os << separator << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t->tid
+           << ",\"args\":{\"name\":\"thread " << t->tid << "\"}}";
+        separator = ",\n";
+        for (const TraceBuffer::Span &span : t->spans)
+        {
+            // the category is the algorithm, the part of the name before the '.'
+            std::string name = phaseNames[span.id];
+            os << ",\n{\"name\":\"" << jsonEscape(name) << "\",\"cat\":\"" << jsonEscape(name.substr(0, name.find('.')))
+               << "\",\"ph\":\"X\",\"ts\":" << span.start / 1e3 << ",\"dur\":" << span.ns / 1e3 << ",\"pid\":1,\"tid\":" << t->tid
+               << ",\"args\":{\"depth\":" << span.depth;
+            std::istringstream args(span.args);
+            std::string arg;
+            while (args >> arg)
+            {
+                size_t is = arg.find('=');
+                std::string key = (is == std::string::npos) ? std::string("arg") : arg.substr(0, is);
+                os << ",\"" << jsonEscape(key) << "\":\"" << jsonEscape(arg.substr(is + 1)) << "\"";
+            }
+            os << "}}";
+        }
+        dropped += t->dropped;
+    }
+    os << "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped_spans\":\"" << dropped << "\"}}" << std::endl;
+    os.flags(flags);
+    os.precision(precision);
+}
+
+void writeFlamegraph(std::ostream &os)
+{
+    std::lock_guard<std::mutex> lock(metricsMutex);
+    std::map<std::string, uint64_t> folded;
+    for (const std::unique_ptr<TraceBuffer> &t : traceBuffers)
+    {
+        std::lock_guard<std::mutex> spansLock(t->mutex);
+        for (const auto &stack : t->folded)
+            folded[stack.first] += stack.second;
+    }
+    for (const auto &stack : folded)
+        os << stack.first << " " << stack.second << std::endl;
+}
+
+void dumpMetrics(std::ostream &os)
+{
+    using namespace metrics;
+    std::lock_guard<std::mutex> lock(metricsMutex);
+    uint64_t counters[NR_METRIC_COUNTERS] = {}, histograms[NR_METRIC_HISTOGRAMS][buckets] = {}, sums[NR_METRIC_HISTOGRAMS] = {};
+    std::vector<uint64_t> phaseCounts(nrPhases, 0), phaseNs(nrPhases, 0);
+    for (const Block *b : allBlocks)
+    {
+        for (size_t c = 0; c < NR_METRIC_COUNTERS; c++)
+            counters[c] += b->counters[c].load(std::memory_order_relaxed);
+        for (size_t h = 0; h < NR_METRIC_HISTOGRAMS; h++)
+        {
+            for (size_t k = 0; k < buckets; k++)
+                histograms[h][k] += b->histograms[h][k].load(std::memory_order_relaxed);
+            sums[h] += b->histogramSums[h].load(std::memory_order_relaxed);
+        }
+        for (size_t p = 0; p < nrPhases; p++)
+        {
+            phaseCounts[p] += b->phaseCounts[p].load(std::memory_order_relaxed);
+            phaseNs[p] += b->phaseNs[p].load(std::memory_order_relaxed);
+        }
+    }
+
+    os << "[METRICS] counters";
+    for (size_t c = 0; c < NR_METRIC_COUNTERS; c++)
+        os << " " << counterNames[c] << "=" << counters[c];
+    os << std::endl;
+
+    // a histogram lists its non-empty buckets as lower bound:count
+    for (size_t h = 0; h < NR_METRIC_HISTOGRAMS; h++)
+    {
+        uint64_t n = 0;
+        for (size_t k = 0; k < buckets; k++)
+            n += histograms[h][k];
+        os << "[METRICS] histogram " << histogramNames[h] << " count=" << n << " sum=" << sums[h] << " buckets";
+        for (size_t k = 0; k < buckets; k++)
+            if (histograms[h][k] > 0)
+                os << " " << ((k == 0) ? 0 : (uint64_t) 1 << (k - 1)) << ":" << histograms[h][k];
+        os << std::endl;
+    }
+
+    // phases sorted by name, which groups them per algorithm
+    std::vector<size_t> order(nrPhases);
+    for (size_t p = 0; p < order.size(); p++)
+        order[p] = p;
+    std::sort(order.begin(), order.end(), [](size_t a, size_t b) { return std::strcmp(phaseNames[a], phaseNames[b]) < 0; });
+    std::ios_base::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    for (size_t p : order)
+    {
+        if (phaseCounts[p] == 0)
+            continue;
+        os << "[METRICS] phase " << phaseNames[p] << " calls=" << phaseCounts[p] << std::fixed << std::setprecision(3)
+           << " total_ms=" << phaseNs[p] / 1e6 << " mean_us=" << phaseNs[p] / 1e3 / phaseCounts[p] << std::endl;
+    }
+    os.flags(flags);
+    os.precision(precision);
+}
+
+#else
+
+void dumpMetrics(std::ostream &)
+{
+}
+
+bool startTrace()
+{
+    return false;
+}
+
+void writeTrace(std::ostream &)
+{
+}
+
+void writeFlamegraph(std::ostream &)
+{
+}
+
+#endif // defined METRICS
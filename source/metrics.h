@@ -0,0 +1,144 @@
+#ifndef METRICSHEADER
+#define METRICSHEADER
+
+// STL includes
+#include <iostream>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+// Instrumentation, compiled in with -DMETRICS (make METRICS=1, the default) and out with make METRICS=0,
+// in which case the macros below expand to nothing at all.
+//   METRIC_COUNT(counter, n)       adds n to a counter
+//   METRIC_RECORD(histogram, x)    adds x to a histogram with power-of-two buckets
+//   METRIC_PHASE("ALG.phase")      times the rest of the enclosing scope as a phase of algorithm ALG
+//   METRIC_SPAN("ALG.phase", args) the same, with arguments for the trace ("key=value key=value", only
+//                                  evaluated while tracing)
+// Every thread counts in a block of its own, so the hot path takes no lock and no atomic read-modify-
+// write; dumpMetrics() adds up the blocks of all threads, including threads that have finished.
+//
+// After startTrace() every phase is also recorded as a span, with its thread, nesting and arguments, to be
+// written as Chrome trace-event JSON (chrome://tracing, Perfetto) or as collapsed stacks with the self time
+// in ns of every stack (flamegraph.pl). Without tracing a phase costs one extra relaxed load.
+enum MetricCounter { ENGINE_BUILDS, PROPAGATIONS, CLAMPS, MARGINALS, CACHE_HITS, SAMPLES, NR_METRIC_COUNTERS };
+enum MetricHistogram { MARGINAL_SIZE, EVIDENCE_SIZE, NR_METRIC_HISTOGRAMS };
+
+// writes the totals to os as one block of lines starting with [METRICS] (nothing without METRICS)
+void dumpMetrics(std::ostream &os);
+
+// starts recording spans; false if the instrumentation is compiled out
+bool startTrace();
+void writeTrace(std::ostream &os);
+void writeFlamegraph(std::ostream &os);
+
+#ifdef METRICS
+
+namespace metrics
+{
+    static const size_t buckets = 65;           // bucket b > 0 holds values in [2^(b-1), 2^b)
+    static const size_t maxPhases = 64;
+    static const size_t maxSpans = 1 << 20;     // per thread; later spans are dropped (and counted)
+
+    struct Block
+    {
+        std::atomic<uint64_t> counters[NR_METRIC_COUNTERS];
+        std::atomic<uint64_t> histograms[NR_METRIC_HISTOGRAMS][buckets];
+        std::atomic<uint64_t> histogramSums[NR_METRIC_HISTOGRAMS];
+        std::atomic<uint64_t> phaseCounts[maxPhases];
+        std::atomic<uint64_t> phaseNs[maxPhases];
+    };
+
+    extern thread_local Block *local;
+    Block &registerThread();
+
+    extern std::atomic<bool> tracingOn;
+    inline bool tracing()
+    {
+        return tracingOn.load(std::memory_order_relaxed);
+    }
+    void beginSpan(size_t id);
+    void endSpan(size_t id, std::chrono::steady_clock::time_point start, uint64_t ns, const std::string &args);
+
+    // only the owning thread writes to its block, so a relaxed load and store is enough
+    inline void add(std::atomic<uint64_t> &a, uint64_t n)
+    {
+        a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    inline Block &block()
+    {
+        return (local != NULL) ? *local : registerThread();
+    }
+
+    inline void count(MetricCounter c, uint64_t n)
+    {
+        add(block().counters[c], n);
+    }
+
+    inline void record(MetricHistogram h, uint64_t x)
+    {
+        size_t b = 0;
+        for (uint64_t y = x; y > 0; y >>= 1)
+            b++;
+        Block &m = block();
+        add(m.histograms[h][b], 1);
+        add(m.histogramSums[h], x);
+    }
+
+    // the index of a phase name (a string literal), the same for every thread
+    size_t phaseId(const char *name);
+
+    class PhaseTimer
+    {
+        public:
+            explicit PhaseTimer(size_t id) : _id(id), _traced(tracing())
+            {
+                if (_traced)
+                    beginSpan(id);
+                _start = std::chrono::steady_clock::now();
+            }
+            ~PhaseTimer()
+            {
+                uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start).count();
+                Block &m = block();
+                add(m.phaseCounts[_id], 1);
+                add(m.phaseNs[_id], ns);
+                if (_traced)
+                    endSpan(_id, _start, ns, _args);
+            }
+
+            bool traced() const { return _traced; }
+            void arguments(const std::string &args) { _args = args; }
+
+        private:
+            size_t _id;
+            bool _traced;
+            std::chrono::steady_clock::time_point _start;
+            std::string _args;
+    };
+}
+
+#define METRIC_CONCAT2(a, b) a##b
+#define METRIC_CONCAT(a, b) METRIC_CONCAT2(a, b)
+#define METRIC_COUNT(c, n) metrics::count(c, n)
+#define METRIC_RECORD(h, x) metrics::record(h, x)
+#define METRIC_PHASE(name) \
+    static const size_t METRIC_CONCAT(metricPhaseId, __LINE__) = metrics::phaseId(name); \
+    metrics::PhaseTimer METRIC_CONCAT(metricPhase, __LINE__)(METRIC_CONCAT(metricPhaseId, __LINE__))
+#define METRIC_SPAN(name, args) \
+    METRIC_PHASE(name); \
+    if (METRIC_CONCAT(metricPhase, __LINE__).traced()) \
+        METRIC_CONCAT(metricPhase, __LINE__).arguments(args)
+
+#else
+
+#define METRIC_COUNT(c, n) ((void) 0)
+#define METRIC_RECORD(h, x) ((void) 0)
+#define METRIC_PHASE(name) ((void) 0)
+#define METRIC_SPAN(name, args) ((void) 0)
+
+#endif // defined METRICS
+
+#endif // defined METRICSHEADER
@@ -1,10 +1,12 @@
 /************************************************************************/
 /* MFE algorithm implementation              					        */
 /* Written by:		Johan Kwisthout                                		*/
-/* Version:			1.0                 								*/
-/* Last changed:	26-05-2022                                         	*/
+/* Version:			1.1                 								*/
+/* Last changed:	18-10-2026                                         	*/
 /*                                                                     	*/
 /* Version History:                                                    	*/
+/* - 1.1: selectable sampling of the irrelevant variables, weighted     */
+/*   votes and a convergence report                                     */
 /*                                                                     	*/
 /* Version Comments:                                                   	*/
 /* - implementation of the algorithm described in Kwisthout (2015)     	*/
@@ -12,13 +14,38 @@
 
 // headers
 #include "mfesim.h"
+#include "mcgibbs.h"
+#include "forward.h"
+#include "metrics.h"
+#include "rng.h"
+#include <algorithm>
+#include <cmath>
 #include <chrono>
 
 std::vector<unsigned long int> compute_MFE(dai::FactorGraph fg, std::vector<unsigned int> evidenceVars, std::vector<unsigned int> evidenceValues,
 	std::vector<unsigned int> hypothesisVars, std::vector<unsigned int> relevantVars, std::vector<unsigned int> irrelevantVars,
 	bool relevanceComputation, unsigned long int samplesRel, double relThreshold, unsigned long int samples, unsigned long int cutoffTime)
 {
-    unsigned long int timeBound = cutoffTime * 1000000000UL;
+	// the junction tree is built once; each sample only enters different evidence. One max-product junction
+	// tree serves all relevance tests
+	std::unique_ptr<InferenceEngine> jt(newEngine(fg, engineOptions("inference",std::string("SUMPROD"))));
+	std::unique_ptr<InferenceEngine> mpeTree;
+	if (relevanceComputation)
+		mpeTree.reset(newEngine(fg, engineOptions("inference",std::string("MAXPROD"))));
+
+	return compute_MFE(fg, *jt, relevanceComputation ? *mpeTree : *jt, evidenceVars, evidenceValues, hypothesisVars, relevantVars, irrelevantVars,
+		relevanceComputation, samplesRel, relThreshold, samples, cutoffTime);
+}
+
+std::vector<unsigned long int> compute_MFE(const dai::FactorGraph &fg, InferenceEngine &jt, InferenceEngine &mpeTree, const std::vector<unsigned int> &evidenceVars, 
+	const std::vector<unsigned int> &evidenceValues, const std::vector<unsigned int> &hypothesisVars, std::vector<unsigned int> relevantVars, 
+	std::vector<unsigned int> irrelevantVars, bool relevanceComputation, unsigned long int samplesRel, double relThreshold, unsigned long int samples, 
+	double cutoffTime, const SnapshotHook &snapshot, VoteTable *votes)
+{
+	// jt is a sum-product engine, mpeTree a max-product engine (only used when relevanceComputation is set);
+	// votes (if given) receives the vote table, for combining the votes of several runs (see shard.h)
+	METRIC_SPAN("MFE.compute", "relevant=" + std::to_string(relevantVars.size()) + " irrelevant=" + std::to_string(irrelevantVars.size()));
+    unsigned long int timeBound = (unsigned long int) (cutoffTime * 1e9);     // cutoffTime may have fractions of a second
 
 	std::vector<unsigned long int> MFE;
 
@@ -28,19 +55,19 @@ std::vector<unsigned long int> compute_MFE(dai::FactorGraph fg, std::vector<unsi
 	// sample over irrelevant variables
     std::vector<unsigned int> irrelevant_sample;
 
-	// random number generator
-	std::random_device rd;                      // note C++11 code
-    std::mt19937 gen(rd());						// random numbers by Mersenne twister algorithm
+	// random number generator: the next MFE stream of the run seed (see rng.h)
+    std::mt19937 gen = taskStream("mfe");
 
 	// if relevanceComputation is true, we need to populate the relevant intermediate variables (all is currently in irrelevant, we rebuild them)
 	if (relevanceComputation)
 	{
+		METRIC_PHASE("MFE.relevance");
 		std::vector<unsigned int> intermediateVars(irrelevantVars);
 		irrelevantVars.clear();
-		
+
 	    for (auto inter = intermediateVars.begin(); inter != intermediateVars.end(); ++inter)
 	    {
-			double rel = relevance(fg, *inter, evidenceVars, evidenceValues, hypothesisVars, intermediateVars, samplesRel, gen);
+			double rel = relevance(mpeTree, *inter, evidenceVars, evidenceValues, hypothesisVars, intermediateVars, samplesRel, gen);
             DEBUG(std::cout << "relevance of " << *inter << " is " << rel << std::endl;)
 			
 			if (rel >= relThreshold)
@@ -64,21 +91,125 @@ std::vector<unsigned long int> compute_MFE(dai::FactorGraph fg, std::vector<unsi
         irrelevant_max_values.push_back(st - 1);
     }
 
+	// how the irrelevant variables are drawn (the sampler option): uniformly (UNIFORM), uniformly but stratified
+	// per variable (STRATIFIED) or along a randomly shifted Halton sequence (QMC), or from Pr(I | e) by likelihood-
+	// weighted forward sampling (PRIOR, every vote counts with the weight of its sample) or by multi-chain Gibbs
+	// sampling (GIBBS)
+	std::string sampler = engineOptions.hasKey("sampler") ? engineOptions.getStringAs<std::string>("sampler") : std::string("UNIFORM");
+	std::unique_ptr<ForwardSampler> forward;
+	std::unique_ptr<MultiChainGibbs> gibbs;
+	if (sampler == "PRIOR")
+	{
+		try
+		{
+			forward.reset(new ForwardSampler(fg, engineOptions));
+			forward->setEvidence(evidenceVars, evidenceValues);
+		}
+		catch (dai::Exception &e)
+		{
+			std::cerr << "no forward sampling (" << e.what() << "), sampling Pr(I | e) by Gibbs sampling instead" << std::endl;
+			sampler = "GIBBS";
+		}
+	}
+	if (sampler == "GIBBS")
+	{
+		// the sampler only burns in here, every draw takes one of its chains a sweep further
+		gibbs.reset(new MultiChainGibbs(fg, engineOptions("samples",(size_t) 0)));
+		gibbs->run(evidenceVars, evidenceValues);
+	}
+	std::vector<std::vector<unsigned int> > strata;
+	if (sampler == "STRATIFIED")
+	{
+		// Latin hypercube: every variable runs through a random permutation of evenly spread states
+		for (size_t k = 0; k < irrelevantVars.size(); k++)
+		{
+			strata.push_back(std::vector<unsigned int>(samples));
+			for (unsigned long int n = 0; n < samples; n++)
+				strata[k][n] = (unsigned int) (n * (irrelevant_max_values[k] + 1) / samples);
+			std::shuffle(strata[k].begin(), strata[k].end(), gen);
+		}
+	}
+	std::vector<unsigned int> bases;
+	std::vector<double> shifts;
+	if (sampler == "QMC")
+	{
+		// one prime base and one random shift (Cranley-Patterson rotation) per variable
+		std::uniform_real_distribution<> shift(0.0, 1.0);
+		for (unsigned int b = 2; bases.size() < irrelevantVars.size(); b++)
+		{
+			bool prime = true;
+			for (auto p: bases)
+				if (b % p == 0)
+					prime = false;
+			if (prime)
+			{
+				bases.push_back(b);
+				shifts.push_back(shift(gen));
+			}
+		}
+	}
+	std::vector<unsigned int> batchStates;
+	std::vector<dai::Real> batchWeights;
+	size_t batchNext = 0;
+
 	// get the current MAP
 	std::vector<unsigned long int> map;
-	std::map<std::vector<unsigned long int>, int> map_counts;
-	std::map<std::vector<unsigned long int>, int>::iterator map_it;
+	VoteTable map_counts;
+	VoteTable::iterator map_it;
+
+	// for the convergence report: sum of the weights and of their squares, and the running winner
+	double weightSum = 0.0, weightSquares = 0.0;
+	std::vector<unsigned long int> leader;
+	double leaderWeight = 0.0;
+	unsigned long int leaderSince = 0, drawn = 0;
 	
 	// MAIN loop (comment lines match the algorithm description):
 
     // internal time keeping to cut off computation after time bound
     auto start = std::chrono::steady_clock::now();
+	METRIC_SPAN("MFE.sampling", "sampler=" + sampler + " samples=" + std::to_string(samples));
 		
 	// for n = 1 to N do
 	for (unsigned long int n = 0; n < samples; n++)
 	{
 		// Choose i \in I- at random
-        random_sample(irrelevantVars.size(), -1, irrelevant_sample, irrelevant_max_values, gen);
+		double weight = 1.0;
+        if (forward)
+        {
+            // forward samples come in batches, generated in parallel
+            if (batchNext == batchWeights.size())
+            {
+                forward->generate(std::min(samples - n, (unsigned long int) 1024), batchStates, batchWeights);
+                batchNext = 0;
+            }
+            for (size_t k = 0; k < irrelevantVars.size(); k++)
+                irrelevant_sample[k] = batchStates[batchNext * forward->nrVars() + irrelevantVars[k]];
+            weight = batchWeights[batchNext++];
+        }
+        else if (gibbs)
+            gibbs->draw(irrelevantVars, irrelevant_sample);
+        else if (sampler == "STRATIFIED")
+        {
+            for (size_t k = 0; k < irrelevantVars.size(); k++)
+                irrelevant_sample[k] = strata[k][n];
+        }
+        else if (sampler == "QMC")
+        {
+            for (size_t k = 0; k < irrelevantVars.size(); k++)
+            {
+                // radical inverse of n + 1 in base k, shifted modulo 1
+                double u = 0.0, digit = 1.0 / bases[k];
+                for (unsigned long int m = n + 1; m > 0; m /= bases[k], digit /= bases[k])
+                    u += (m % bases[k]) * digit;
+                u = std::fmod(u + shifts[k], 1.0);
+                irrelevant_sample[k] = std::min((unsigned int) (u * (irrelevant_max_values[k] + 1)), irrelevant_max_values[k]);
+            }
+        }
+        else
+            random_sample(irrelevantVars.size(), -1, irrelevant_sample, irrelevant_max_values, gen);
+		METRIC_COUNT(SAMPLES, 1);
+		if (weight <= 0.0)
+			continue;				// impossible given the evidence: no vote
 		
 		std::vector<unsigned int> combined_evidence;
 		std::vector<unsigned int> combined_evidence_values;
@@ -89,39 +220,75 @@ std::vector<unsigned long int> compute_MFE(dai::FactorGraph fg, std::vector<unsi
 
 
 		// Determine h = argmax_h Pr(H = h, i, e)
-		map = get_map(fg, hypothesisVars, combined_evidence, combined_evidence_values, false);
+		map = get_map(jt, hypothesisVars, combined_evidence, combined_evidence_values, false);
 		
 		// Collate the joint value assignments h (std::map<<vector>,int>) -- if <vector> does not exist, add it (int = 1) otherwise int++
 		map_it = map_counts.find(map);
 		
 		if (map_it == map_counts.end()) 
 		{
-			map_counts.insert(std::pair<std::vector<unsigned long int>, int>(map, 1));
+			map_it = map_counts.insert(std::pair<std::vector<unsigned long int>, double>(map, weight)).first;
 		}
 		else
 		{
-			map_it->second++;
+			map_it->second += weight;
 		}
 
+		weightSum += weight;
+		weightSquares += weight * weight;
+		drawn++;
+		if (map_it->second > leaderWeight)
+		{
+			if (map_it->first != leader)
+			{
+				leader = map_it->first;
+				leaderSince = drawn;
+			}
+			leaderWeight = map_it->second;
+		}
+		if (snapshot)
+			snapshot(drawn, leader);
+
         if (std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() > timeBound)
         {
-            std::cout << "stopping computation - time bound" << std::endl;
+            std::cerr << "stopping computation - time bound" << std::endl;
             n = samples;
         }
 	}
 	
 	// Decide upon the joint value assignment hmaj that was picked most often
-	int mfe_max = 0;
+	double mfe_max = 0.0, runner_up = 0.0;
 	for (map_it = map_counts.begin(); map_it != map_counts.end(); ++map_it)
 	{
 		DEBUG(std::cout << "assignment " << map_it->first << " count was " << map_it->second << std::endl;)
 		if (map_it->second > mfe_max)
 		{
+			runner_up = mfe_max;
 			mfe_max = map_it->second;
 			MFE = map_it->first;
 		}
+		else if (map_it->second > runner_up)
+		{
+			runner_up = map_it->second;
+		}
+	}
+
+	// convergence report (on standard error, standard output may carry results): vote shares with their standard
+	// errors, using the effective sample size of the weights. A caller that takes the vote table combines it
+	// with others, so only the combined votes mean anything
+	if ((weightSum > 0.0) && (votes == NULL))
+	{
+		double ess = weightSum * weightSum / weightSquares;
+		double share = mfe_max / weightSum, second = runner_up / weightSum;
+		double margin = share - second;
+		double marginError = std::sqrt(std::max(0.0, share + second - margin * margin) / ess);
+		std::cerr << "MFE sampling (" << sampler << "): " << drawn << " votes, effective sample size " << ess
+			<< ", vote share " << share << " (s.e. " << std::sqrt(share * (1.0 - share) / ess) << "), margin over runner-up "
+			<< margin << " (s.e. " << marginError << "), same winner since vote " << leaderSince << std::endl;
 	}
 
+	if (votes != NULL)
+		*votes = map_counts;
 	return MFE;
 }
 
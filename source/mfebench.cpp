@@ -0,0 +1,299 @@
+/************************************************************************/
+/* Scaling benchmarks on generated networks     				        */
+/* Version:			1.0													*/
+/* Last changed:	18-10-2026                                         	*/
+/*                                                                     	*/
+/* Version History:                                                    	*/
+/*                                                                     	*/
+/* Version Comments:                                                   	*/
+/* - networks come from NetworkGenerator (netgen.h); the hypotheses    	*/
+/*   are the first variables, the evidence the last ones, with values  	*/
+/*   from a forward sample (so the evidence is always possible), and   	*/
+/*   everything in between is intermediate                             	*/
+/* - the shared thread pool is sized once per process, so every thread 	*/
+/*   count runs in a child process of its own; the parent only         	*/
+/*   generates networks and never starts a thread                      	*/
+/* - one CSV row per run (see header()), to be plotted as scaling      	*/
+/*   curves; the same options give the same networks and queries       	*/
+/************************************************************************/
+
+// STL includes
+#include <unistd.h>
+#include <sys/wait.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <cstdlib>
+
+// headers
+#include "mfesim.h"
+#include "netgen.h"
+#include "network.h"
+#include "forward.h"
+#include "rng.h"
+#include "cxxopts.hpp"
+
+// a generated network with its query
+struct Benchmark
+{
+    size_t network;
+    dai::FactorGraph fg;
+    EngineChoice choice;
+    std::vector<unsigned int> hypothesisVars, evidenceVars, evidenceValues, intermediateVars;
+};
+
+// function prototypes
+int main(int argc, char *argv[]);
+static std::string header();
+static Benchmark makeBenchmark(const dai::PropertySet &generator, size_t network, size_t hypotheses, size_t evidence);
+static std::string runBenchmark(const Benchmark &b, const dai::PropertySet &generator, const cxxopts::ParseResult &result, size_t threads);
+static bool runChild(const std::function<std::string()> &child, std::ostream &os);
+
+static std::string header()
+{
+    return "algorithm,nodes,indegree,states,determinism,treewidth,seed,network,threads,engine,width,entries,repetition,ns,error";
+}
+
+static Benchmark makeBenchmark(const dai::PropertySet &generator, size_t network, size_t hypotheses, size_t evidence)
+{
+    Benchmark b;
+    b.network = network;
+    NetworkGenerator gen(generator);
+    for (size_t k = 0; k <= network; k++)
+        b.fg = gen.generate();
+    b.choice = chooseEngine(b.fg, engineOptions("inference",std::string("SUMPROD")));
+    std::string engine = engineOptions.getStringAs<std::string>("engine");
+    if (engine != "AUTO")
+        b.choice.engine = engine;
+    std::replace(b.choice.engine.begin(), b.choice.engine.end(), ',', ';');
+
+    size_t n = b.fg.nrVars();
+    hypotheses = std::min(hypotheses, n);
+    evidence = std::min(evidence, n - hypotheses);
+    for (size_t i = 0; i < hypotheses; i++)
+        b.hypothesisVars.push_back(i);
+    ForwardSampler sampler(b.fg, dai::PropertySet()("threads",(size_t) 1)("seed",generator.getStringAs<size_t>("seed") + network + 1));
+    std::vector<unsigned int> state;
+    sampler.draw(state);
+    for (size_t i = n - evidence; i < n; i++)
+    {
+        b.evidenceVars.push_back(i);
+        b.evidenceValues.push_back(state[i]);
+    }
+    b.intermediateVars = getIntermediateVars(b.fg, b.hypothesisVars, b.evidenceVars);
+    return b;
+}
+
+// the rows of all algorithms on one network with one number of threads (runs in a child process)
+static std::string runBenchmark(const Benchmark &b, const dai::PropertySet &generator, const cxxopts::ParseResult &result, size_t threads)
+{
+    engineOptions.set("threads", threads);
+    setRunSeed(generator.getStringAs<size_t>("seed") + b.network);     // the same random streams for every number of threads
+    std::vector<std::string> algorithms = result["algorithms"].as<std::vector<std::string>>();
+    size_t repeat = result["repeat"].as<unsigned long int>();
+    unsigned long int samples = result["samples"].as<unsigned long int>();
+    unsigned long int samplesRel = result["relevance-samples"].as<unsigned long int>();
+    unsigned long int cutoffTime = result["time"].as<unsigned long int>();
+    std::mt19937 rngen(generator.getStringAs<size_t>("seed"));
+
+    std::vector<unsigned int> testVars(b.intermediateVars.begin(), b.intermediateVars.begin() + std::min((size_t) 3, b.intermediateVars.size()));
+    std::vector<unsigned int> hypValues;
+    std::ostringstream rows;
+    for (auto const& a: algorithms)
+    {
+        for (size_t r = 0; r < repeat; r++)
+        {
+            std::string error;
+            auto start = std::chrono::steady_clock::now();
+            try
+            {
+                if (a == "MAP")
+                    get_map(b.fg, b.hypothesisVars, b.evidenceVars, b.evidenceValues, false);
+                else if (a == "MFE")
+                    compute_MFE(b.fg, b.evidenceVars, b.evidenceValues, b.hypothesisVars, std::vector<unsigned int>(), b.intermediateVars,
+                        false, samplesRel, 0.1, samples, cutoffTime);
+                else if (a == "REL")
+                {
+                    if (b.intermediateVars.empty())
+                        error = "no intermediate variables";
+                    else
+                        relevance(b.fg, b.intermediateVars[0], b.evidenceVars, b.evidenceValues, b.hypothesisVars, b.intermediateVars, samplesRel, rngen);
+                }
+                else if (a == "ANN")
+                    annealed_map(b.fg, b.hypothesisVars, b.evidenceVars, b.evidenceValues, cutoffTime);
+                else if ((a == "WEAK") || (a == "STRONG"))
+                {
+                    // the independence tests take the MAP as their hypothesis values (computed once, not timed)
+                    if (hypValues.empty())
+                    {
+                        std::vector<unsigned long int> map = get_map(b.fg, b.hypothesisVars, b.evidenceVars, b.evidenceValues, false);
+                        hypValues.assign(map.begin(), map.end());
+                        start = std::chrono::steady_clock::now();
+                    }
+                    if (a == "WEAK")
+                        weak_map_indep(b.fg, b.evidenceVars, b.evidenceValues, b.hypothesisVars, hypValues, testVars, cutoffTime);
+                    else
+                        strong_map_indep(b.fg, b.evidenceVars, b.evidenceValues, b.hypothesisVars, hypValues, testVars, cutoffTime);
+                }
+                else
+                    error = "unknown algorithm";
+            }
+            catch (dai::Exception &e)
+            {
+                error = e.what();
+            }
+            auto end = std::chrono::steady_clock::now();
+
+            std::replace(error.begin(), error.end(), ',', ';');
+            std::replace(error.begin(), error.end(), '\n', ' ');
+            rows << a << "," << generator.getStringAs<size_t>("nodes") << "," << generator.getStringAs<size_t>("indegree") << ","
+                 << generator.getStringAs<size_t>("states") << "," << generator.getStringAs<double>("determinism") << ","
+                 << generator.getStringAs<size_t>("treewidth") << "," << generator.getStringAs<size_t>("seed") << "," << b.network << ","
+                 << threads << "," << b.choice.engine << "," << b.choice.width << "," << b.choice.states << "," << r << ",";
+            if (error.empty())
+                rows << std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+            rows << "," << error << std::endl;
+            if (!error.empty())
+                break;
+        }
+    }
+    return rows.str();
+}
+
+// runs child() in a child process and copies what it returns to os; false if the child failed
+static bool runChild(const std::function<std::string()> &child, std::ostream &os)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+        return false;
+    os.flush();
+    pid_t pid = fork();
+    if (pid < 0)
+        return false;
+    if (pid == 0)
+    {
+        close(fds[0]);
+        std::string rows = child();
+        for (size_t done = 0; done < rows.size(); )
+        {
+            ssize_t n = write(fds[1], rows.data() + done, rows.size() - done);
+            if (n <= 0)
+                _exit(1);
+            done += n;
+        }
+        _exit(0);
+    }
+
+    close(fds[1]);
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fds[0], buffer, sizeof(buffer))) > 0)
+        os.write(buffer, n);
+    close(fds[0]);
+    os.flush();
+    int status;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+}
+
+int main(int argc, char *argv[])
+{
+    cxxopts::Options options(argv[0], "Scaling benchmarks of MAP, MFE, relevance, Annealed MAP and MAP independence on generated networks");
+    options.add_options()
+        ("n,nodes", "network sizes (number of variables)", cxxopts::value<std::vector<unsigned long int>>()->default_value("20,40,80"))
+        ("j,threads", "numbers of threads", cxxopts::value<std::vector<unsigned long int>>()->default_value("1"))
+        ("indegree", "most parents per variable", cxxopts::value<unsigned long int>()->default_value("3"))
+        ("states", "most states per variable", cxxopts::value<unsigned long int>()->default_value("2"))
+        ("minstates", "fewest states per variable (default: states)", cxxopts::value<unsigned long int>())
+        ("determinism", "fraction of deterministic CPT rows", cxxopts::value<double>()->default_value("0"))
+        ("treewidth", "bound on the treewidth (0 = none)", cxxopts::value<unsigned long int>()->default_value("0"))
+        ("seed", "seed of the generator", cxxopts::value<unsigned long int>()->default_value("1"))
+        ("networks", "networks per size", cxxopts::value<unsigned long int>()->default_value("1"))
+        ("repeat", "runs per algorithm, network and number of threads", cxxopts::value<unsigned long int>()->default_value("3"))
+        ("a,algorithms", "algorithms: MAP, MFE, REL, ANN, WEAK, STRONG", cxxopts::value<std::vector<std::string>>()->default_value("MAP,MFE,REL,ANN,WEAK,STRONG"))
+        ("H,hypotheses", "number of hypothesis variables (the first variables)", cxxopts::value<unsigned long int>()->default_value("3"))
+        ("E,evidence", "number of evidence variables (the last variables)", cxxopts::value<unsigned long int>()->default_value("3"))
+        ("s,samples", "MFE samples", cxxopts::value<unsigned long int>()->default_value("100"))
+        ("S,relevance-samples", "relevance samples (0 = exact)", cxxopts::value<unsigned long int>()->default_value("10"))
+        ("T,time", "cutoff time in seconds per run", cxxopts::value<unsigned long int>()->default_value("60"))
+        ("engine", "inference engine (see mfesim --help)", cxxopts::value<std::string>()->default_value("JTREE"))
+        ("o,output", "CSV file for the results (default: standard output)", cxxopts::value<std::string>())
+        ("generate", "only write the (first) generated network of the first size to this file (.fg or .fgb)", cxxopts::value<std::string>())
+        ("h,help", "display this help and exit");
+
+    cxxopts::ParseResult result = [&]()
+    {
+        try
+        {
+            return options.parse(argc, argv);
+        }
+        catch (const cxxopts::OptionException& e)
+        {
+            std::cout << "error parsing options: " << e.what() << std::endl;
+            exit(1);
+        }
+    }();
+    if (result.count("help"))
+    {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    engineOptions.set("threads", (size_t) 1);
+    engineOptions.set("engine", result["engine"].as<std::string>());
+    engineOptions.set("maxmem", (size_t) 0);
+    engineOptions.set("circuit", std::string());
+    engineOptions.set("sampler", std::string("UNIFORM"));
+
+    std::ofstream file;
+    if (result.count("output"))
+        file.open(result["output"].as<std::string>().c_str());
+    std::ostream &os = result.count("output") ? static_cast<std::ostream &>(file) : std::cout;
+
+    try
+    {
+        bool failed = false;
+        if (!result.count("generate"))
+            os << header() << std::endl;
+        for (auto nodes: result["nodes"].as<std::vector<unsigned long int>>())
+        {
+            dai::PropertySet generator;
+            generator.set("nodes", (size_t) nodes);
+            generator.set("indegree", (size_t) result["indegree"].as<unsigned long int>());
+            generator.set("states", (size_t) result["states"].as<unsigned long int>());
+            generator.set("minstates", (size_t) (result.count("minstates") ? result["minstates"].as<unsigned long int>() : result["states"].as<unsigned long int>()));
+            generator.set("determinism", result["determinism"].as<double>());
+            generator.set("treewidth", (size_t) result["treewidth"].as<unsigned long int>());
+            generator.set("seed", (size_t) result["seed"].as<unsigned long int>());
+
+            if (result.count("generate"))
+            {
+                writeNetwork(makeBenchmark(generator, 0, 0, 0).fg, result["generate"].as<std::string>(), "generated by mfebench, " + generator.toString());
+                return 0;
+            }
+
+            for (size_t k = 0; k < result["networks"].as<unsigned long int>(); k++)
+            {
+                Benchmark b = makeBenchmark(generator, k, result["hypotheses"].as<unsigned long int>(), result["evidence"].as<unsigned long int>());
+                for (auto threads: result["threads"].as<std::vector<unsigned long int>>())
+                {
+                    if (!runChild([&]() { return runBenchmark(b, generator, result, threads); }, os))
+                    {
+                        std::cerr << "benchmark on network " << k << " of " << nodes << " variables with " << threads << " threads failed" << std::endl;
+                        failed = true;
+                    }
+                }
+            }
+        }
+        return failed ? 1 : 0;
+    }
+    catch (dai::Exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -8,6 +8,8 @@
 #include <set>
 #include <vector>
 #include <map>
+#include <memory>
+#include <functional>
 #include <cstdlib>
 #include <experimental/random>
 #include "dai/alldai.h"  		// Include main libDAI header file
@@ -15,9 +17,9 @@
 #include "dai/jtree.h"
 #include "dai/varset.h"
 #include "dai/index.h"
+#include "engine.h"
 
-// comment for production mode, uncomment for debug messages
-#define DEBUGMODE
+// debug messages are compiled in with make DEBUG=1 (timings are in the metrics, see metrics.h)
 
 #ifdef DEBUGMODE
 	#define DEBUG(a) a;
@@ -25,24 +27,47 @@
 	#define DEBUG(a) ;
 #endif	
 
+// properties passed to every inference engine (e.g. which engine and the number of threads)
+extern dai::PropertySet engineOptions;
+
+// called by the anytime algorithms with their current answer and the number of steps so far: MFE after
+// every vote (the assignment with the most votes), Annealed MAP after every iteration (see profile.h)
+typedef std::function<void(unsigned long int, const std::vector<unsigned long int> &)> SnapshotHook;
+
+// the (weighted) votes of MFE per joint value assignment to the hypotheses
+typedef std::map<std::vector<unsigned long int>, double> VoteTable;
+
 double relevance(dai::FactorGraph fg, unsigned int node, std::vector<unsigned int> evidence_vars, std::vector<unsigned int> evidence_values, 
-	std::vector<unsigned int> hypothesis_vars, std::vector<unsigned int> intermediate_vars, unsigned long int samples, std::mt19937 rngen);
+	std::vector<unsigned int> hypothesis_vars, std::vector<unsigned int> intermediate_vars, unsigned long int samples, std::mt19937 &rngen);
+double relevance(InferenceEngine &jt, unsigned int node, const std::vector<unsigned int> &evidence_vars, const std::vector<unsigned int> &evidence_values, 
+	const std::vector<unsigned int> &hypothesis_vars, const std::vector<unsigned int> &intermediate_vars, unsigned long int samples, std::mt19937 &rngen);
 
 std::vector<unsigned long int> compute_MFE(dai::FactorGraph fg, std::vector<unsigned int> evidenceVars, std::vector<unsigned int> evidenceValues,
 	std::vector<unsigned int> hypothesisVars, std::vector<unsigned int> relevantVars, std::vector<unsigned int> irrelevantVars,
 	bool relevanceComputation, unsigned long int samplesRel, double relThreshold, unsigned long int samples, unsigned long int cutoffTime);
+std::vector<unsigned long int> compute_MFE(const dai::FactorGraph &fg, InferenceEngine &jt, InferenceEngine &mpeTree, const std::vector<unsigned int> &evidenceVars, 
+	const std::vector<unsigned int> &evidenceValues, const std::vector<unsigned int> &hypothesisVars, std::vector<unsigned int> relevantVars, 
+	std::vector<unsigned int> irrelevantVars, bool relevanceComputation, unsigned long int samplesRel, double relThreshold, unsigned long int samples, 
+	double cutoffTime, const SnapshotHook &snapshot = SnapshotHook(), VoteTable *votes = NULL);
 
 std::vector<unsigned long int> get_mpe(dai::FactorGraph fg, std::vector<unsigned int> evidence_vars, std::vector<unsigned int> evidence_values);
+std::vector<unsigned long int> get_mpe(InferenceEngine &jt, const std::vector<unsigned int> &evidence_vars, const std::vector<unsigned int> &evidence_values);
 std::vector<unsigned long int> get_map(dai::FactorGraph fg, std::vector<unsigned int> hypothesis_vars, std::vector<unsigned int> evidence_vars,
 	std::vector<unsigned int> evidence_values, bool mapList);
+std::vector<unsigned long int> get_map(InferenceEngine &jt, const std::vector<unsigned int> &hypothesis_vars, const std::vector<unsigned int> &evidence_vars,
+	const std::vector<unsigned int> &evidence_values, bool mapList);
 std::vector<unsigned long int> prior_map(dai::FactorGraph fg, std::vector<unsigned int> hypothesis_vars);
 std::vector<unsigned long int> local_prior_map(dai::FactorGraph fg, std::vector<unsigned int> hypothesis_vars, 
     std::vector<double>& map_scores);
-std::vector<unsigned int> getIntermediateVars(dai::FactorGraph fg, std::vector<unsigned int> hypothesis_vars, 
-    std::vector<unsigned int> evidence_vars);
+std::vector<unsigned long int> local_prior_map(InferenceEngine &jt, const std::vector<unsigned int> &hypothesis_vars, 
+    std::vector<double>& map_scores);
+std::vector<unsigned int> getIntermediateVars(const dai::FactorGraph &fg, const std::vector<unsigned int> &hypothesis_vars, 
+    const std::vector<unsigned int> &evidence_vars);
 
 std::vector<unsigned long int> annealed_map(dai::FactorGraph fg, std::vector<unsigned int> hypothesis_vars, std::vector<unsigned int> evidence_vars,
 	std::vector<unsigned int> evidence_values, unsigned long int cutoffTime);
+std::vector<unsigned long int> annealed_map(InferenceEngine &jt, const std::vector<unsigned int> &hypothesis_vars, const std::vector<unsigned int> &evidence_vars,
+	const std::vector<unsigned int> &evidence_values, double cutoffTime, const SnapshotHook &snapshot = SnapshotHook());
 
 bool weak_map_indep(dai::FactorGraph fg, std::vector<unsigned int> evidenceVars, std::vector<unsigned int> evidenceValues, 
     std::vector<unsigned int> hypothesisVars, std::vector<unsigned int> hypothesisValues, std::vector<unsigned int> independenceTestVars, unsigned long int cutoffTime);
@@ -50,17 +75,24 @@ bool strong_map_indep(dai::FactorGraph fg, std::vector<unsigned int> evidenceVar
     std::vector<unsigned int> hypothesisVars, std::vector<unsigned int> hypothesisValues, std::vector<unsigned int> independenceTestVars, unsigned long int cutoffTime);
 std::vector<unsigned long int> max_weak_map_indep(dai::FactorGraph fg, std::vector<unsigned int> evidenceVars, std::vector<unsigned int> evidenceValues, 
     std::vector<unsigned int> hypothesisVars, std::vector<unsigned int> hypothesisValues, std::vector<unsigned int> independenceTestVars, unsigned long int cutoffTime);
+std::vector<unsigned long int> max_weak_map_indep(InferenceEngine &jt, const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues, 
+    const std::vector<unsigned int> &hypothesisVars, const std::vector<unsigned int> &hypothesisValues, const std::vector<unsigned int> &independenceTestVars, unsigned long int cutoffTime);
 std::vector<unsigned long int> max_strong_map_indep(dai::FactorGraph fg, std::vector<unsigned int> evidenceVars, std::vector<unsigned int> evidenceValues, 
     std::vector<unsigned int> hypothesisVars, std::vector<unsigned int> hypothesisValues, std::vector<unsigned int> independenceTestVars, unsigned long int cutoffTime);
+std::vector<unsigned long int> max_strong_map_indep(InferenceEngine &jt, const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues, 
+    const std::vector<unsigned int> &hypothesisVars, const std::vector<unsigned int> &hypothesisValues, std::vector<unsigned int> independenceTestVars, unsigned long int cutoffTime);
 double weak_map_indep_measure(dai::FactorGraph fg, std::vector<unsigned int> evidenceVars, std::vector<unsigned int> evidenceValues, 
     std::vector<unsigned int> hypothesisVars, std::vector<unsigned int> hypothesisValues, std::vector<unsigned int> independenceTestVars, 
     unsigned long int cutoffTime, bool decision);
-double weak_map_indep_measure(dai::FactorGraph fg, std::vector<unsigned int> evidenceVars, std::vector<unsigned int> evidenceValues, 
-    std::vector<unsigned int> hypothesisVars, std::vector<unsigned int> hypothesisValues, std::vector<unsigned int> independenceTestVars, 
+double weak_map_indep_measure(InferenceEngine &jt, const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues, 
+    const std::vector<unsigned int> &hypothesisVars, const std::vector<unsigned int> &hypothesisValues, const std::vector<unsigned int> &independenceTestVars, 
     unsigned long int cutoffTime, bool decision);
 double strong_map_indep_measure(dai::FactorGraph fg, std::vector<unsigned int> evidenceVars, std::vector<unsigned int> evidenceValues, 
     std::vector<unsigned int> hypothesisVars, std::vector<unsigned int> hypothesisValues, std::vector<unsigned int> independenceTestVars, 
     unsigned long int cutoffTime, bool decision);
+double strong_map_indep_measure(InferenceEngine &jt, const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues, 
+    const std::vector<unsigned int> &hypothesisVars, const std::vector<unsigned int> &hypothesisValues, const std::vector<unsigned int> &independenceTestVars, 
+    unsigned long int cutoffTime, bool decision);
 
 
 std::ostream& operator<<(std::ostream& os, const std::vector<int> &input);
@@ -69,9 +101,9 @@ std::ostream& operator<<(std::ostream& os, const std::vector<long unsigned int>
 
 void iterate(unsigned int dimensions, unsigned int skip_node, std::vector<unsigned int> &ordinates, std::vector<unsigned int> maximums);
 void random_sample(unsigned int dimensions, unsigned int skip_node, std::vector<unsigned int> &ordinates, std::vector<unsigned int> maximums,
-	 std::mt19937 rngen);
+	 std::mt19937 &rngen);
 
-int sample(dai::Factor fact, double rand);
+int sample(const dai::Factor &fact, double rand);
 double CalculateSpecHeat(const std::vector<double> &scores, const double &temperature, const double &bestScore);
 
 #endif // defined MFESIM
@@ -29,11 +29,26 @@
 
 // headers
 #include "mfesim.h"
+#include "batch.h"
+#include "server.h"
+#include "network.h"
+#include "metrics.h"
+#include "profile.h"
+#include "rng.h"
+#include "plan.h"
+#include "phases.h"
+#include "shard.h"
+#include "store.h"
 #include "cxxopts.hpp"
 
 // global values (with default values)
 std::string inputfile = "./alarm.fg";
 std::string outputfile = "./results";
+std::string batchfile;
+std::string socketPath;
+std::string tracefile;
+std::string flamefile;
+std::string storeDirectory;
 std::vector<unsigned int> independenceTestVars;
 std::vector<unsigned int> hypothesisVars;
 std::vector<unsigned int> evidenceVars;
@@ -56,6 +71,17 @@ bool mfeComputation = false;
 unsigned long int cutoffTime = 3600;
 unsigned long int samples = 100;
 unsigned long int samplesRel = 10;
+unsigned long int threads = 1;
+std::string engine = "JTREE";
+unsigned long int maxmem = 0;
+unsigned long int networks = 8;
+unsigned long int profileQueries = 0;
+unsigned long int profileStep = 10;
+unsigned long int seed = 0;
+unsigned long int shards = 1;
+unsigned long int shardRetries = 1;
+std::string circuit;
+std::string sampler = "UNIFORM";
 double relThreshold = 0.1;
 
 int versionMajor = 1;
@@ -63,6 +89,7 @@ int versionMinor = 2;
 
 // function prototypes
 int main(int argc, char *argv[]);
+static void writeTraces();
 
 // helper function for the command-line-operated program
 cxxopts::ParseResult parse(int argc, char* argv[])
@@ -72,7 +99,7 @@ cxxopts::ParseResult parse(int argc, char* argv[])
     {
         cxxopts::Options options(argv[0], shortdes);
         options.add_options()
-            ("i,input", "factor graph to run simulations on", cxxopts::value<std::string>())
+            ("i,input", "factor graph to run simulations on (.fg, .fgb, .bif, .uai, .xml (XMLBIF) or .net (Hugin))", cxxopts::value<std::string>())
             ("o,output", "output file for simulation results", cxxopts::value<std::string>())
             ("H,hypothesis-variables", "hypothesis variables", cxxopts::value<std::vector<unsigned int>>())
             ("E,evidence-variables", "evidence variables", cxxopts::value<std::vector<unsigned int>>())
@@ -86,10 +113,26 @@ cxxopts::ParseResult parse(int argc, char* argv[])
             ("t,relevance-threshold", "relevance threshold for inclusion", cxxopts::value<double>())
             ("s,samples", "number of samples to take from irrelevant variables", cxxopts::value<unsigned long int>())
             ("T,time", "cutoff time in seconds (0 = will run until big freeze", cxxopts::value<unsigned long int>())
+            ("j,threads", "number of threads used for junction tree propagation (1 = sequential)", cxxopts::value<unsigned long int>())
+            ("engine", "inference engine: AUTO, JTREE (junction tree), LAZY (lazy propagation), CUTSET (cutset conditioning), AC (arithmetic circuit), RBP (parallel residual BP) or a libDAI algorithm (BP, TRWBP, GIBBS, DECMAP, TREEEP, with optional [properties])", cxxopts::value<std::string>())
+            ("circuit", "arithmetic circuit compiled by fg2ac, used by the AC engine", cxxopts::value<std::string>())
+            ("sampler", "sampling of the irrelevant variables in MFE: UNIFORM, STRATIFIED (per variable), QMC (Halton sequence), PRIOR (likelihood-weighted forward sampling from their posterior) or GIBBS (multi-chain Gibbs sampling from their posterior)", cxxopts::value<std::string>())
+            ("maxmem", "memory budget in bytes for junction tree tables; larger trees use cutset conditioning (0 = unlimited, 1 GiB for AUTO)", cxxopts::value<unsigned long int>())
+            ("b,batch", "answer the queries in this file (- = standard input), one per line, with one JSON line per result on standard output (or the output file); exits with 1 if any query failed", cxxopts::value<std::string>())
+            ("serve", "answer JSON requests on this Unix domain socket until stopped (see server.h)", cxxopts::value<std::string>())
+            ("networks", "networks the server keeps loaded", cxxopts::value<unsigned long int>())
+            ("profile", "compare the answers of MFE and Annealed MAP over time with exact MAP on this many random queries, as CSV on standard output (or the output file)", cxxopts::value<unsigned long int>())
+            ("profile-step", "votes between MFE snapshots in --profile", cxxopts::value<unsigned long int>())
+            ("seed", "seed of all random streams of the run, reported in the results (0 = random)", cxxopts::value<unsigned long int>())
+            ("shards", "split MFE (-F) and the maximum strong independence test (-d -M) over this many processes", cxxopts::value<unsigned long int>())
+            ("shard-retries", "times a failed shard is started again", cxxopts::value<unsigned long int>())
+            ("store", "keep MAP, relevance and independence results in this directory and reuse them in later runs (also with --batch and --serve, not with --profile)", cxxopts::value<std::string>())
+            ("trace", "write a timeline of the run to this file as Chrome trace-event JSON (chrome://tracing)", cxxopts::value<std::string>())
+            ("flamegraph", "write the collapsed stacks of the run to this file (input for flamegraph.pl)", cxxopts::value<std::string>())
             ("O,relevance-test", "run relevance test independent of MFE heuristic")
             ("A,annealed", "run Annealed MAP using reported parameters")
             ("M,map", "run exact MAP computation")
-            ("m,map-list", "output all explanations with their probability")
+            ("m,map-list", "output all explanations with their probability (on standard error)")
             ("F,mfe", "run MFE heuristic")
             ("d,strong", "run Strong MAP-independence test")
             ("W,weak", "run Weak MAP-independence test")
@@ -198,6 +241,72 @@ cxxopts::ParseResult parse(int argc, char* argv[])
             DEBUG(std::cout << "Output file: " << outputfile << std::endl)
         }
 
+        if (result.count("batch"))
+        {
+            batchfile = result["batch"].as<std::string>();
+            DEBUG(std::cout << "Batch queries: " << batchfile << std::endl)
+        }
+
+        if (result.count("serve"))
+        {
+            socketPath = result["serve"].as<std::string>();
+            DEBUG(std::cout << "Serving on: " << socketPath << std::endl)
+        }
+
+        if (result.count("networks"))
+        {
+            networks = result["networks"].as<unsigned long int>();
+            DEBUG(std::cout << "Keeping " << networks << " networks loaded" << std::endl)
+        }
+
+        if (result.count("profile"))
+        {
+            profileQueries = result["profile"].as<unsigned long int>();
+            DEBUG(std::cout << "Profiling on " << profileQueries << " queries" << std::endl)
+        }
+
+        if (result.count("profile-step"))
+        {
+            profileStep = result["profile-step"].as<unsigned long int>();
+            DEBUG(std::cout << "Profile snapshot every " << profileStep << " votes" << std::endl)
+        }
+
+        if (result.count("seed"))
+        {
+            seed = result["seed"].as<unsigned long int>();
+            DEBUG(std::cout << "Seed: " << seed << std::endl)
+        }
+
+        if (result.count("shards"))
+        {
+            shards = std::max(1UL, result["shards"].as<unsigned long int>());
+            DEBUG(std::cout << "Shards: " << shards << std::endl)
+        }
+
+        if (result.count("shard-retries"))
+        {
+            shardRetries = result["shard-retries"].as<unsigned long int>();
+            DEBUG(std::cout << "Shard retries: " << shardRetries << std::endl)
+        }
+
+        if (result.count("store"))
+        {
+            storeDirectory = result["store"].as<std::string>();
+            DEBUG(std::cout << "Result store: " << storeDirectory << std::endl)
+        }
+
+        if (result.count("trace"))
+        {
+            tracefile = result["trace"].as<std::string>();
+            DEBUG(std::cout << "Trace file: " << tracefile << std::endl)
+        }
+
+        if (result.count("flamegraph"))
+        {
+            flamefile = result["flamegraph"].as<std::string>();
+            DEBUG(std::cout << "Flamegraph file: " << flamefile << std::endl)
+        }
+
         if (result.count("relevance-computation"))
         {
             relevanceComputation = true;  
@@ -216,6 +325,42 @@ cxxopts::ParseResult parse(int argc, char* argv[])
             DEBUG(std::cout << "Cutoff time " << time << " seconds" << std::endl)
         }
 
+        if (result.count("threads"))
+        {
+            threads = result["threads"].as<unsigned long int>();  
+            DEBUG(std::cout << "Propagating with " << threads << " threads" << std::endl)
+        }
+
+        if (result.count("engine"))
+        {
+            engine = result["engine"].as<std::string>();  
+            DEBUG(std::cout << "Using the " << engine << " inference engine" << std::endl)
+        }
+
+        if (result.count("circuit"))
+        {
+            circuit = result["circuit"].as<std::string>();  
+            DEBUG(std::cout << "Arithmetic circuit " << circuit << std::endl)
+        }
+
+        if (result.count("sampler"))
+        {
+            sampler = result["sampler"].as<std::string>();  
+            std::transform(sampler.begin(), sampler.end(), sampler.begin(), [](unsigned char c) { return std::toupper(c); });
+            if ((sampler != "UNIFORM") && (sampler != "STRATIFIED") && (sampler != "QMC") && (sampler != "PRIOR") && (sampler != "GIBBS"))
+            {
+                std::cout << "error parsing options: unknown sampler " << sampler << std::endl;
+                exit(1);
+            }
+            DEBUG(std::cout << "Sampling irrelevant variables with the " << sampler << " sampler" << std::endl)
+        }
+
+        if (result.count("maxmem"))
+        {
+            maxmem = result["maxmem"].as<unsigned long int>();  
+            DEBUG(std::cout << "Junction tree tables limited to " << maxmem << " bytes" << std::endl)
+        }
+
         if (result.count("relevance-threshold"))
         {
             relThreshold = result["relevance-threshold"].as<double>();  
@@ -297,14 +442,122 @@ cxxopts::ParseResult parse(int argc, char* argv[])
     }
 }
 
+// writes the spans recorded since startTrace() to the trace and flamegraph files
+static void writeTraces()
+{
+    if (!tracefile.empty())
+    {
+        std::ofstream trace(tracefile);
+        writeTrace(trace);
+    }
+    if (!flamefile.empty())
+    {
+        std::ofstream flame(flamefile);
+        writeFlamegraph(flame);
+    }
+}
+
 int main(int argc, char *argv[])
 {
     auto result = parse(argc, argv);
     auto arguments = result.arguments();
 
-   	// random number generator
-   	std::random_device rd;
-    std::mt19937 gen(rd());						// random numbers by Mersenne twister algorithm
+    if ((!tracefile.empty() || !flamefile.empty()) && !startTrace())
+    {
+        std::cout << "tracing needs a build with METRICS=1" << std::endl;
+        exit(1);
+    }
+
+    engineOptions.set("threads", (size_t) threads);
+    engineOptions.set("engine", engine);
+    engineOptions.set("maxmem", (size_t) maxmem);
+    engineOptions.set("circuit", circuit);
+    engineOptions.set("sampler", sampler);
+
+   	// random number generator: every run has a seed, which is reported so the run can be repeated with --seed
+    if (seed != 0)
+        setRunSeed(seed);
+    std::mt19937 gen = taskStream("main");		// random numbers by Mersenne twister algorithm
+
+    // the result store is shared by all modes below that compute MAPs, relevances or independence measures;
+    // the profile mode measures how long they take, which a store would hide
+    if (!storeDirectory.empty() && (profileQueries > 0))
+    {
+        std::cout << "--store cannot be combined with --profile" << std::endl;
+        exit(1);
+    }
+    std::unique_ptr<ResultStore> store;
+    if (!storeDirectory.empty())
+        store.reset(new ResultStore(storeDirectory));
+
+    // server mode: requests name their own network, so no input file is read here
+    if (!socketPath.empty())
+    {
+        // the requests answered at the same time and the engines they build share the threads (see server.h)
+        ExplanationServer server(engineOptions("socket", socketPath)("networks", (size_t) networks), store.get());
+        engineOptions.set("threads", server.engineThreads());
+        server.serve();
+        return 0;
+    }
+
+    // batch mode: the network is read once and all queries are answered with the same engines
+    if (!batchfile.empty())
+    {
+        NetworkNames names;
+        dai::FactorGraph fg = readNetwork(inputfile, &names);
+        QuerySession session(fg, names, 65536, store.get());
+
+        // the command line settings are the defaults of every query
+        Query defaults;
+        defaults.samples = samples;
+        defaults.samplesRel = samplesRel;
+        defaults.relThreshold = relThreshold;
+        defaults.cutoffTime = cutoffTime;
+
+        std::ifstream queries;
+        if (batchfile != "-")
+        {
+            queries.open(batchfile.c_str());
+            if (!queries)
+            {
+                std::cout << "cannot read queries from " << batchfile << std::endl;
+                return 1;
+            }
+        }
+        std::ofstream results;
+        if (result.count("output"))
+            results.open(outputfile.c_str(), std::ofstream::out | std::ofstream::app);
+
+        // a pipeline can tell from the exit status that some queries failed (their lines hold the error)
+        size_t failed = runBatch(session, defaults, (batchfile == "-") ? std::cin : static_cast<std::istream &>(queries),
+            result.count("output") ? static_cast<std::ostream &>(results) : std::cout);
+        std::cerr << "seed " << runSeed() << std::endl;
+        if (failed > 0)
+            std::cerr << failed << " queries failed" << std::endl;
+        if (store)
+            std::cerr << "store " << session.stored() << " results found in " << storeDirectory << " (" << store->size() << " stored)" << std::endl;
+        dumpMetrics(std::cerr);         // the results are one JSON object per line, so the metrics go elsewhere
+        writeTraces();
+        return (failed > 0) ? 1 : 0;
+    }
+
+    // profile mode: quality versus time of the anytime algorithms on random queries (see profile.h)
+    if (profileQueries > 0)
+    {
+        dai::FactorGraph fg = readNetwork(inputfile);
+        std::ofstream results;
+        if (result.count("output"))
+            results.open(outputfile.c_str(), std::ofstream::out | std::ofstream::app);
+
+        // -H and -E fix the hypothesis and evidence variables; without them every query draws its own
+        std::ostream &os = result.count("output") ? static_cast<std::ostream &>(results) : std::cout;
+        os << "# seed " << runSeed() << std::endl;
+        runProfile(fg, hypothesisVars, evidenceVars, engineOptions("queries",(size_t) profileQueries)("step",(size_t) profileStep)
+            ("samples",(size_t) samples)("time",(size_t) cutoffTime)("seed",(size_t) runSeed()), os);
+        dumpMetrics(std::cerr);
+        writeTraces();
+        return 0;
+    }
 
     // run an example of the computaions
 	if (exampleComputation)
@@ -321,11 +574,13 @@ int main(int argc, char *argv[])
 		std::vector<unsigned int> ex_relevantVars;
 		std::vector<unsigned int> ex_irrelevantVars;
 
+		std::unique_ptr<InferenceEngine> mpeTree(newEngine(fg, engineOptions("inference",std::string("MAXPROD"))));
+
 	    for (auto inter = ex_intermediateVars.begin(); inter != ex_intermediateVars.end(); ++inter)
 		{
     	    std::cout << "Relevance of " << *inter << " using 1000 samples equals ";
 			auto start = std::chrono::steady_clock::now();
-			double rel = relevance(fg, *inter, ex_evidenceVars, ex_evidenceValues, ex_hypothesisVars, ex_intermediateVars, 1000UL, gen);
+			double rel = relevance(*mpeTree, *inter, ex_evidenceVars, ex_evidenceValues, ex_hypothesisVars, ex_intermediateVars, 1000UL, gen);
 			if (rel > 0.01) ex_relevantVars.push_back(*inter);
 			else ex_irrelevantVars.push_back(*inter);
 			auto end = std::chrono::steady_clock::now();
@@ -368,8 +623,7 @@ int main(int argc, char *argv[])
 	}
 
 	time_t now = time(0);
-   	dai::FactorGraph fg;
-   	fg.ReadFromFile(inputfile.c_str());
+   	dai::FactorGraph fg = readNetwork(inputfile);
 
 	std::ofstream ofs;
 	ofs.open (outputfile.c_str(), std::ofstream::out | std::ofstream::app);
@@ -377,161 +631,212 @@ int main(int argc, char *argv[])
 	ofs << std::endl << "command: ";
     for (int i = 0; i < argc; i++)
         ofs << argv[i] << " ";
-    ofs << std::endl;
+    ofs << std::endl << "seed " << runSeed() << std::endl;
 
 	ofs << inputfile << " simulation results " << ctime(&now) << std::endl;
 	ofs << "hypothesis vars " << hypothesisVars << std::endl;
 	ofs << "evidence vars " << evidenceVars << " values " << evidenceValues << std::endl;
-    intermediateVars = getIntermediateVars(fg, hypothesisVars, evidenceVars);
+
+    // the algorithms below share their engines, the MAP and the relevances through one plan (see plan.h)
+    QueryPlan plan(fg, hypothesisVars, evidenceVars, evidenceValues, store.get());
+    intermediateVars = plan.intermediateVars();
 	ofs << "intermediate vars " << intermediateVars << std::endl;
+	ofs << "engine (marginals) " << chooseEngine(fg, engineOptions("inference",std::string("SUMPROD"))) << std::endl;
+	ofs << "engine (MPE) " << chooseEngine(fg, engineOptions("inference",std::string("MAXPROD"))) << std::endl;
     if ((strongMapIndep) || (weakMapIndep))
     	ofs << "independence test vars " << independenceTestVars << std::endl;
 
+    // the phases below only read the network and the query: with more than one thread they run at the same
+    // time, each with the cutoff time as its budget, and their sections are written in this order (see phases.h);
+    // the phases and the engines they build share the threads. Shards are forked from the main thread, so a
+    // sharded run keeps the phases in sequence (see shard.h)
+    PhaseScheduler phases((shards > 1) ? 1 : threads);
+    ForkTransport transport;
+
     // compute strong independence
     if (strongMapIndep)
     {
-    	ofs << std::endl << "[STRONG] Strong MAP independence of subset of intermediate vars" << std::endl;
-        std::vector<unsigned long int> map = get_map(fg, hypothesisVars, evidenceVars, evidenceValues, false);
-        std::vector<unsigned int> hypValues;
-        for (const unsigned long int &e: map) { hypValues.push_back((unsigned int) e); }
-        std::vector<unsigned long int> strong;
-        double q = 0.0;
-
-   	    ofs << "[STRONG] ";
-
-   		auto start = std::chrono::steady_clock::now();
-        if ((quantifiedMapIndep == true) && (maxMapIndep == false))
-        {
-            q = strong_map_indep_measure(fg, evidenceVars, evidenceValues, hypothesisVars, hypValues, independenceTestVars, cutoffTime, false);
-            ofs << "quantified: " << q;
-        }
-        else if ((quantifiedMapIndep == false) && (maxMapIndep == true))
-        {
-            strong = max_strong_map_indep(fg, evidenceVars, evidenceValues, hypothesisVars, hypValues, independenceTestVars, cutoffTime);
-            ofs << "maximum independent set " << strong;
-        }        
-        else if ((quantifiedMapIndep == false) && (maxMapIndep == false))
-        {
-            ofs << strong_map_indep(fg, evidenceVars, evidenceValues, hypothesisVars, hypValues, independenceTestVars, cutoffTime);
-        }
-        else
+        phases.add("STRONG", cutoffTime, [&](std::ostream &ofs)
         {
-      		ofs << "illegal combination of switches!" << std::endl;
-        }   		
-   		auto end = std::chrono::steady_clock::now();
-
-        ofs << std::endl;
-  		ofs << "[STRONG] Computation took " << std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() << " ns" << std::endl;
+        	ofs << std::endl << "[STRONG] Strong MAP independence of subset of intermediate vars" << std::endl;
+            std::vector<unsigned int> hypValues = plan.mapValues();
+            std::vector<unsigned long int> strong;
+            double q = 0.0;
+
+       	    ofs << "[STRONG] ";
+
+       		auto start = std::chrono::steady_clock::now();
+            if ((quantifiedMapIndep == true) && (maxMapIndep == false))
+            {
+                q = plan.independence(true, independenceTestVars, cutoffTime, false);
+                ofs << "quantified: " << q;
+            }
+            else if ((quantifiedMapIndep == false) && (maxMapIndep == true))
+            {
+                if (shards > 1)
+                    strong = sharded_max_strong_map_indep(fg, evidenceVars, evidenceValues, hypothesisVars, hypValues, independenceTestVars, cutoffTime,
+                        shards, shardRetries, transport);
+                else
+                    strong = max_strong_map_indep(*plan.sumEngine(), evidenceVars, evidenceValues, hypothesisVars, hypValues, independenceTestVars, cutoffTime);
+                ofs << "maximum independent set " << strong;
+            }        
+            else if ((quantifiedMapIndep == false) && (maxMapIndep == false))
+            {
+                ofs << (plan.independence(true, independenceTestVars, cutoffTime, true) == 1.0);
+            }
+            else
+            {
+          		ofs << "illegal combination of switches!" << std::endl;
+            }   		
+       		auto end = std::chrono::steady_clock::now();
+
+            ofs << std::endl;
+      		ofs << "[STRONG] Computation took " << std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() << " ns" << std::endl;
+        });
     }
 
     // compute weak independence
     if (weakMapIndep)
     {
-    	ofs << std::endl << "[WEAK] Weak MAP independence of subset of intermediate vars" << std::endl;
-        std::vector<unsigned long int> map = get_map(fg, hypothesisVars, evidenceVars, evidenceValues, false);
-        std::vector<unsigned int> hypValues;
-        for (const unsigned long int &e: map) { hypValues.push_back((unsigned int) e); }
-        std::vector<unsigned long int> weak;
-        double q = 0.0;
-
-   	    ofs << "[WEAK] ";
-
-   		auto start = std::chrono::steady_clock::now();
-        if ((quantifiedMapIndep == true) && (maxMapIndep == false))
-        {
-            q = weak_map_indep_measure(fg, evidenceVars, evidenceValues, hypothesisVars, hypValues, independenceTestVars, cutoffTime, false);
-            ofs << "quantified: " << q;
-        }
-        else if ((quantifiedMapIndep == false) && (maxMapIndep == true))
-        {
-            weak = max_weak_map_indep(fg, evidenceVars, evidenceValues, hypothesisVars, hypValues, independenceTestVars, cutoffTime);
-            ofs << "maximum independent set " << weak;
-        }        
-        else if ((quantifiedMapIndep == false) && (maxMapIndep == false))
-        {
-            ofs << weak_map_indep(fg, evidenceVars, evidenceValues, hypothesisVars, hypValues, independenceTestVars, cutoffTime);
-        }
-        else
+        phases.add("WEAK", cutoffTime, [&](std::ostream &ofs)
         {
-      		ofs << "illegal combination of switches!" << std::endl;
-        }   		
-   		auto end = std::chrono::steady_clock::now();
-
-        ofs << std::endl;
-  		ofs << "[WEAK] Computation took " << std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() << " ns" << std::endl;
+        	ofs << std::endl << "[WEAK] Weak MAP independence of subset of intermediate vars" << std::endl;
+            std::vector<unsigned int> hypValues = plan.mapValues();
+            std::vector<unsigned long int> weak;
+            double q = 0.0;
+
+       	    ofs << "[WEAK] ";
+
+       		auto start = std::chrono::steady_clock::now();
+            if ((quantifiedMapIndep == true) && (maxMapIndep == false))
+            {
+                q = plan.independence(false, independenceTestVars, cutoffTime, false);
+                ofs << "quantified: " << q;
+            }
+            else if ((quantifiedMapIndep == false) && (maxMapIndep == true))
+            {
+                weak = max_weak_map_indep(*plan.sumEngine(), evidenceVars, evidenceValues, hypothesisVars, hypValues, independenceTestVars, cutoffTime);
+                ofs << "maximum independent set " << weak;
+            }        
+            else if ((quantifiedMapIndep == false) && (maxMapIndep == false))
+            {
+                ofs << (plan.independence(false, independenceTestVars, cutoffTime, true) == 1.0);
+            }
+            else
+            {
+          		ofs << "illegal combination of switches!" << std::endl;
+            }   		
+       		auto end = std::chrono::steady_clock::now();
+
+            ofs << std::endl;
+      		ofs << "[WEAK] Computation took " << std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() << " ns" << std::endl;
+        });
     }
 
     // compute relevance (independent of MFE heuristic)
     if (relevanceComputationStandalone)
     {
-    	ofs << std::endl << "[REL] Relevance assessment of intermediate vars" << std::endl;
-
-        for (auto inter = intermediateVars.begin(); inter != intermediateVars.end(); ++inter)
-		{
-    	    ofs << "[REL] Relevance of " << *inter << " using " << samplesRel << " samples equals ";
-			auto start = std::chrono::steady_clock::now();
-			double rel = relevance(fg, *inter, evidenceVars, evidenceValues, hypothesisVars, intermediateVars, 
-                samplesRel, gen);
-			auto end = std::chrono::steady_clock::now();
-    	    ofs << rel << std::endl;
-			ofs << "[REL] Computation took " << std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() << " ns" << std::endl;
-		}
+        phases.add("REL", cutoffTime, [&](std::ostream &ofs)
+        {
+        	ofs << std::endl << "[REL] Relevance assessment of intermediate vars" << std::endl;
+
+            for (auto inter = intermediateVars.begin(); inter != intermediateVars.end(); ++inter)
+    		{
+        	    ofs << "[REL] Relevance of " << *inter << " using " << samplesRel << " samples equals ";
+    			auto start = std::chrono::steady_clock::now();
+    			double rel = plan.relevance(*inter, samplesRel);
+    			auto end = std::chrono::steady_clock::now();
+        	    ofs << rel << std::endl;
+    			ofs << "[REL] Computation took " << std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() << " ns" << std::endl;
+    		}
+        });
     }
 
     // compute exact MAP
     if (mapComputation)
     {
- 		ofs << std::endl << "[MAP] MAP explanation of the hypotheses given the evidence is: ";
+        phases.add("MAP", cutoffTime, [&](std::ostream &ofs)
+        {
+     		ofs << std::endl << "[MAP] MAP explanation of the hypotheses given the evidence is: ";
 
-   		auto start = std::chrono::steady_clock::now();
-   		std::vector<unsigned long int> map = get_map(fg, hypothesisVars, evidenceVars, evidenceValues, mapList);
-   		auto end = std::chrono::steady_clock::now();
+       		auto start = std::chrono::steady_clock::now();
+       		std::vector<unsigned long int> map = mapList ? get_map(*plan.sumEngine(), hypothesisVars, evidenceVars, evidenceValues, true) : plan.map();
+       		auto end = std::chrono::steady_clock::now();
 
-   	    ofs << map << std::endl;
-  		ofs << "[MAP] Computation took " << std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() << " ns" << std::endl;
+       	    ofs << map << std::endl;
+      		ofs << "[MAP] Computation took " << std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() << " ns" << std::endl;
+        });
     }
 
     // compute annealed MAP (using parameters reported in Yuan et al., 2004)
     if (annealedComputation)
     {
-  		ofs << std::endl << "[ANN] Annealed MAP approximation gives: ";
+        phases.add("ANN", cutoffTime, [&](std::ostream &ofs)
+        {
+      		ofs << std::endl << "[ANN] Annealed MAP approximation gives: ";
 
-   		auto start = std::chrono::steady_clock::now();
-   		std::vector<unsigned long int> a_map = annealed_map(fg, hypothesisVars, evidenceVars, evidenceValues, cutoffTime);
-   		auto end = std::chrono::steady_clock::now();
+       		auto start = std::chrono::steady_clock::now();
+       		std::vector<unsigned long int> a_map = annealed_map(*plan.sumEngine(), hypothesisVars, evidenceVars, evidenceValues, cutoffTime);
+       		auto end = std::chrono::steady_clock::now();
 
-   	    ofs << a_map << std::endl;
-   		ofs << "[ANN] Computation took " << std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() << " ns" << std::endl;
+       	    ofs << a_map << std::endl;
+       		ofs << "[ANN] Computation took " << std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() << " ns" << std::endl;
+        });
     }
 
     // compute Most Frugal Explanation (Kwisthout, 2015)
     if (mfeComputation)
     {
-		if (relevanceComputation)
-		{
-			ofs << std::endl << "[MFE] relevance of intermediate vars assessed using " << samplesRel << " samples" << std::endl;
-			
-			// all intermediate variables are irrelevant for now
-            irrelevantVars = intermediateVars;
-		}
-		else
-		{
-			ofs << std::endl << "[MFE] relevant vars " << relevantVars << std::endl;
-			ofs << "[MFE] irrelevant vars " << irrelevantVars << std::endl;
-		}
-
-	    ofs << std::endl << "[MFE] MFE of the hypotheses given the evidence based on " << samples << " samples is: ";
-
-   		auto start = std::chrono::steady_clock::now();
-    	std::vector<unsigned long int> mfe = compute_MFE(fg, evidenceVars, evidenceValues, hypothesisVars, relevantVars, irrelevantVars,
-    		relevanceComputation, samplesRel, relThreshold, samples, cutoffTime);
-   		auto end = std::chrono::steady_clock::now();
-
-        ofs << mfe << std::endl;
-    	ofs << "[MFE] Computation took " << std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() << " ns" << std::endl;
+        phases.add("MFE", cutoffTime, [&](std::ostream &ofs)
+        {
+    		if (relevanceComputation)
+    		{
+    			ofs << std::endl << "[MFE] relevance of intermediate vars assessed using " << samplesRel << " samples" << std::endl;
+    		}
+    		else
+    		{
+    			ofs << std::endl << "[MFE] relevant vars " << relevantVars << std::endl;
+    			ofs << "[MFE] irrelevant vars " << irrelevantVars << std::endl;
+    		}
+
+    	    ofs << std::endl << "[MFE] MFE of the hypotheses given the evidence based on " << samples << " samples is: ";
+
+       		auto start = std::chrono::steady_clock::now();
+    		if (relevanceComputation)
+    			plan.splitRelevant(samplesRel, relThreshold, relevantVars, irrelevantVars);
+            std::vector<unsigned long int> mfe;
+            if (shards > 1)
+                mfe = sharded_MFE(fg, evidenceVars, evidenceValues, hypothesisVars, relevantVars, irrelevantVars, samples, cutoffTime,
+                    shards, shardRetries, transport);
+            else
+            {
+                std::shared_ptr<InferenceEngine> jt = plan.sumEngine();
+                mfe = compute_MFE(fg, *jt, *jt, evidenceVars, evidenceValues, hypothesisVars, relevantVars, irrelevantVars, false,
+                    samplesRel, relThreshold, samples, cutoffTime);
+            }
+       		auto end = std::chrono::steady_clock::now();
+
+            ofs << mfe << std::endl;
+        	ofs << "[MFE] Computation took " << std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() << " ns" << std::endl;
+        });
 	}
  
+    // forking needs a process without other threads, so in a sharded run the engines of the plan (the MAP and
+    // the relevances, before the shards start) propagate on the main thread
+    engineOptions.set("threads", (shards > 1) ? (size_t) 1 : phases.engineThreads());
+    phases.run(ofs);
+
     ofs << std::endl;
+    if (plan.reused() > 0)
+    {
+        ofs << "[PLAN] " << plan.reused() << " results shared between algorithms" << std::endl << std::endl;
+    }
+    if (store)
+    {
+        ofs << "[STORE] " << plan.stored() << " results found in " << storeDirectory << " (" << store->size() << " stored)" << std::endl << std::endl;
+    }
+	dumpMetrics(ofs);
 	ofs.close();
+	writeTraces();
     return 0;
 }
@@ -0,0 +1,103 @@
+/************************************************************************/
+/* Random Bayesian network generator          					        */
+/* Version:			1.0													*/
+/* Last changed:	18-10-2026                                         	*/
+/*                                                                     	*/
+/* Version History:                                                    	*/
+/*                                                                     	*/
+/* Version Comments:                                                   	*/
+/* - uniform rows on the simplex are normalized exponential draws      	*/
+/*   (a flat Dirichlet distribution).                                  	*/
+/* - successive calls to generate() give different networks; a new     	*/
+/*   generator with the same seed repeats them.                        	*/
+/************************************************************************/
+
+// headers
+#include <algorithm>
+#include <string>
+#include "netgen.h"
+#include "netparse.h"
+
+NetworkGenerator::NetworkGenerator(const dai::PropertySet &opts) : props()
+{
+    props.nodes = 20;
+    if (opts.hasKey("nodes"))
+        props.nodes = opts.getStringAs<size_t>("nodes");
+    props.indegree = 3;
+    if (opts.hasKey("indegree"))
+        props.indegree = opts.getStringAs<size_t>("indegree");
+    props.states = 2;
+    if (opts.hasKey("states"))
+        props.states = opts.getStringAs<size_t>("states");
+    props.minstates = props.states;
+    if (opts.hasKey("minstates"))
+        props.minstates = opts.getStringAs<size_t>("minstates");
+    props.determinism = 0.0;
+    if (opts.hasKey("determinism"))
+        props.determinism = opts.getStringAs<double>("determinism");
+    props.treewidth = 0;
+    if (opts.hasKey("treewidth"))
+        props.treewidth = opts.getStringAs<size_t>("treewidth");
+    props.seed = 1;
+    if (opts.hasKey("seed"))
+        props.seed = opts.getStringAs<size_t>("seed");
+
+    if ((props.nodes == 0) || (props.minstates < 2) || (props.minstates > props.states))
+        DAI_THROWE(RUNTIME_ERROR, "A generated network needs at least one variable and 2 <= minstates <= states");
+    if ((props.determinism < 0.0) || (props.determinism > 1.0))
+        DAI_THROWE(RUNTIME_ERROR, "determinism must lie between 0 and 1");
+    std::seed_seq seq = { props.seed };
+    _rng.seed(seq);
+}
+
+dai::FactorGraph NetworkGenerator::generate(NetworkNames *names)
+{
+    NetworkBuilder builder("generated network");
+    std::uniform_int_distribution<size_t> cardinality(props.minstates, props.states);
+    for (size_t i = 0; i < props.nodes; i++)
+    {
+        std::vector<std::string> states(cardinality(_rng));
+        for (size_t s = 0; s < states.size(); s++)
+            states[s] = "s" + std::to_string(s);
+        builder.addVariable("X" + std::to_string(i), states);
+    }
+
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::exponential_distribution<double> exponential(1.0);
+    for (size_t i = 0; i < props.nodes; i++)
+    {
+        // parents: a random subset of the window before i
+        size_t first = ((props.treewidth > 0) && (i > props.treewidth)) ? i - props.treewidth : 0;
+        std::vector<size_t> window;
+        for (size_t j = first; j < i; j++)
+            window.push_back(j);
+        std::shuffle(window.begin(), window.end(), _rng);
+        size_t most = std::min(props.indegree, window.size());
+        size_t k = (most == 0) ? 0 : std::uniform_int_distribution<size_t>(1, most)(_rng);
+        std::vector<size_t> vars(window.begin(), window.begin() + k);
+        std::sort(vars.begin(), vars.end());
+        vars.push_back(i);
+
+        // the CPT in row-major order: one row per parent configuration, the child changing fastest
+        size_t rows = 1, card = builder.states(i).size();
+        for (size_t p = 0; p + 1 < vars.size(); p++)
+            rows *= builder.states(vars[p]).size();
+        std::vector<dai::Real> values(rows * card);
+        for (size_t r = 0; r < rows; r++)
+        {
+            dai::Real *row = &values[r * card];
+            if (uniform(_rng) < props.determinism)
+                row[std::uniform_int_distribution<size_t>(0, card - 1)(_rng)] = 1.0;
+            else
+            {
+                dai::Real sum = 0.0;
+                for (size_t s = 0; s < card; s++)
+                    sum += (row[s] = exponential(_rng));
+                for (size_t s = 0; s < card; s++)
+                    row[s] /= sum;
+            }
+        }
+        builder.addFactor(vars, values);
+    }
+    return builder.build(names);
+}
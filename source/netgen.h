@@ -0,0 +1,41 @@
+#ifndef NETGENHEADER
+#define NETGENHEADER
+
+// STL includes
+#include <vector>
+#include <random>
+#include "dai/factorgraph.h"
+#include "dai/properties.h"
+#include "network.h"
+
+// Random Bayesian networks for benchmarks. Variable i gets its parents among the variables before it, so
+// the variable order is a topological order. With a treewidth bound w the parents of i are taken from
+// i - w, ..., i - 1 only: every edge of the moral graph then joins variables at most w apart, so the
+// treewidth is at most w (and the largest junction tree clique at most w + 1 variables). Every CPT row is,
+// with probability 'determinism', deterministic (one state has probability 1), and drawn uniformly from
+// the probability simplex otherwise. The same properties give the same network on every platform with
+// the same standard library.
+class NetworkGenerator
+{
+    public:
+        struct Properties
+        {
+            size_t nodes;           // number of variables
+            size_t indegree;        // most parents per variable (every variable after the first has at least one)
+            size_t states;          // most states per variable
+            size_t minstates;       // fewest states per variable (default: states)
+            double determinism;     // fraction of deterministic CPT rows
+            size_t treewidth;       // bound on the treewidth, 0 = none
+            size_t seed;
+        } props;
+
+        explicit NetworkGenerator(const dai::PropertySet &opts);
+
+        // a new network (variables X0, X1, ... with states s0, s1, ...) and its names
+        dai::FactorGraph generate(NetworkNames *names = NULL);
+
+    private:
+        std::mt19937 _rng;
+};
+
+#endif // defined NETGENHEADER
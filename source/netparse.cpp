@@ -0,0 +1,497 @@
+/************************************************************************/
+/* Parsers of the network formats              					        */
+/* Version:			1.0													*/
+/* Last changed:	18-10-2026                                         	*/
+/*                                                                     	*/
+/* Version History:                                                    	*/
+/*                                                                     	*/
+/* Version Comments:                                                   	*/
+/* - UAI has no names: variable i is called "i", its states "0", "1"..  */
+/* - XMLBIF and Hugin tables are ordered as the given/parent variables  */
+/*   followed by the child, the last changing fastest                   */
+/* - Hugin: only discrete chance nodes with one child per potential;    */
+/*   classes (OOBNs), decision and utility nodes are rejected           */
+/************************************************************************/
+
+// headers
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include "netparse.h"
+
+std::string readText(const std::string &path)
+{
+    std::ifstream is(path.c_str(), std::ios::binary | std::ios::ate);
+    if (!is)
+        DAI_THROWE(CANNOT_READ_FILE, "Cannot read from file " + path);
+    std::string text((size_t) is.tellg(), '\0');
+    is.seekg(0);
+    is.read(&text[0], text.size());
+    if (!is)
+        DAI_THROWE(CANNOT_READ_FILE, "Cannot read from file " + path);
+    return text;
+}
+
+NetworkLexer::NetworkLexer(const std::string &text, const std::string &source, const char *separators, const char *comment) :
+    _pos(text.c_str()), _end(text.c_str() + text.size()), _line(1), _source(source), _separators(separators), _comment(comment),
+    _tok(text.c_str()), _len(0)
+{
+}
+
+bool NetworkLexer::isSeparator(char c) const
+{
+    return (c != '\0') && (_separators.find(c) != std::string::npos);
+}
+
+bool NetworkLexer::next()
+{
+    size_t commentLength = _comment.size();
+    while (_pos < _end)
+    {
+        if (*_pos == '\n')
+        {
+            _line++;
+            _pos++;
+        }
+        else if (std::isspace((unsigned char) *_pos))
+            _pos++;
+        else if ((commentLength > 0) && ((size_t) (_end - _pos) >= commentLength) && (std::memcmp(_pos, _comment.data(), commentLength) == 0))
+            while ((_pos < _end) && (*_pos != '\n'))
+                _pos++;
+        else if ((_comment == "//") && (*_pos == '/') && (_pos + 1 < _end) && (_pos[1] == '*'))
+        {
+            for (_pos += 2; (_pos + 1 < _end) && !((_pos[0] == '*') && (_pos[1] == '/')); _pos++)
+                if (*_pos == '\n')
+                    _line++;
+            _pos = std::min(_end, _pos + 2);
+        }
+        else
+            break;
+    }
+
+    _tok = _pos;
+    if (_pos >= _end)
+        _len = 0;
+    else if (isSeparator(*_pos))
+        _pos++;
+    else if (*_pos == '"')
+    {
+        for (_pos++; (_pos < _end) && (*_pos != '"'); _pos++)
+            if (*_pos == '\n')
+                _line++;
+        _pos = std::min(_end, _pos + 1);
+    }
+    else
+        while ((_pos < _end) && !std::isspace((unsigned char) *_pos) && !isSeparator(*_pos) && (*_pos != '"'))
+            _pos++;
+    _len = _pos - _tok;
+    return (_len > 0);
+}
+
+bool NetworkLexer::is(const char *s) const
+{
+    return (std::strlen(s) == _len) && (std::memcmp(_tok, s, _len) == 0);
+}
+
+bool NetworkLexer::number(double &x) const
+{
+    char *end;
+    x = std::strtod(_tok, &end);
+    return (_len > 0) && (end == _tok + _len);
+}
+
+bool NetworkLexer::count(size_t &n) const
+{
+    char *end;
+    if ((_len == 0) || !std::isdigit((unsigned char) *_tok))
+        return false;
+    n = std::strtoul(_tok, &end, 10);
+    return (end == _tok + _len);
+}
+
+void NetworkLexer::fail(const std::string &message) const
+{
+    DAI_THROWE(INVALID_FACTORGRAPH_FILE, _source + ":" + std::to_string(_line) + ": " + message);
+}
+
+void NetworkLexer::expect(const char *s)
+{
+    if (!next() || !is(s))
+        fail(std::string("expected '") + s + "'" + (_len ? " instead of '" + text() + "'" : ""));
+}
+
+std::string NetworkLexer::name()
+{
+    if (!next() || separator())
+        fail("expected a name" + (_len ? " instead of '" + text() + "'" : std::string()));
+    return (*_tok == '"') ? std::string(_tok + 1, std::max((size_t) 2, _len) - 2) : text();
+}
+
+void NetworkLexer::skipStatement()
+{
+    while (next() && !is(";"))
+        ;
+}
+
+size_t NetworkBuilder::addVariable(const std::string &name, const std::vector<std::string> &states)
+{
+    if (states.empty())
+        DAI_THROWE(INVALID_FACTORGRAPH_FILE, _source + ": variable '" + name + "' has no states");
+    if (!_names.index.insert(std::make_pair(name, _names.variables.size())).second)
+        DAI_THROWE(INVALID_FACTORGRAPH_FILE, _source + ": variable '" + name + "' is declared twice");
+    _names.variables.push_back(name);
+    _names.states.push_back(states);
+    return _names.variables.size() - 1;
+}
+
+size_t NetworkBuilder::find(const std::string &name) const
+{
+    auto v = _names.index.find(name);
+    return (v == _names.index.end()) ? NetworkNames::npos : v->second;
+}
+
+void NetworkBuilder::addFactor(const std::vector<size_t> &vars, const std::vector<dai::Real> &values)
+{
+    // strides of the variables in the libDAI table (sorted by label, the first changing fastest)
+    std::vector<size_t> sorted(vars), stride(vars.size()), card(vars.size());
+    std::sort(sorted.begin(), sorted.end());
+    if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end())
+        DAI_THROWE(INVALID_FACTORGRAPH_FILE, _source + ": variable '" + name(*std::adjacent_find(sorted.begin(), sorted.end())) + "' appears twice in a factor");
+    size_t total = 1;
+    std::vector<dai::Var> dvars;
+    for (auto v: sorted)
+    {
+        size_t k = std::find(vars.begin(), vars.end(), v) - vars.begin();
+        stride[k] = total;
+        card[k] = states(v).size();
+        total *= card[k];
+        dvars.push_back(dai::Var(v, card[k]));
+    }
+    if (values.size() != total)
+        DAI_THROWE(INVALID_FACTORGRAPH_FILE, _source + ": factor of '" + name(vars.back()) + "' has " + std::to_string(values.size()) + " entries instead of " + std::to_string(total));
+
+    // walk the row-major order as an odometer, keeping the libDAI offset up to date
+    std::vector<dai::Real> table(total);
+    std::vector<size_t> state(vars.size(), 0);
+    size_t offset = 0;
+    for (size_t r = 0; r < total; r++)
+    {
+        table[offset] = values[r];
+        for (size_t k = vars.size(); k-- > 0; )
+        {
+            offset += stride[k];
+            if (++state[k] < card[k])
+                break;
+            offset -= state[k] * stride[k];
+            state[k] = 0;
+        }
+    }
+    _factors.push_back(dai::Factor(dai::VarSet(dvars.begin(), dvars.end(), dvars.size()), table));
+}
+
+dai::FactorGraph NetworkBuilder::build(NetworkNames *names)
+{
+    std::vector<bool> used(nrVars(), false);
+    for (auto const& f: _factors)
+        for (auto const& v: f.vars())
+            used[v.label()] = true;
+    for (size_t i = 0; i < nrVars(); i++)
+        if (!used[i])
+            _factors.push_back(dai::Factor(dai::Var(i, states(i).size()), 1.0));
+
+    if (names != NULL)
+        *names = _names;
+    return dai::FactorGraph(_factors);
+}
+
+dai::FactorGraph parseUai(const std::string &text, const std::string &source, NetworkNames *names)
+{
+    NetworkLexer lex(text, source, "", "");
+    NetworkBuilder builder(source);
+    size_t n, nrFactors, k;
+
+    if (!lex.next() || !(lex.is("BAYES") || lex.is("MARKOV")))
+        lex.fail("expected BAYES or MARKOV");
+    if (!lex.next() || !lex.count(n))
+        lex.fail("expected the number of variables");
+    for (size_t i = 0; i < n; i++)
+    {
+        if (!lex.next() || !lex.count(k) || (k == 0))
+            lex.fail("expected the number of states of variable " + std::to_string(i));
+        std::vector<std::string> states;
+        for (size_t x = 0; x < k; x++)
+            states.push_back(std::to_string(x));
+        builder.addVariable(std::to_string(i), states);
+    }
+
+    if (!lex.next() || !lex.count(nrFactors))
+        lex.fail("expected the number of factors");
+    std::vector<std::vector<size_t> > scopes(nrFactors);
+    for (auto &scope: scopes)
+    {
+        if (!lex.next() || !lex.count(k))
+            lex.fail("expected the size of a scope");
+        for (size_t j = 0; j < k; j++)
+        {
+            size_t v;
+            if (!lex.next() || !lex.count(v) || (v >= n))
+                lex.fail("expected a variable");
+            scope.push_back(v);
+        }
+    }
+
+    std::vector<dai::Real> values;
+    for (auto const& scope: scopes)
+    {
+        if (!lex.next() || !lex.count(k))
+            lex.fail("expected the size of a table");
+        values.resize(k);
+        for (auto &x: values)
+            if (!lex.next() || !lex.number(x))
+                lex.fail("expected a number");
+        builder.addFactor(scope, values);
+    }
+    return builder.build(names);
+}
+
+// the next tag of an XML text, upper case and without attributes (e.g. "VARIABLE", "/VARIABLE"), with the
+// character data before it; comments, declarations and processing instructions are skipped
+static bool nextTag(const char *&pos, const char *end, size_t &line, std::string &tag, std::string &data)
+{
+    data.clear();
+    while (pos < end)
+    {
+        const char *open = std::find(pos, end, '<');
+        data.append(pos, open);
+        line += std::count(pos, open, '\n');
+        if (open == end)
+        {
+            pos = end;
+            return false;
+        }
+
+        const char *close;
+        if ((end - open >= 4) && (std::strncmp(open, "<!--", 4) == 0))
+        {
+            const char *marker = "-->";
+            close = std::search(open, end, marker, marker + 3);
+            close = (close == end) ? end : close + 2;
+        }
+        else if ((end - open >= 2) && (open[1] == '!'))
+        {
+            // a declaration, possibly with an internal DTD subset in brackets
+            close = std::find(open, end, '>');
+            const char *bracket = std::find(open, close, '[');
+            if (bracket != close)
+            {
+                close = std::find(bracket, end, ']');
+                close = std::find(close, end, '>');
+            }
+        }
+        else
+            close = std::find(open, end, '>');
+        line += std::count(open, close, '\n');
+        pos = (close == end) ? end : close + 1;
+
+        if ((open[1] == '!') || (open[1] == '?') || (close[-1] == '/'))
+            continue;
+        const char *name = open + 1, *nameEnd = name + ((*name == '/') ? 1 : 0);
+        while ((nameEnd < close) && !std::isspace((unsigned char) *nameEnd) && (*nameEnd != '/'))
+            nameEnd++;
+        tag.assign(name, nameEnd);
+        std::transform(tag.begin(), tag.end(), tag.begin(), [](unsigned char c) { return std::toupper(c); });
+        return true;
+    }
+    return false;
+}
+
+// character data with the predefined entities replaced and without surrounding white space
+static std::string xmlText(const std::string &data)
+{
+    static const char *entities[][2] = { { "&lt;", "<" }, { "&gt;", ">" }, { "&quot;", "\"" }, { "&apos;", "'" }, { "&amp;", "&" } };
+    size_t first = data.find_first_not_of(" \t\r\n"), last = data.find_last_not_of(" \t\r\n");
+    std::string text = (first == std::string::npos) ? "" : data.substr(first, last - first + 1);
+    for (size_t e = 0; (e < 5) && (text.find('&') != std::string::npos); e++)
+        for (size_t at = text.find(entities[e][0]); at != std::string::npos; at = text.find(entities[e][0], at + 1))
+            text.replace(at, std::strlen(entities[e][0]), entities[e][1]);
+    return text;
+}
+
+dai::FactorGraph parseXmlBif(const std::string &text, const std::string &source, NetworkNames *names)
+{
+    NetworkBuilder builder(source);
+    const char *pos = text.c_str(), *end = pos + text.size();
+    size_t line = 1;
+    std::string tag, data, name;
+    std::vector<std::string> outcomes, given;
+    std::vector<dai::Real> values;
+    bool inVariable = false;
+    auto fail = [&source, &line](const std::string &message) { DAI_THROWE(INVALID_FACTORGRAPH_FILE, source + ":" + std::to_string(line) + ": " + message); };
+    auto variable = [&builder, &fail](const std::string &name)
+    {
+        size_t v = builder.find(name);
+        if (v == NetworkNames::npos)
+            fail("unknown variable '" + name + "'");
+        return v;
+    };
+
+    while (nextTag(pos, end, line, tag, data))
+    {
+        if (tag == "VARIABLE")
+        {
+            inVariable = true;
+            name.clear();
+            outcomes.clear();
+        }
+        else if ((tag == "/NAME") && inVariable)
+            name = xmlText(data);
+        else if ((tag == "/OUTCOME") || (tag == "/VALUE"))
+            outcomes.push_back(xmlText(data));
+        else if (tag == "/VARIABLE")
+        {
+            inVariable = false;
+            if (builder.find(name) != NetworkNames::npos)
+                fail("variable '" + name + "' is declared twice");
+            builder.addVariable(name, outcomes);
+        }
+        else if ((tag == "DEFINITION") || (tag == "PROBABILITY"))
+        {
+            name.clear();
+            given.clear();
+            values.clear();
+        }
+        else if (tag == "/FOR")
+            name = xmlText(data);
+        else if (tag == "/GIVEN")
+            given.push_back(xmlText(data));
+        else if (tag == "/TABLE")
+        {
+            const char *p = data.c_str();
+            char *next;
+            for (double x = std::strtod(p, &next); next != p; x = std::strtod(p, &next))
+            {
+                values.push_back(x);
+                p = next;
+            }
+            if (xmlText(p) != "")
+                fail("expected a number instead of '" + xmlText(p) + "'");
+        }
+        else if ((tag == "/DEFINITION") || (tag == "/PROBABILITY"))
+        {
+            std::vector<size_t> vars;
+            for (auto const& g: given)
+                vars.push_back(variable(g));
+            vars.push_back(variable(name));
+            builder.addFactor(vars, values);
+        }
+    }
+    if (builder.nrVars() == 0)
+        fail("no variables");
+    return builder.build(names);
+}
+
+dai::FactorGraph parseHugin(const std::string &text, const std::string &source, NetworkNames *names)
+{
+    NetworkLexer lex(text, source, "{}()|=;", "%");
+    NetworkBuilder builder(source);
+    std::vector<dai::Real> values;
+
+    // skips a block whose '{' has been read
+    auto block = [&lex]()
+    {
+        for (size_t depth = 1; (depth > 0) && lex.next(); )
+        {
+            if (lex.is("{"))
+                depth++;
+            else if (lex.is("}"))
+                depth--;
+        }
+    };
+
+    while (lex.next())
+    {
+        if (lex.is("net"))
+        {
+            lex.expect("{");
+            block();
+        }
+        else if (lex.is("node") || lex.is("discrete"))
+        {
+            if (lex.is("discrete"))
+                lex.expect("node");
+            std::string name = lex.name();
+            std::vector<std::string> states;
+            lex.expect("{");
+            while (lex.next() && !lex.is("}"))
+            {
+                if (lex.is("states"))
+                {
+                    lex.expect("=");
+                    lex.expect("(");
+                    while (lex.next() && !lex.is(")"))
+                        states.push_back((lex.text()[0] == '"') ? lex.text().substr(1, lex.text().size() - 2) : lex.text());
+                    lex.expect(";");
+                }
+                else if (lex.separator())
+                    lex.fail("unexpected '" + lex.text() + "' in node '" + name + "'");
+                else
+                    lex.skipStatement();
+            }
+            if (builder.find(name) != NetworkNames::npos)
+                lex.fail("node '" + name + "' is declared twice");
+            if (states.empty())
+                lex.fail("node '" + name + "' has no states");
+            builder.addVariable(name, states);
+        }
+        else if (lex.is("potential"))
+        {
+            // potential (child | parents) with the data nested by parent, the child innermost
+            std::vector<size_t> vars;
+            lex.expect("(");
+            std::string child = lex.name();
+            lex.next();
+            if (lex.is("|"))
+                while (lex.next() && !lex.is(")"))
+                {
+                    size_t v = builder.find(lex.text());
+                    if (v == NetworkNames::npos)
+                        lex.fail("unknown node '" + lex.text() + "'");
+                    vars.push_back(v);
+                }
+            if (!lex.is(")"))
+                lex.fail("expected one node before '|' or ')'");
+            size_t c = builder.find(child);
+            if (c == NetworkNames::npos)
+                lex.fail("unknown node '" + child + "'");
+            vars.push_back(c);
+
+            values.clear();
+            lex.expect("{");
+            while (lex.next() && !lex.is("}"))
+            {
+                if (lex.is("data"))
+                {
+                    lex.expect("=");
+                    double x;
+                    while (lex.next() && !lex.is(";"))
+                        if (!lex.is("(") && !lex.is(")"))
+                        {
+                            if (!lex.number(x))
+                                lex.fail("expected a number instead of '" + lex.text() + "'");
+                            values.push_back(x);
+                        }
+                }
+                else
+                    lex.skipStatement();
+            }
+            builder.addFactor(vars, values);
+        }
+        else if (lex.is("class") || lex.is("decision") || lex.is("utility") || lex.is("continuous") || lex.is("function"))
+            lex.fail("'" + lex.text() + "' is not supported, only discrete chance nodes are");
+        else
+            lex.fail("unexpected '" + lex.text() + "'");
+    }
+    return builder.build(names);
+}
@@ -0,0 +1,87 @@
+#ifndef NETPARSEHEADER
+#define NETPARSEHEADER
+
+// STL includes
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "dai/factorgraph.h"
+#include "network.h"
+
+// The text formats of readNetwork all take the same path: the file is read into memory at once, tokenized
+// in a single pass by a NetworkLexer (XMLBIF has a tag scanner of its own) and turned into factors by a
+// NetworkBuilder, which keeps the names. Errors are INVALID_FACTORGRAPH_FILE with the file and line.
+
+// the contents of the file, followed by a 0
+std::string readText(const std::string &path);
+
+// Tokens are single character separators, quoted strings and runs of other non-blank characters.
+// Comments run from comment up to the end of the line; "//" also allows /* */ comments.
+class NetworkLexer
+{
+    public:
+        NetworkLexer(const std::string &text, const std::string &source, const char *separators, const char *comment);
+
+        // the next token, false at the end of the text
+        bool next();
+
+        bool is(const char *s) const;
+        std::string text() const { return std::string(_tok, _len); }
+        bool separator() const { return (_len == 1) && isSeparator(*_tok); }
+
+        // the token as a number or as a count (no exceptions; the text ends in a 0, so strtod stops in time)
+        bool number(double &x) const;
+        bool count(size_t &n) const;
+
+        void fail(const std::string &message) const;
+        void expect(const char *s);
+
+        // the next token as a name, without quotes
+        std::string name();
+
+        // skips up to and including the next ';'
+        void skipStatement();
+
+    private:
+        bool isSeparator(char c) const;
+
+        const char *_pos, *_end;
+        size_t _line;
+        std::string _source;
+        std::string _separators, _comment;
+        const char *_tok;
+        size_t _len;
+};
+
+class NetworkBuilder
+{
+    public:
+        explicit NetworkBuilder(const std::string &source) : _source(source) {}
+
+        // a new variable, whose label is its index; throws if the name is taken
+        size_t addVariable(const std::string &name, const std::vector<std::string> &states);
+
+        // the variable with this name, npos if there is none
+        size_t find(const std::string &name) const;
+        size_t nrVars() const { return _names.variables.size(); }
+        const std::string &name(size_t var) const { return _names.variables[var]; }
+        const std::vector<std::string> &states(size_t var) const { return _names.states[var]; }
+
+        // a factor over vars with the values in row-major order (the last variable changing fastest)
+        void addFactor(const std::vector<size_t> &vars, const std::vector<dai::Real> &values);
+
+        // the factor graph, in which variables without a factor get a constant one, and the names
+        dai::FactorGraph build(NetworkNames *names);
+
+    private:
+        std::string _source;
+        NetworkNames _names;
+        std::vector<dai::Factor> _factors;
+};
+
+// the formats besides .fg, .fgb and .bif (see bif.h)
+dai::FactorGraph parseUai(const std::string &text, const std::string &source, NetworkNames *names);
+dai::FactorGraph parseXmlBif(const std::string &text, const std::string &source, NetworkNames *names);
+dai::FactorGraph parseHugin(const std::string &text, const std::string &source, NetworkNames *names);
+
+#endif // defined NETPARSEHEADER
@@ -0,0 +1,342 @@
+/************************************************************************/
+/* Reading and writing networks               					        */
+/* Version:			1.0													*/
+/* Last changed:	18-10-2026                                         	*/
+/*                                                                     	*/
+/* Version History:                                                    	*/
+/*                                                                     	*/
+/* Version Comments:                                                   	*/
+/* - the binary format stores the tables in libDAI order, so a factor   */
+/*   is constructed straight from the mapped file; on big-endian        */
+/*   machines the words and doubles are swapped first.                  */
+/************************************************************************/
+
+// headers
+#include <fstream>
+#include <limits>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "network.h"
+#include "bif.h"
+#include "netparse.h"
+
+static_assert(sizeof(dai::Real) == sizeof(uint64_t), "the binary network format stores tables as doubles");
+
+static const char magic[8] = { 'M', 'F', 'E', 'F', 'G', 'B', 0, 0 };
+static const size_t headerWords = 8;            // the magic and seven words
+
+static bool hasExtension(const std::string &path, const std::string &extension)
+{
+    return (path.size() >= extension.size()) && (path.compare(path.size() - extension.size(), extension.size(), extension) == 0);
+}
+
+static bool littleEndian()
+{
+    const uint16_t one = 1;
+    return *reinterpret_cast<const unsigned char *>(&one) == 1;
+}
+
+static uint64_t word(const unsigned char *p)
+{
+    uint64_t w = 0;
+    for (size_t b = 8; b-- > 0; )
+        w = (w << 8) | p[b];
+    return w;
+}
+
+static void putWord(std::ostream &os, uint64_t w)
+{
+    char bytes[8];
+    for (size_t b = 0; b < 8; b++, w >>= 8)
+        bytes[b] = (char) (w & 0xff);
+    os.write(bytes, 8);
+}
+
+uint64_t structureHash(const dai::FactorGraph &fg)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](uint64_t w)
+    {
+        for (size_t b = 0; b < 8; b++, w >>= 8)
+            hash = (hash ^ (w & 0xff)) * 1099511628211ULL;
+    };
+
+    mix(fg.nrVars());
+    for (size_t i = 0; i < fg.nrVars(); i++)
+    {
+        mix(fg.var(i).label());
+        mix(fg.var(i).states());
+    }
+    mix(fg.nrFactors());
+    for (size_t I = 0; I < fg.nrFactors(); I++)
+    {
+        mix(fg.factor(I).vars().size());
+        for (auto const& v: fg.factor(I).vars())
+            mix(fg.findVar(v));
+    }
+    return hash;
+}
+
+uint64_t contentHash(const dai::FactorGraph &fg)
+{
+    uint64_t hash = structureHash(fg);
+    for (size_t I = 0; I < fg.nrFactors(); I++)
+    {
+        const dai::Factor &f = fg.factor(I);
+        for (size_t s = 0; s < f.nrStates(); s++)
+        {
+            uint64_t w;
+            dai::Real p = f[s];
+            std::memcpy(&w, &p, sizeof(w));
+            for (size_t b = 0; b < 8; b++, w >>= 8)
+                hash = (hash ^ (w & 0xff)) * 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+void writeBinaryNetwork(const dai::FactorGraph &fg, std::ostream &os)
+{
+    size_t scopes = 0, tables = 0;
+    for (size_t I = 0; I < fg.nrFactors(); I++)
+    {
+        scopes += fg.factor(I).vars().size();
+        tables += fg.factor(I).nrStates();
+    }
+
+    os.write(magic, sizeof(magic));
+    for (uint64_t w: { binaryNetworkVersion, (uint64_t) fg.nrVars(), (uint64_t) fg.nrFactors(), (uint64_t) scopes, (uint64_t) tables, structureHash(fg), (uint64_t) 0 })
+        putWord(os, w);
+
+    for (size_t i = 0; i < fg.nrVars(); i++)
+    {
+        putWord(os, fg.var(i).label());
+        putWord(os, fg.var(i).states());
+    }
+
+    scopes = tables = 0;
+    for (size_t I = 0; I < fg.nrFactors(); I++)
+    {
+        putWord(os, scopes);
+        putWord(os, tables);
+        scopes += fg.factor(I).vars().size();
+        tables += fg.factor(I).nrStates();
+    }
+    putWord(os, scopes);
+    putWord(os, tables);
+
+    for (size_t I = 0; I < fg.nrFactors(); I++)
+        for (auto const& v: fg.factor(I).vars())
+            putWord(os, fg.findVar(v));
+
+    for (size_t I = 0; I < fg.nrFactors(); I++)
+    {
+        const std::vector<dai::Real> &p = fg.factor(I).p().p();
+        if (littleEndian())
+            os.write(reinterpret_cast<const char *>(p.data()), p.size() * sizeof(dai::Real));
+        else
+            for (auto x: p)
+            {
+                uint64_t w;
+                std::memcpy(&w, &x, sizeof(w));
+                putWord(os, w);
+            }
+    }
+}
+
+dai::FactorGraph readBinaryNetwork(const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        DAI_THROWE(CANNOT_READ_FILE, "Cannot read from file " + path);
+    struct stat st;
+    if ((fstat(fd, &st) < 0) || ((size_t) st.st_size < headerWords * 8))
+    {
+        close(fd);
+        DAI_THROWE(INVALID_FACTORGRAPH_FILE, path + " is not a binary network");
+    }
+    size_t size = st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        DAI_THROWE(CANNOT_READ_FILE, "Cannot map file " + path);
+    madvise(map, size, MADV_SEQUENTIAL);
+    const unsigned char *data = static_cast<const unsigned char *>(map);
+
+    std::vector<dai::Factor> factors;
+    uint64_t hash = 0;
+    std::string error;
+    do
+    {
+        if (std::memcmp(data, magic, sizeof(magic)) != 0)
+        {
+            error = "is not a binary network";
+            break;
+        }
+        if (word(data + 8) != binaryNetworkVersion)
+        {
+            error = "has binary network version " + std::to_string(word(data + 8));
+            break;
+        }
+        uint64_t nrVars = word(data + 16), nrFactors = word(data + 24), nrScopes = word(data + 32), nrTables = word(data + 40);
+        hash = word(data + 48);
+
+        // the counts are checked one by one, so their sum cannot overflow
+        size_t words = size / 8;
+        if ((nrVars > words) || (nrFactors > words) || (nrScopes > words) || (nrTables > words) ||
+            (headerWords + 2 * nrVars + 2 * (nrFactors + 1) + nrScopes + nrTables != words))
+        {
+            error = "is truncated or has trailing data";
+            break;
+        }
+        const unsigned char *vars = data + headerWords * 8;
+        const unsigned char *index = vars + 16 * nrVars;
+        const unsigned char *scope = index + 16 * (nrFactors + 1);
+        const unsigned char *table = scope + 8 * nrScopes;
+
+        std::vector<dai::Var> var(nrVars);
+        for (size_t i = 0; i < nrVars; i++)
+            var[i] = dai::Var(word(vars + 16 * i), word(vars + 16 * i + 8));
+
+        factors.reserve(nrFactors);
+        std::vector<dai::Var> fvars;
+        std::vector<dai::Real> swapped;
+        for (size_t I = 0; (I < nrFactors) && error.empty(); I++)
+        {
+            uint64_t scopeBegin = word(index + 16 * I), scopeEnd = word(index + 16 * (I + 1));
+            uint64_t tableBegin = word(index + 16 * I + 8), tableEnd = word(index + 16 * (I + 1) + 8);
+            if ((scopeBegin > scopeEnd) || (scopeEnd > nrScopes) || (tableBegin > tableEnd) || (tableEnd > nrTables))
+            {
+                error = "has a corrupt factor index";
+                break;
+            }
+            fvars.clear();
+            size_t states = 1;
+            for (uint64_t k = scopeBegin; k < scopeEnd; k++)
+            {
+                uint64_t i = word(scope + 8 * k);
+                if ((i >= nrVars) || (!fvars.empty() && !(fvars.back() < var[i])))
+                {
+                    error = "has a corrupt scope in factor " + std::to_string(I);
+                    break;
+                }
+                fvars.push_back(var[i]);
+                states *= var[i].states();
+            }
+            if (error.empty() && (states != tableEnd - tableBegin))
+                error = "has a table of the wrong size in factor " + std::to_string(I);
+            if (!error.empty())
+                break;
+
+            dai::VarSet vs(fvars.begin(), fvars.end(), fvars.size());
+            const unsigned char *values = table + 8 * tableBegin;
+            if (littleEndian())
+                factors.push_back(dai::Factor(vs, reinterpret_cast<const dai::Real *>(values)));
+            else
+            {
+                swapped.resize(states);
+                for (size_t k = 0; k < states; k++)
+                {
+                    uint64_t w = word(values + 8 * k);
+                    std::memcpy(&swapped[k], &w, sizeof(w));
+                }
+                factors.push_back(dai::Factor(vs, swapped.data()));
+            }
+        }
+    }
+    while (false);
+    munmap(map, size);
+
+    if (!error.empty())
+        DAI_THROWE(INVALID_FACTORGRAPH_FILE, path + " " + error);
+    dai::FactorGraph fg(factors);
+    if (structureHash(fg) != hash)
+        DAI_THROWE(INVALID_FACTORGRAPH_FILE, path + " does not match its structure hash");
+    return fg;
+}
+
+size_t NetworkNames::variable(const std::string &name) const
+{
+    if (!name.empty() && (name.find_first_not_of("0123456789") == std::string::npos))
+        return std::stoul(name);
+    auto v = index.find(name);
+    return (v == index.end()) ? npos : v->second;
+}
+
+size_t NetworkNames::state(size_t var, const std::string &name) const
+{
+    if (!name.empty() && (name.find_first_not_of("0123456789") == std::string::npos))
+        return std::stoul(name);
+    if (var >= states.size())
+        return npos;
+    size_t x = std::find(states[var].begin(), states[var].end(), name) - states[var].begin();
+    return (x == states[var].size()) ? npos : x;
+}
+
+dai::FactorGraph readNetwork(const std::string &path, NetworkNames *names)
+{
+    if (names != NULL)
+        *names = NetworkNames();
+    char start[sizeof(magic)] = { 0 };
+    std::ifstream is(path.c_str(), std::ios::binary);
+    if (!is)
+        DAI_THROWE(CANNOT_READ_FILE, "Cannot read from file " + path);
+    is.read(start, sizeof(start));
+    if (is && (std::memcmp(start, magic, sizeof(magic)) == 0))
+        return readBinaryNetwork(path);
+    is.close();
+
+    std::string text = readText(path);
+    if (hasExtension(path, ".bif"))
+        return parseBif(text, path, names);
+    if (hasExtension(path, ".uai"))
+        return parseUai(text, path, names);
+    if (hasExtension(path, ".xml") || hasExtension(path, ".xmlbif"))
+        return parseXmlBif(text, path, names);
+    if (hasExtension(path, ".net"))
+        return parseHugin(text, path, names);
+
+    // no known extension: the first token decides
+    if (!hasExtension(path, ".fg"))
+    {
+        size_t first = text.find_first_not_of(" \t\r\n");
+        std::string token = (first == std::string::npos) ? "" : text.substr(first, text.find_first_of(" \t\r\n{", first) - first);
+        if (token == "network")
+            return parseBif(text, path, names);
+        if ((token == "BAYES") || (token == "MARKOV"))
+            return parseUai(text, path, names);
+        if (!token.empty() && (token[0] == '<'))
+            return parseXmlBif(text, path, names);
+        if ((token == "net") || (token == "node") || (token == "discrete"))
+            return parseHugin(text, path, names);
+    }
+
+    dai::FactorGraph fg;
+    std::istringstream fgText(text);
+    fgText >> fg;
+    return fg;
+}
+
+void writeNetwork(const dai::FactorGraph &fg, const std::string &path, const std::string &comment)
+{
+    std::ofstream os(path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!os)
+        DAI_THROWE(CANNOT_WRITE_FILE, "Cannot write to file " + path);
+    if (hasExtension(path, ".fgb"))
+        writeBinaryNetwork(fg, os);
+    else
+    {
+        if (!comment.empty())
+            os << "# " << comment << '\n';
+        os << std::setprecision(std::numeric_limits<dai::Real>::max_digits10) << fg;
+    }
+    os.close();
+    if (!os)
+        DAI_THROWE(CANNOT_WRITE_FILE, "Cannot write to file " + path);
+}
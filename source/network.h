@@ -0,0 +1,57 @@
+#ifndef NETWORKHEADER
+#define NETWORKHEADER
+
+// STL includes
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <iostream>
+#include <cstdint>
+#include "dai/factorgraph.h"
+
+// Names of the variables and their states, as far as the format of the network has them (.fg and .fgb
+// have none). Queries may give a variable or a state by name or by number; numbers are always indices.
+struct NetworkNames
+{
+    static const size_t npos = (size_t) -1;
+
+    std::vector<std::string> variables;                 // by variable index
+    std::vector<std::vector<std::string> > states;      // by variable index
+    std::unordered_map<std::string, size_t> index;      // variable index by name
+
+    // the variable or the state of var given by name or number, npos if there is none
+    size_t variable(const std::string &name) const;
+    size_t state(size_t var, const std::string &name) const;
+};
+
+// Reading and writing networks. Besides the libDAI .fg text format, networks can be stored in a binary
+// format (.fgb) that is loaded by mapping the file into memory, without parsing:
+//   header     8 bytes magic "MFEFGB\0\0", then little-endian 64 bit words: version, number of variables,
+//              number of factors, number of scope entries, number of table entries, structure hash, 0
+//   variables  label and number of states per variable, in libDAI order (sorted by label)
+//   factors    first scope entry and first table entry per factor, plus one past the last of both
+//   scopes     variable indices per factor, in libDAI order
+//   tables     IEEE 754 doubles per factor, in libDAI order (the first variable changes fastest)
+// The structure hash covers the variables and the scopes, but not the tables, so networks that differ in
+// their parameters only have the same hash. It is checked on loading.
+static const uint64_t binaryNetworkVersion = 1;
+
+// The network in path with its names (if names is given). The format follows from the magic of the
+// binary format, then from the extension: .fg, .fgb, .bif (see bif.h), .uai (UAI competitions), .xml or
+// .xmlbif (XMLBIF 0.3) and .net (Hugin); then from the first token of the file. In the formats with
+// names, variable i is the i-th variable declared in the file.
+dai::FactorGraph readNetwork(const std::string &path, NetworkNames *names = NULL);
+
+// writes fg to path: binary when path ends in .fgb, a .fg file (with all digits and the comment, if any) otherwise
+void writeNetwork(const dai::FactorGraph &fg, const std::string &path, const std::string &comment = "");
+
+dai::FactorGraph readBinaryNetwork(const std::string &path);
+void writeBinaryNetwork(const dai::FactorGraph &fg, std::ostream &os);
+
+// 64 bit FNV-1a hash of the variables (labels and states) and the factor scopes
+uint64_t structureHash(const dai::FactorGraph &fg);
+
+// the same, continued over every entry of every table: networks with the same hash give the same answers
+uint64_t contentHash(const dai::FactorGraph &fg);
+
+#endif // defined NETWORKHEADER
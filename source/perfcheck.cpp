@@ -0,0 +1,282 @@
+/************************************************************************/
+/* Performance regression check                 				        */
+/* Version:			1.0													*/
+/* Last changed:	18-10-2026                                         	*/
+/*                                                                     	*/
+/* Version History:                                                    	*/
+/*                                                                     	*/
+/* Version Comments:                                                   	*/
+/* - use perfcheck baseline.json (make perf-check) to compare, and     	*/
+/*   perfcheck --record baseline.json (make perf-baseline) to store    	*/
+/*   the current medians; recording keeps the tolerances in the file   	*/
+/* - a benchmark is a regression if its median over 'repeat' runs is   	*/
+/*   more than its tolerance above the baseline, twice in a row (the   	*/
+/*   second measurement rules out a noisy first one)                   	*/
+/* - quiet benchmarks (everything on the hot path) must not write to   	*/
+/*   standard output at all: their output is caught in a temporary     	*/
+/*   file and any byte of it fails the check                           	*/
+/* - baselines are only comparable on the machine they were recorded   	*/
+/*   on; the file names the host                                       	*/
+/* - a benchmark without a recorded median is reported as such and the 	*/
+/*   check exits with 2 (1 = a failure), so an unrecorded baseline is   	*/
+/*   told apart from a regression and from a pass                       */
+/************************************************************************/
+
+// STL includes
+#include <unistd.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <regex>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <thread>
+#include <cstdio>
+#include <cstring>
+
+// headers
+#include "mfesim.h"
+#include "netgen.h"
+#include "forward.h"
+#include "rng.h"
+
+struct Benchmark
+{
+    std::string name;
+    size_t repeat;                  // runs, of which the median counts
+    double tolerance;               // default allowed slowdown (a fraction of the baseline)
+    bool quiet;                     // may not write to standard output
+    std::function<void()> run;
+};
+
+struct Baseline
+{
+    double medianNs;                // negative if none was recorded
+    double tolerance;               // negative if the default applies
+};
+
+// function prototypes
+int main(int argc, char *argv[]);
+static std::map<std::string, Baseline> readBaseline(const std::string &path);
+static void writeBaseline(const std::string &path, const std::vector<Benchmark> &benchmarks, const std::vector<double> &medians,
+    const std::map<std::string, Baseline> &old);
+static double measure(const Benchmark &b, size_t &written);
+
+// the benchmarks of a baseline file (as written by writeBaseline: one flat object per benchmark)
+static std::map<std::string, Baseline> readBaseline(const std::string &path)
+{
+    std::map<std::string, Baseline> baseline;
+    std::ifstream is(path.c_str());
+    if (!is)
+        return baseline;
+    std::stringstream text;
+    text << is.rdbuf();
+    std::string s = text.str();
+
+    std::regex member("\"(\\w+)\"\\s*:\\s*(\"([^\"]*)\"|[-+0-9.eE]+|null)");
+    for (size_t open = s.find('{', 1); open != std::string::npos; open = s.find('{', open + 1))
+    {
+        size_t close = s.find('}', open);
+        if (close == std::string::npos)
+            break;
+        std::string object = s.substr(open, close - open);
+        std::map<std::string, std::string> members;
+        for (std::sregex_iterator m(object.begin(), object.end(), member), end; m != end; ++m)
+            members[(*m)[1]] = (*m)[3].matched ? std::string((*m)[3]) : std::string((*m)[2]);
+        if (members.count("name") == 0)
+            continue;
+        Baseline b = { -1.0, -1.0 };
+        if (members.count("median_ns") && (members["median_ns"] != "null"))
+            b.medianNs = std::atof(members["median_ns"].c_str());
+        if (members.count("tolerance") && (members["tolerance"] != "null"))
+            b.tolerance = std::atof(members["tolerance"].c_str());
+        baseline[members["name"]] = b;
+    }
+    return baseline;
+}
+
+static void writeBaseline(const std::string &path, const std::vector<Benchmark> &benchmarks, const std::vector<double> &medians,
+    const std::map<std::string, Baseline> &old)
+{
+    char host[256] = "unknown";
+    gethostname(host, sizeof(host) - 1);
+    std::ofstream os(path.c_str());
+    if (!os)
+        DAI_THROWE(CANNOT_WRITE_FILE, "Cannot write baseline " + path);
+    os << "{\n  \"host\": \"" << host << "\",\n  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n  \"benchmarks\": [\n";
+    for (size_t k = 0; k < benchmarks.size(); k++)
+    {
+        auto o = old.find(benchmarks[k].name);
+        double tolerance = ((o != old.end()) && (o->second.tolerance >= 0.0)) ? o->second.tolerance : benchmarks[k].tolerance;
+        os << "    {\"name\": \"" << benchmarks[k].name << "\", \"median_ns\": " << (long long) medians[k] << ", \"tolerance\": " << tolerance << "}"
+           << ((k + 1 < benchmarks.size()) ? ",\n" : "\n");
+    }
+    os << "  ]\n}" << std::endl;
+}
+
+// the median time of a benchmark in ns; written is the number of bytes it wrote to standard output
+static double measure(const Benchmark &b, size_t &written)
+{
+    std::cout.flush();
+    fflush(stdout);
+    FILE *capture = tmpfile();
+    int saved = dup(STDOUT_FILENO);
+    if ((capture != NULL) && (saved >= 0))
+        dup2(fileno(capture), STDOUT_FILENO);
+
+    b.run();                        // warm-up
+    std::vector<double> times;
+    for (size_t r = 0; r < b.repeat; r++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        b.run();
+        times.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    std::cout.flush();
+    fflush(stdout);
+    written = 0;
+    if ((capture != NULL) && (saved >= 0))
+    {
+        dup2(saved, STDOUT_FILENO);
+        off_t size = lseek(fileno(capture), 0, SEEK_END);
+        written = (size > 0) ? (size_t) size : 0;
+    }
+    if (saved >= 0)
+        close(saved);
+    if (capture != NULL)
+        fclose(capture);
+
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+int main(int argc, char *argv[])
+{
+    bool record = (argc == 3) && (std::strcmp(argv[1], "--record") == 0);
+    if ((argc != 2) && !record)
+    {
+        std::cout << "perfcheck: compares the speed of a fixed set of benchmarks with a stored baseline." << std::endl;
+        std::cout << "Use: " << argv[0] << " baseline.json (check) or " << argv[0] << " --record baseline.json" << std::endl;
+        return 0;
+    }
+    std::string path = argv[argc - 1];
+
+    engineOptions.set("threads", (size_t) 1);
+    engineOptions.set("engine", std::string("JTREE"));
+    engineOptions.set("maxmem", (size_t) 0);
+    engineOptions.set("circuit", std::string());
+    engineOptions.set("sampler", std::string("UNIFORM"));
+    setRunSeed(1);
+
+    try
+    {
+        // fixed inputs: a generated network with a fixed query, two evidence settings to alternate between
+        NetworkGenerator generator(dai::PropertySet()("nodes",(size_t) 60)("indegree",(size_t) 3)("states",(size_t) 2)("treewidth",(size_t) 8)("seed",(size_t) 1));
+        dai::FactorGraph fg = generator.generate();
+        std::vector<unsigned int> H = { 0, 1, 2 }, E, values[2], state;
+        ForwardSampler sampler(fg, dai::PropertySet()("threads",(size_t) 1)("seed",(size_t) 1));
+        for (size_t k = 0; k < 2; k++)
+        {
+            sampler.draw(state);
+            for (size_t i = fg.nrVars() - 5; i < fg.nrVars(); i++)
+                values[k].push_back(state[i]);
+        }
+        for (size_t i = fg.nrVars() - 5; i < fg.nrVars(); i++)
+            E.push_back(i);
+        std::vector<unsigned int> I = getIntermediateVars(fg, H, E);
+        std::unique_ptr<InferenceEngine> jt(newEngine(fg, engineOptions("inference",std::string("SUMPROD"))));
+
+        dai::Prob p(1 << 16), q(1 << 16);
+        for (size_t i = 0; i < p.size(); i++)
+        {
+            p.set(i, (i % 7) + 1.0);
+            q.set(i, (i % 5) + 1.0);
+        }
+        std::vector<dai::Var> vars;
+        for (size_t i = 0; i < 16; i++)
+            vars.push_back(dai::Var(i, 2));
+        dai::Factor left(dai::VarSet(vars.begin(), vars.begin() + 10, 10), 0.5), right(dai::VarSet(vars.begin() + 5, vars.begin() + 15, 10), 0.25);
+        dai::Factor wide(dai::VarSet(vars.begin(), vars.end(), vars.size()), 1.0);
+        dai::VarSet narrow(vars.begin(), vars.begin() + 4, 4);
+        std::vector<unsigned int> ordinates(10, 0), maximums(10, 3);
+        std::mt19937 rngen(1);
+        volatile dai::Real sink = 0.0;
+
+        std::vector<Benchmark> benchmarks = {
+            { "tprob.ops", 15, 0.10, true, [&]() { for (size_t k = 0; k < 20; k++) { dai::Prob r = p * q; r.normalize(); sink = r.sum() + r.max(); } } },
+            { "factor.product", 15, 0.10, true, [&]() { for (size_t k = 0; k < 20; k++) sink = (left * right)[0]; } },
+            { "factor.marginalize", 15, 0.10, true, [&]() { for (size_t k = 0; k < 20; k++) sink = wide.marginal(narrow)[0]; } },
+            { "random_sample", 15, 0.10, true, [&]() { for (size_t k = 0; k < 100000; k++) random_sample(10, -1, ordinates, maximums, rngen); } },
+            { "jtree.build", 7, 0.20, true, [&]() { std::unique_ptr<InferenceEngine> e(newEngine(fg, engineOptions("inference",std::string("SUMPROD")))); } },
+            { "jtree.propagate", 7, 0.20, true, [&]() { for (size_t k = 0; k < 50; k++) jt->run(E, values[k % 2]); } },
+            { "get_map", 7, 0.20, true, [&]() { for (size_t k = 0; k < 50; k++) get_map(*jt, H, E, values[k % 2], false); } },
+            { "mfe", 7, 0.20, true, [&]() { compute_MFE(fg, *jt, *jt, E, values[0], H, std::vector<unsigned int>(), I, false, 0, 0.0, 200, 3600); } },
+        };
+
+        std::map<std::string, Baseline> baseline = readBaseline(path);
+        std::vector<double> medians;
+        bool failed = false, unrecorded = false;
+        for (auto const& b: benchmarks)
+        {
+            size_t written;
+            double median = measure(b, written);
+            auto base = baseline.find(b.name);
+            double tolerance = ((base != baseline.end()) && (base->second.tolerance >= 0.0)) ? base->second.tolerance : b.tolerance;
+            bool known = (base != baseline.end()) && (base->second.medianNs > 0.0);
+
+            std::string verdict = "ok";
+            if (b.quiet && (written > 0))
+            {
+                verdict = "FAILED: wrote " + std::to_string(written) + " bytes to standard output";
+                failed = true;
+            }
+            else if (!record && known && (median > base->second.medianNs * (1.0 + tolerance)))
+            {
+                median = std::min(median, measure(b, written));
+                if (median > base->second.medianNs * (1.0 + tolerance))
+                {
+                    verdict = "FAILED: REGRESSION";
+                    failed = true;
+                }
+            }
+            else if (!record && !known)
+            {
+                verdict = "NO BASELINE (record one with make perf-baseline)";
+                unrecorded = true;
+            }
+            medians.push_back(median);
+
+            std::cout << b.name << ": median " << median / 1e6 << " ms";
+            if (known)
+                std::cout << ", baseline " << base->second.medianNs / 1e6 << " ms (" << ((median / base->second.medianNs) - 1.0) * 100.0
+                    << "%, tolerance " << tolerance * 100.0 << "%)";
+            std::cout << " " << verdict << std::endl;
+            if (verdict.compare(0, 6, "FAILED") == 0)
+                std::cerr << "PERFORMANCE CHECK FAILED for " << b.name << ": " << verdict.substr(8) << std::endl;
+        }
+
+        if (record)
+        {
+            if (failed)
+            {
+                std::cerr << "Baseline not recorded: fix the failures first" << std::endl;
+                return 1;
+            }
+            writeBaseline(path, benchmarks, medians, baseline);
+            std::cout << "Baseline written to " << path << std::endl;
+        }
+        if (!failed && unrecorded)
+            std::cerr << "No baseline recorded in " << path << " for some benchmarks: not compared" << std::endl;
+        return failed ? 1 : (unrecorded ? 2 : 0);
+    }
+    catch (dai::Exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,109 @@
+/************************************************************************/
+/* Concurrent phases of one run                					        */
+/* Version:			1.0													*/
+/* Last changed:	18-10-2026                                         	*/
+/*                                                                     	*/
+/* Version History:                                                    	*/
+/*                                                                     	*/
+/* Version Comments:                                                   	*/
+/* - a thread cannot be stopped from outside, so a time budget is      	*/
+/*   enforced by the algorithms of the phase (their cutoff time) and   	*/
+/*   only reported here                                                	*/
+/* - phases that run together each build their own engines (see        	*/
+/*   plan.h), so memory grows with the number of concurrent phases     	*/
+/* - a phase thread waiting for its propagation runs the tasks of     	*/
+/*   that propagation only, so the pool gets the budget minus the      	*/
+/*   phase threads                                                      */
+/************************************************************************/
+
+// headers
+#include <sstream>
+#include <chrono>
+#include <memory>
+#include <exception>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include "phases.h"
+#include "metrics.h"
+
+void PhaseScheduler::add(const std::string &name, unsigned long int budget, const Phase &phase)
+{
+    Entry e;
+    e.name = name;
+    e.budget = budget;
+    e.phase = phase;
+    _phases.push_back(e);
+}
+
+size_t PhaseScheduler::concurrent() const
+{
+    return std::max((size_t) 1, std::min(_threads, _phases.size()));
+}
+
+size_t PhaseScheduler::engineThreads() const
+{
+    size_t phases = concurrent();
+    if (phases == 1)
+        return std::max((size_t) 1, _threads);
+    return (_threads > phases) ? _threads - phases : 1;
+}
+
+void PhaseScheduler::run(std::ostream &os)
+{
+    size_t n = _phases.size();
+    std::vector<std::unique_ptr<std::ostringstream> > out;
+    std::vector<std::exception_ptr> errors(n);
+    for (size_t k = 0; k < n; k++)
+        out.push_back(std::unique_ptr<std::ostringstream>(new std::ostringstream()));
+
+    auto runPhase = [&](size_t k)
+    {
+        METRIC_SPAN("PHASE.run", "phase=" + _phases[k].name);
+        auto start = std::chrono::steady_clock::now();
+        try
+        {
+            _phases[k].phase(*out[k]);
+        }
+        catch (...)
+        {
+            errors[k] = std::current_exception();
+        }
+        long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        if ((_phases[k].budget > 0) && (ns > (long long) _phases[k].budget * 1000000000LL))
+            *out[k] << "[" << _phases[k].name << "] exceeded its time budget of " << _phases[k].budget << " s" << std::endl;
+    };
+
+    if (concurrent() == 1)
+    {
+        // one after the other; the output of a phase is written as soon as it is done
+        for (size_t k = 0; k < n; k++)
+        {
+            runPhase(k);
+            os << out[k]->str();
+            if (errors[k])
+                std::rethrow_exception(errors[k]);
+        }
+    }
+    else
+    {
+        // every thread takes the next phase that has not started
+        std::atomic<size_t> next(0);
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < concurrent(); t++)
+            workers.push_back(std::thread([&]
+            {
+                for (size_t k; (k = next++) < n; )
+                    runPhase(k);
+            }));
+        for (auto &w: workers)
+            w.join();
+
+        for (size_t k = 0; k < n; k++)
+        {
+            os << out[k]->str();
+            if (errors[k])
+                std::rethrow_exception(errors[k]);
+        }
+    }
+}
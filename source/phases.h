@@ -0,0 +1,52 @@
+#ifndef PHASESHEADER
+#define PHASESHEADER
+
+// STL includes
+#include <iostream>
+#include <string>
+#include <vector>
+#include <functional>
+
+// Runs the phases of one mfesim run (STRONG, WEAK, REL, MAP, ANN, MFE), which only read the network and
+// the query, at the same time on threads of their own. The core budget (--threads) is split: concurrent()
+// phases run at once and the parallel propagation inside them gets engineThreads() (the engine option
+// "threads", see threadpool.h), so phases and their engines never run more threads than the budget together.
+// The phases do not run on the shared pool: a phase waiting for its propagation there would pick up other
+// tasks, which must not be another phase. A phase thread is outside the pool, so while it waits it only runs
+// the tasks of its own propagation (threadpool.h) and the engines of concurrent phases never share scratch.
+// With a budget of one thread the phases run one after the other, as before. Every phase writes to a stream
+// of its own, which run() writes to the output in the order the phases were added, whatever order they
+// finished in.
+class PhaseScheduler
+{
+    public:
+        typedef std::function<void(std::ostream &)> Phase;
+
+        explicit PhaseScheduler(size_t threads) : _threads(threads) {}
+
+        // budget is the phase's time limit in seconds (0 = none), which the phase should pass on to its
+        // algorithms; a phase that takes longer is reported in its output
+        void add(const std::string &name, unsigned long int budget, const Phase &phase);
+
+        // the number of phases that run at the same time, and the threads the engines of the phases may use
+        // (set after the phases have been added)
+        size_t concurrent() const;
+        size_t engineThreads() const;
+
+        // runs the phases and writes their output; an exception of a phase is rethrown after the output of
+        // the phases before it has been written
+        void run(std::ostream &os);
+
+    private:
+        struct Entry
+        {
+            std::string name;
+            unsigned long int budget;
+            Phase phase;
+        };
+
+        size_t _threads;
+        std::vector<Entry> _phases;
+};
+
+#endif // defined PHASESHEADER
@@ -0,0 +1,242 @@
+/************************************************************************/
+/* Shared computations of one query            					        */
+/* Version:			1.0													*/
+/* Last changed:	18-10-2026                                         	*/
+/*                                                                     	*/
+/* Version History:                                                    	*/
+/*                                                                     	*/
+/* Version Comments:                                                   	*/
+/* - the engines are shared, not their evidence: every algorithm       	*/
+/*   enters its own evidence with run(), as in the batch mode          	*/
+/* - relevance streams are indexed by the variable, so the standalone  	*/
+/*   assessment and MFE see the same relevances in any order           	*/
+/* - stored relevances are estimates: only a later run with the same    */
+/*   seed and number of samples reuses them                             */
+/* - stored results name the engine that computed them, AUTO resolved: */
+/*   another maxmem may choose another engine                           */
+/************************************************************************/
+
+// headers
+#include "mfesim.h"
+#include "plan.h"
+#include "metrics.h"
+#include "rng.h"
+#include "network.h"
+#include <sstream>
+#include <iomanip>
+#include <limits>
+#include <algorithm>
+
+std::string storeEngine(const dai::FactorGraph &fg)
+{
+    std::string sum = chooseEngine(fg, engineOptions("inference",std::string("SUMPROD"))).engine;
+    std::string max = chooseEngine(fg, engineOptions("inference",std::string("MAXPROD"))).engine;
+    std::string engine = (sum == max) ? sum : sum + "/" + max;
+
+    // the answers of a sampling engine depend on its random stream
+    auto samples = [](const std::string &name) { return (name.compare(0, 7, "MCGIBBS") == 0) || (name.compare(0, 5, "GIBBS") == 0); };
+    if (samples(sum) || samples(max))
+        engine += " seed=" + std::to_string(runSeed());
+    return engine;
+}
+
+std::string storeQuery(uint64_t network, const std::string &engine, const std::vector<unsigned int> &hypothesisVars,
+    const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues)
+{
+    std::vector<std::pair<unsigned int, unsigned int> > evidence;
+    for (size_t k = 0; k < evidenceVars.size(); k++)
+        evidence.push_back(std::make_pair(evidenceVars[k], evidenceValues[k]));
+    std::sort(evidence.begin(), evidence.end());
+    std::ostringstream os;
+    os << "net=" << std::hex << network << std::dec << " engine=" << engine << " H=";
+    for (auto h: hypothesisVars)
+        os << h << ",";
+    os << " e=";
+    for (auto const& e: evidence)
+        os << e.first << ":" << e.second << ",";
+    return os.str();
+}
+
+std::string mapKey(const std::string &query)
+{
+    return "MAP " + query;
+}
+
+std::string relevanceKey(const std::string &query, unsigned int node, unsigned long int samples, const std::vector<unsigned int> &intermediateVars)
+{
+    std::ostringstream os;
+    os << "REL node=" << node << " samples=" << samples;
+    if (samples > 0)
+        os << " seed=" << runSeed();
+    os << " I=";
+    for (auto i: intermediateVars)
+        os << i << ",";
+    return os.str() + " " + query;
+}
+
+std::string independenceKey(const std::string &query, bool strong, bool decision, const std::vector<unsigned int> &hypothesisValues,
+    const std::vector<unsigned int> &testVars)
+{
+    std::ostringstream os;
+    os << (strong ? "STRONG" : "WEAK") << " decision=" << decision << " h=";
+    for (auto h: hypothesisValues)
+        os << h << ",";
+    os << " R=";
+    for (auto r: testVars)
+        os << r << ",";
+    return os.str() + " " + query;
+}
+
+QueryPlan::QueryPlan(const dai::FactorGraph &fg, const std::vector<unsigned int> &hypothesisVars, const std::vector<unsigned int> &evidenceVars,
+    const std::vector<unsigned int> &evidenceValues, ResultStore *store) : _fg(fg), _hypothesisVars(hypothesisVars), _evidenceVars(evidenceVars),
+    _evidenceValues(evidenceValues), _reused(0), _store(store), _stored(0)
+{
+    _intermediateVars = getIntermediateVars(fg, hypothesisVars, evidenceVars);
+    if (_store != NULL)
+        _query = storeQuery(contentHash(fg), storeEngine(fg), hypothesisVars, evidenceVars, evidenceValues);
+}
+
+bool QueryPlan::lookup(const std::string &key, std::string &value)
+{
+    if ((_store == NULL) || !_store->get(key, value))
+        return false;
+    METRIC_COUNT(CACHE_HITS, 1);
+    _stored++;
+    return true;
+}
+
+static std::string realString(double x)
+{
+    std::ostringstream os;
+    os << std::setprecision(std::numeric_limits<double>::max_digits10) << x;
+    return os.str();
+}
+
+std::shared_ptr<InferenceEngine> QueryPlan::lease(bool maxProduct)
+{
+    InferenceEngine *engine = NULL;
+    {
+        std::lock_guard<std::mutex> guard(_engineLock);
+        if (!_idle[maxProduct].empty())
+        {
+            engine = _idle[maxProduct].back().release();
+            _idle[maxProduct].pop_back();
+        }
+    }
+    if (engine == NULL)
+        engine = newEngine(_fg, engineOptions("inference",std::string(maxProduct ? "MAXPROD" : "SUMPROD")));
+
+    return std::shared_ptr<InferenceEngine>(engine, [this, maxProduct](InferenceEngine *e)
+    {
+        std::lock_guard<std::mutex> guard(_engineLock);
+        _idle[maxProduct].push_back(std::unique_ptr<InferenceEngine>(e));
+    });
+}
+
+// the MAP and the relevances are computed without holding a lock and published under it, so no lock is held
+// while an engine waits for the shared pool (see threadpool.h). Two phases that ask at the same time may both
+// compute the answer, which is the same; the first one published is kept
+std::vector<unsigned long int> QueryPlan::map()
+{
+    {
+        std::lock_guard<std::mutex> guard(_mapLock);
+        if (_map)
+        {
+            METRIC_COUNT(CACHE_HITS, 1);
+            _reused++;
+            return *_map;
+        }
+    }
+
+    std::vector<unsigned long int> map;
+    std::string key = mapKey(_query), value;
+    if (lookup(key, value))
+    {
+        std::istringstream is(value);
+        for (unsigned long int h; is >> h; )
+            map.push_back(h);
+    }
+    else
+    {
+        map = get_map(*sumEngine(), _hypothesisVars, _evidenceVars, _evidenceValues, false);
+        if (_store != NULL)
+        {
+            std::ostringstream os;
+            for (auto h: map)
+                os << h << " ";
+            _store->put(key, os.str());
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(_mapLock);
+    if (!_map)
+        _map.reset(new std::vector<unsigned long int>(map));
+    return *_map;
+}
+
+std::vector<unsigned int> QueryPlan::mapValues()
+{
+    std::vector<unsigned int> values;
+    for (const unsigned long int &h: map()) { values.push_back((unsigned int) h); }
+    return values;
+}
+
+double QueryPlan::relevance(unsigned int node, unsigned long int samples)
+{
+    auto key = std::make_pair(node, samples);
+    {
+        std::lock_guard<std::mutex> guard(_relevanceLock);
+        auto r = _relevance.find(key);
+        if (r != _relevance.end())
+        {
+            METRIC_COUNT(CACHE_HITS, 1);
+            _reused++;
+            return r->second;
+        }
+    }
+
+    double rel;
+    std::string stored, storeName = relevanceKey(_query, node, samples, _intermediateVars);
+    if (lookup(storeName, stored))
+        rel = std::atof(stored.c_str());
+    else
+    {
+        std::mt19937 gen = indexedStream("relevance", node);
+        rel = ::relevance(*maxEngine(), node, _evidenceVars, _evidenceValues, _hypothesisVars, _intermediateVars, samples, gen);
+        if (_store != NULL)
+            _store->put(storeName, realString(rel));
+    }
+
+    std::lock_guard<std::mutex> guard(_relevanceLock);
+    return _relevance.insert(std::make_pair(key, rel)).first->second;
+}
+
+double QueryPlan::independence(bool strong, const std::vector<unsigned int> &testVars, unsigned long int cutoffTime, bool decision)
+{
+    std::vector<unsigned int> hypothesisValues = mapValues();
+    std::string name = independenceKey(_query, strong, decision, hypothesisValues, testVars), value;
+    if (lookup(name, value))
+        return std::atof(value.c_str());
+
+    double measure = strong ?
+        strong_map_indep_measure(*sumEngine(), _evidenceVars, _evidenceValues, _hypothesisVars, hypothesisValues, testVars, cutoffTime, decision) :
+        weak_map_indep_measure(*sumEngine(), _evidenceVars, _evidenceValues, _hypothesisVars, hypothesisValues, testVars, cutoffTime, decision);
+    if (_store != NULL)
+        _store->put(name, realString(measure));
+    return measure;
+}
+
+void QueryPlan::splitRelevant(unsigned long int samples, double threshold, std::vector<unsigned int> &relevantVars,
+    std::vector<unsigned int> &irrelevantVars)
+{
+    METRIC_PHASE("MFE.relevance");
+    relevantVars.clear();
+    irrelevantVars.clear();
+    for (auto inter: _intermediateVars)
+    {
+        if (relevance(inter, samples) >= threshold)
+            relevantVars.push_back(inter);
+        else
+            irrelevantVars.push_back(inter);
+    }
+}
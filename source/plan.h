@@ -0,0 +1,94 @@
+#ifndef PLANHEADER
+#define PLANHEADER
+
+// STL includes
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include "dai/factorgraph.h"
+#include "engine.h"
+#include "store.h"
+
+// the sum- and max-product engines that answer queries on fg as chooseEngine() resolves them (AUTO depends on
+// maxmem), with the run seed if one of them samples; computed once per network, it is not cheap
+std::string storeEngine(const dai::FactorGraph &fg);
+
+// The keys of the result store (store.h). A key is the algorithm with its parameters followed by the query:
+// the network by its contents (contentHash in network.h), the engines (storeEngine), the hypotheses in their
+// order (the order of the answers) and the evidence sorted by variable. Sampled relevances carry the run seed
+// (rng.h), so a run with --seed only finds relevances estimated with that seed.
+std::string storeQuery(uint64_t network, const std::string &engine, const std::vector<unsigned int> &hypothesisVars,
+    const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues);
+std::string mapKey(const std::string &query);
+std::string relevanceKey(const std::string &query, unsigned int node, unsigned long int samples, const std::vector<unsigned int> &intermediateVars);
+std::string independenceKey(const std::string &query, bool strong, bool decision, const std::vector<unsigned int> &hypothesisValues,
+    const std::vector<unsigned int> &testVars);
+
+// The shared computations of one query (hypotheses H, evidence E = e) when a single run asks several
+// algorithms about it, as mfesim does with -d -W -M -F together. The MAP of H given e (which the
+// independence tests start from) is computed once, and the relevance of every intermediate variable is
+// assessed once for the standalone assessment and MFE (unless two phases ask at the same time). Engines are lent out: an engine that is returned is
+// handed to the next algorithm instead of building a new one, and algorithms that run at the same time
+// (see phases.h) each get their own. Everything is computed on first use, so a run only pays for what its
+// algorithms need. With a result store (store.h), MAPs, relevances and independence measures are looked up
+// there first and stored once computed, so they are shared with earlier and later runs as well. All members
+// may be called from several threads.
+class QueryPlan
+{
+    public:
+        QueryPlan(const dai::FactorGraph &fg, const std::vector<unsigned int> &hypothesisVars, const std::vector<unsigned int> &evidenceVars,
+            const std::vector<unsigned int> &evidenceValues, ResultStore *store = NULL);
+
+        // a sum- or max-product engine, returned to the plan when the last copy of the pointer goes
+        std::shared_ptr<InferenceEngine> sumEngine() { return lease(false); }
+        std::shared_ptr<InferenceEngine> maxEngine() { return lease(true); }
+
+        // the MAP of the hypotheses given the evidence, and the same as values to test independence against
+        std::vector<unsigned long int> map();
+        std::vector<unsigned int> mapValues();
+
+        // the intermediate variables (neither hypothesis nor evidence)
+        const std::vector<unsigned int> &intermediateVars() const { return _intermediateVars; }
+
+        // the relevance of an intermediate variable, assessed with this many samples (0 = exactly) on a random
+        // stream of its own, so it does not depend on the order in which relevances are asked for
+        double relevance(unsigned int node, unsigned long int samples);
+
+        // the (quantified) strong or weak MAP independence of testVars, as strong_map_indep_measure and
+        // weak_map_indep_measure
+        double independence(bool strong, const std::vector<unsigned int> &testVars, unsigned long int cutoffTime, bool decision);
+
+        // splits the intermediate variables by a relevance threshold (as MFE does with relevance computation)
+        void splitRelevant(unsigned long int samples, double threshold, std::vector<unsigned int> &relevantVars,
+            std::vector<unsigned int> &irrelevantVars);
+
+        // the number of MAPs and relevances answered from an earlier computation
+        size_t reused() const { return _reused; }
+
+        // the number of results found in the result store
+        size_t stored() const { return _stored; }
+
+    private:
+        std::shared_ptr<InferenceEngine> lease(bool maxProduct);
+        bool lookup(const std::string &key, std::string &value);
+
+        const dai::FactorGraph &_fg;
+        std::vector<unsigned int> _hypothesisVars;
+        std::vector<unsigned int> _evidenceVars;
+        std::vector<unsigned int> _evidenceValues;
+        std::vector<unsigned int> _intermediateVars;
+        std::vector<std::unique_ptr<InferenceEngine> > _idle[2];                    // returned sum- and max-product engines
+        std::unique_ptr<std::vector<unsigned long int> > _map;
+        std::map<std::pair<unsigned int, unsigned long int>, double> _relevance;    // (node, samples) -> relevance
+        std::mutex _engineLock;
+        std::mutex _mapLock;            // the locks guard the members only, never a computation
+        std::mutex _relevanceLock;
+        std::atomic<size_t> _reused;
+        ResultStore *_store;
+        std::string _query;             // as in the keys of the store (storeQuery)
+        std::atomic<size_t> _stored;
+};
+
+#endif // defined PLANHEADER
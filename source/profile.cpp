@@ -0,0 +1,184 @@
+/************************************************************************/
+/* Anytime quality-versus-time profiles        					        */
+/* Version:			1.0													*/
+/* Last changed:	18-10-2026                                         	*/
+/*                                                                     	*/
+/* Version History:                                                    	*/
+/*                                                                     	*/
+/* Version Comments:                                                   	*/
+/* - the times include building the engine, as in a deployment that    	*/
+/*   answers a single query; the time spent scoring snapshots is left  	*/
+/*   out                                                               	*/
+/* - MFE assumes all intermediate variables irrelevant (no relevance   	*/
+/*   assessment)                                                       	*/
+/************************************************************************/
+
+// headers
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include "mfesim.h"
+#include "forward.h"
+#include "profile.h"
+
+static const double thresholds[] = { 0.9, 0.99, 1.0 };
+static const size_t nrThresholds = sizeof(thresholds) / sizeof(thresholds[0]);
+static const double scoreTolerance = 1e-9;
+
+// the rows of one algorithm on one query, and when it first reached each threshold
+class Curve
+{
+    public:
+        Curve(const std::string &algorithm, size_t query, std::ostream &os) : _algorithm(algorithm), _query(query), _os(os),
+            _first(nrThresholds, -1.0) {}
+
+        void record(unsigned long int step, double ms, double score)
+        {
+            _os << _query << "," << _algorithm << "," << step << "," << ms << "," << score << std::endl;
+            for (size_t t = 0; t < nrThresholds; t++)
+                if ((_first[t] < 0.0) && (score >= thresholds[t] - scoreTolerance))
+                    _first[t] = ms;
+        }
+
+        const std::string &algorithm() const { return _algorithm; }
+
+        // the time it took to reach threshold t, negative if it was not reached
+        double first(size_t t) const { return _first[t]; }
+
+    private:
+        std::string _algorithm;
+        size_t _query;
+        std::ostream &_os;
+        std::vector<double> _first;
+};
+
+static size_t property(const dai::PropertySet &opts, const char *key, size_t value)
+{
+    return opts.hasKey(key) ? opts.getStringAs<size_t>(key) : value;
+}
+
+static double milliseconds(std::chrono::steady_clock::duration d)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count() / 1e6;
+}
+
+// count variables chosen at random from those not in taken
+static std::vector<unsigned int> randomVars(const dai::FactorGraph &fg, const std::vector<unsigned int> &taken, size_t count, std::mt19937 &rng)
+{
+    std::vector<unsigned int> free;
+    for (unsigned int i = 0; i < fg.nrVars(); i++)
+        if (std::find(taken.begin(), taken.end(), i) == taken.end())
+            free.push_back(i);
+    std::shuffle(free.begin(), free.end(), rng);
+    free.resize(std::min(count, free.size()));
+    std::sort(free.begin(), free.end());
+    return free;
+}
+
+void runProfile(const dai::FactorGraph &fg, const std::vector<unsigned int> &hypothesisVars, const std::vector<unsigned int> &evidenceVars,
+    const dai::PropertySet &opts, std::ostream &os)
+{
+    size_t queries = property(opts, "queries", 20);
+    size_t step = std::max((size_t) 1, property(opts, "step", 10));
+    unsigned long int samples = property(opts, "samples", 1000);
+    unsigned long int cutoffTime = property(opts, "time", 60);
+    size_t seed = property(opts, "seed", 1);
+    std::mt19937 rng(seed);
+    ForwardSampler sampler(fg, dai::PropertySet()("threads",(size_t) 1)("seed",seed));
+
+    // per algorithm and threshold: the times of the queries that reached it
+    std::map<std::string, std::vector<std::vector<double> > > reached;
+
+    os << "query,algorithm,step,ms,score" << std::endl;
+    for (size_t q = 0; q < queries; q++)
+    {
+        // the query: hypotheses sorted by index, which is the order of the answers of all algorithms
+        std::vector<unsigned int> H(hypothesisVars), E(evidenceVars);
+        std::sort(H.begin(), H.end());
+        if (H.empty())
+            H = randomVars(fg, E, property(opts, "hypotheses", 3), rng);
+        if (E.empty())
+            E = randomVars(fg, H, property(opts, "evidence", 3), rng);
+        std::vector<unsigned int> state, values;
+        sampler.draw(state);
+        for (auto e: E)
+            values.push_back(state[e]);
+        std::vector<unsigned int> I = getIntermediateVars(fg, H, E);
+
+        // exact MAP, and the posterior of every assignment to score the snapshots with
+        Curve exact("MAP", q, os);
+        auto start = std::chrono::steady_clock::now();
+        std::unique_ptr<InferenceEngine> jt(newEngine(fg, engineOptions("inference",std::string("SUMPROD"))));
+        std::vector<unsigned long int> map = get_map(*jt, H, E, values, false);
+        double mapMs = milliseconds(std::chrono::steady_clock::now() - start);
+
+        dai::VarSet hypSet;
+        for (auto h: H)
+            hypSet.insert(fg.var(h));
+        std::vector<dai::Real> posterior;
+        jt->run(E, values);
+        jt->calcMarginal(hypSet, posterior);
+        dai::Real best = *std::max_element(posterior.begin(), posterior.end());
+        auto score = [&](const std::vector<unsigned long int> &h) -> double
+        {
+            if ((h.size() != H.size()) || (best <= 0.0))
+                return 0.0;
+            std::map<dai::Var, size_t> assignment;
+            for (size_t k = 0; k < H.size(); k++)
+                assignment[fg.var(H[k])] = h[k];
+            return posterior[dai::calcLinearState(hypSet, assignment)] / best;
+        };
+        exact.record(1, mapMs, score(map));
+
+        // the anytime algorithms; the clock stops while a snapshot is scored
+        std::chrono::steady_clock::duration paused = std::chrono::steady_clock::duration::zero();
+        auto snapshot = [&](Curve &curve, unsigned long int n, const std::vector<unsigned long int> &answer)
+        {
+            auto now = std::chrono::steady_clock::now();
+            curve.record(n, milliseconds(now - start - paused), score(answer));
+            paused += std::chrono::steady_clock::now() - now;
+        };
+
+        Curve mfe("MFE", q, os);
+        start = std::chrono::steady_clock::now();
+        jt.reset(newEngine(fg, engineOptions("inference",std::string("SUMPROD"))));
+        compute_MFE(fg, *jt, *jt, E, values, H, std::vector<unsigned int>(), I, false, 0, 0.0, samples, cutoffTime,
+            [&](unsigned long int votes, const std::vector<unsigned long int> &leader)
+            {
+                if ((votes % step == 0) || (votes == samples))
+                    snapshot(mfe, votes, leader);
+            });
+
+        Curve ann("ANN", q, os);
+        paused = std::chrono::steady_clock::duration::zero();
+        start = std::chrono::steady_clock::now();
+        jt.reset(newEngine(fg, engineOptions("inference",std::string("SUMPROD"))));
+        annealed_map(*jt, H, E, values, cutoffTime,
+            [&](unsigned long int iteration, const std::vector<unsigned long int> &current) { snapshot(ann, iteration, current); });
+
+        for (const Curve *c: { &exact, &mfe, &ann })
+        {
+            std::vector<std::vector<double> > &times = reached[c->algorithm()];
+            times.resize(nrThresholds);
+            for (size_t t = 0; t < nrThresholds; t++)
+                if (c->first(t) >= 0.0)
+                    times[t].push_back(c->first(t));
+        }
+    }
+
+    // time to quality: median and 95th percentile over the queries that reached the score
+    for (auto &a: reached)
+    {
+        for (size_t t = 0; t < nrThresholds; t++)
+        {
+            std::vector<double> &times = a.second[t];
+            std::sort(times.begin(), times.end());
+            os << "# " << a.first << " score >= " << thresholds[t] << ": reached in " << times.size() << " of " << queries << " queries";
+            if (!times.empty())
+                os << ", median " << times[times.size() / 2] << " ms, p95 "
+                   << times[std::min(times.size() - 1, (size_t) std::ceil(0.95 * times.size()) - 1)] << " ms";
+            os << std::endl;
+        }
+    }
+}
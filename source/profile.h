@@ -0,0 +1,23 @@
+#ifndef PROFILEHEADER
+#define PROFILEHEADER
+
+// STL includes
+#include <iostream>
+#include <vector>
+#include "dai/factorgraph.h"
+#include "dai/properties.h"
+
+// Anytime profiles: how the answers of MFE and Annealed MAP improve with the time they get, compared with
+// exact MAP. Every query has random evidence values (from a forward sample, so the evidence is possible)
+// and, unless hypothesisVars and evidenceVars are given, random hypothesis and evidence variables. The
+// anytime algorithms report their current answer through a SnapshotHook (MFE every 'step' votes,
+// Annealed MAP every iteration), and every snapshot is scored as Pr(h | e) / Pr(hMAP | e), so 1 means the
+// MAP was found. Written as CSV rows (query, algorithm, step, ms, score), followed by a summary per
+// algorithm of the time it takes to reach a score of 0.9, 0.99 and 1 (median and 95th percentile over the
+// queries that reach it) as comment lines starting with '#'.
+// Properties: queries (20), hypotheses and evidence (number of random variables, 3), step (10), samples
+// (MFE votes, 1000), time (cutoff in seconds, 60) and seed (1).
+void runProfile(const dai::FactorGraph &fg, const std::vector<unsigned int> &hypothesisVars, const std::vector<unsigned int> &evidenceVars,
+    const dai::PropertySet &opts, std::ostream &os);
+
+#endif // defined PROFILEHEADER
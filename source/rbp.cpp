@@ -0,0 +1,381 @@
+/************************************************************************/
+/* Parallel residual belief propagation       					        */
+/* Version:			1.0													*/
+/* Last changed:	18-10-2026                                         	*/
+/*                                                                     	*/
+/* Version History:                                                    	*/
+/*                                                                     	*/
+/* Version Comments:                                                   	*/
+/* - only factor-to-variable messages are stored; the variable-to-      */
+/*   factor messages (cavities) are multiplied together when needed,    */
+/*   without dividing, so max-product with zeros is safe.               */
+/* - the batch is chosen by residual with ties broken on the edge       */
+/*   number, which keeps runs reproducible.                             */
+/************************************************************************/
+
+// headers
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include "dai/alldai.h"
+#include "rbp.h"
+
+static const size_t npos = (size_t) -1;
+
+ParallelRBP::ParallelRBP(const dai::FactorGraph &fg, const dai::PropertySet &engineOpts) : props(), _rounds(0), _maxDiff(0.0)
+{
+    // properties given with the engine name, as in RBP[tol=1e-6,batch=256], override the others
+    dai::PropertySet opts(engineOpts);
+    if (opts.hasKey("algorithm"))
+        opts.set(dai::parseNameProperties(opts.getStringAs<std::string>("algorithm")).second);
+
+    props.inference = Properties::InfType::SUMPROD;
+    if (opts.hasKey("inference"))
+        props.inference = opts.getStringAs<Properties::InfType>("inference");
+    props.threads = 1;
+    if (opts.hasKey("threads"))
+        props.threads = opts.getStringAs<size_t>("threads");
+    props.maxiter = 10000;
+    if (opts.hasKey("maxiter"))
+        props.maxiter = opts.getStringAs<size_t>("maxiter");
+    props.tol = 1e-9;
+    if (opts.hasKey("tol"))
+        props.tol = opts.getStringAs<dai::Real>("tol");
+    props.batch = 0;
+    if (opts.hasKey("batch"))
+        props.batch = opts.getStringAs<size_t>("batch");
+    props.warmstart = true;
+    if (opts.hasKey("warmstart"))
+        props.warmstart = opts.getStringAs<bool>("warmstart");
+    _pool = (props.threads > 1) ? &ThreadPool::shared(props.threads) : NULL;
+
+    _vars = fg.vars();
+    for (size_t i = 0; i < _vars.size(); i++)
+        _label2index[_vars[i].label()] = i;
+    _factors = fg.factors();
+
+    _varEdges.resize(_vars.size());
+    size_t offset = 0;
+    for (size_t I = 0; I < _factors.size(); I++)
+    {
+        _factorEdges.push_back(_edgeFactor.size());
+        _factorVars.push_back(std::vector<size_t>());
+        size_t pos = 0;
+        for (auto const& v: _factors[I].vars())
+        {
+            size_t i = _label2index[v.label()];
+            _factorVars[I].push_back(i);
+            _varEdges[i].push_back(_edgeFactor.size());
+            _edgeFactor.push_back(I);
+            _edgePos.push_back(pos++);
+            _edgeVar.push_back(i);
+            _edgeOffset.push_back(offset);
+            offset += v.states();
+        }
+    }
+    _edgeOffset.push_back(offset);
+
+    _msgs.resize(offset);
+    for (size_t e = 0; e < _edgeVar.size(); e++)
+        std::fill(_msgs.begin() + _edgeOffset[e], _msgs.begin() + _edgeOffset[e + 1], 1.0 / _vars[_edgeVar[e]].states());
+    _cand = _msgs;
+    _residual.assign(_edgeVar.size(), 0.0);
+    _evidence.assign(_vars.size(), npos);
+    if (props.batch == 0)
+        props.batch = std::max((size_t) 1, _edgeVar.size() / 16);
+}
+
+void ParallelRBP::cavity(size_t I, size_t skip, std::vector<dai::Real> &cav) const
+{
+    // for every variable of I except the one at position skip: evidence times the messages of its other factors
+    cav.clear();
+    const std::vector<size_t> &vars = _factorVars[I];
+    for (size_t p = 0; p < vars.size(); p++)
+    {
+        size_t j = vars[p];
+        size_t card = _vars[j].states();
+        size_t first = cav.size();
+        if (_evidence[j] == npos)
+            cav.resize(first + card, 1.0);
+        else
+        {
+            cav.resize(first + card, 0.0);
+            cav[first + _evidence[j]] = 1.0;
+        }
+        if (p == skip)
+            continue;
+
+        dai::Real sum = 0.0;
+        for (auto e: _varEdges[j])
+        {
+            if (_edgeFactor[e] == I)
+                continue;
+            const dai::Real *m = &_msgs[_edgeOffset[e]];
+            for (size_t x = 0; x < card; x++)
+                cav[first + x] *= m[x];
+        }
+        for (size_t x = 0; x < card; x++)
+            sum += cav[first + x];
+        if (sum > 0.0)
+            for (size_t x = 0; x < card; x++)
+                cav[first + x] /= sum;
+    }
+}
+
+void ParallelRBP::update(const std::vector<size_t> &edges)
+{
+    // recompute the pending message (and its residual) of every edge; reads only committed messages
+    bool maximize = (props.inference == Properties::InfType::MAXPROD);
+    auto body = [this, &edges, maximize](size_t begin, size_t end)
+    {
+        std::vector<dai::Real> cav;
+        std::vector<size_t> first, count;
+        for (size_t n = begin; n < end; n++)
+        {
+            size_t e = edges[n];
+            size_t I = _edgeFactor[e];
+            size_t k = _edgePos[e];
+            const std::vector<size_t> &vars = _factorVars[I];
+            cavity(I, k, cav);
+
+            first.assign(vars.size(), 0);
+            count.assign(vars.size(), 0);
+            for (size_t p = 1; p < vars.size(); p++)
+                first[p] = first[p - 1] + _vars[vars[p - 1]].states();
+
+            size_t card = _vars[_edgeVar[e]].states();
+            dai::Real *out = &_cand[_edgeOffset[e]];
+            std::fill(out, out + card, 0.0);
+            const dai::Factor &f = _factors[I];
+            for (size_t t = 0; t < f.nrStates(); t++)
+            {
+                dai::Real value = f[t];
+                for (size_t p = 0; (p < vars.size()) && (value != 0.0); p++)
+                    if (p != k)
+                        value *= cav[first[p] + count[p]];
+                out[count[k]] = maximize ? std::max(out[count[k]], value) : out[count[k]] + value;
+
+                for (size_t p = 0; p < vars.size(); p++)
+                {
+                    if (++count[p] < _vars[vars[p]].states())
+                        break;
+                    count[p] = 0;
+                }
+            }
+
+            dai::Real sum = 0.0;
+            for (size_t x = 0; x < card; x++)
+                sum += out[x];
+            for (size_t x = 0; x < card; x++)
+                out[x] = (sum > 0.0) ? out[x] / sum : 1.0 / card;
+
+            const dai::Real *old = &_msgs[_edgeOffset[e]];
+            dai::Real residual = 0.0;
+            for (size_t x = 0; x < card; x++)
+                residual = std::max(residual, std::fabs(out[x] - old[x]));
+            _residual[e] = residual;
+        }
+    };
+
+    if (_pool != NULL)
+        _pool->parallel_for(edges.size(), 64, body);
+    else
+        body(0, edges.size());
+}
+
+void ParallelRBP::run(const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues)
+{
+    std::fill(_evidence.begin(), _evidence.end(), npos);
+    for (size_t k = 0; k < evidenceVars.size(); k++)
+        _evidence[evidenceVars[k]] = evidenceValues[k];
+    if (!props.warmstart)
+        for (size_t e = 0; e < _edgeVar.size(); e++)
+            std::fill(_msgs.begin() + _edgeOffset[e], _msgs.begin() + _edgeOffset[e + 1], 1.0 / _vars[_edgeVar[e]].states());
+
+    std::vector<size_t> edges(_edgeVar.size());
+    for (size_t e = 0; e < edges.size(); e++)
+        edges[e] = e;
+    update(edges);
+
+    std::vector<bool> dirty(_edgeVar.size(), false);
+    std::vector<size_t> active;
+    auto larger = [this](size_t a, size_t b) { return (_residual[a] > _residual[b]) || ((_residual[a] == _residual[b]) && (a < b)); };
+
+    for (_rounds = 0; _rounds < props.maxiter; _rounds++)
+    {
+        active.clear();
+        _maxDiff = 0.0;
+        for (size_t e = 0; e < _residual.size(); e++)
+        {
+            _maxDiff = std::max(_maxDiff, _residual[e]);
+            if (_residual[e] > props.tol)
+                active.push_back(e);
+        }
+        if (active.empty())
+            break;
+
+        // relaxed residual schedule: commit the largest residuals of this round together
+        if (active.size() > props.batch)
+        {
+            std::nth_element(active.begin(), active.begin() + props.batch, active.end(), larger);
+            active.resize(props.batch);
+        }
+        for (auto e: active)
+        {
+            std::copy(_cand.begin() + _edgeOffset[e], _cand.begin() + _edgeOffset[e + 1], _msgs.begin() + _edgeOffset[e]);
+            _residual[e] = 0.0;
+        }
+
+        // messages out of the other factors of the receiving variables have new inputs
+        edges.clear();
+        for (auto e: active)
+        {
+            size_t i = _edgeVar[e];
+            for (auto in: _varEdges[i])
+            {
+                size_t J = _edgeFactor[in];
+                if (J == _edgeFactor[e])
+                    continue;
+                for (size_t out = _factorEdges[J]; out < _factorEdges[J] + _factorVars[J].size(); out++)
+                    if ((_edgeVar[out] != i) && !dirty[out])
+                    {
+                        dirty[out] = true;
+                        edges.push_back(out);
+                    }
+            }
+        }
+        for (auto e: edges)
+            dirty[e] = false;
+        update(edges);
+    }
+}
+
+dai::Factor ParallelRBP::belief(const dai::Var &v)
+{
+    size_t i = _label2index[v.label()];
+    dai::Factor result(v, 1.0);
+    if (_evidence[i] != npos)
+    {
+        result.fill(0.0);
+        result.set(_evidence[i], 1.0);
+        return result;
+    }
+    for (auto e: _varEdges[i])
+        for (size_t x = 0; x < v.states(); x++)
+            result.set(x, result[x] * _msgs[_edgeOffset[e] + x]);
+    if (result.sum() > 0.0)
+        result.normalize();
+    return result;
+}
+
+dai::Factor ParallelRBP::factorBelief(size_t I) const
+{
+    // the factor times the cavity distributions of all its variables
+    std::vector<dai::Real> cav;
+    cavity(I, npos, cav);
+    dai::Factor result = _factors[I];
+    size_t first = 0;
+    for (size_t p = 0; p < _factorVars[I].size(); p++)
+    {
+        const dai::Var &v = _vars[_factorVars[I][p]];
+        dai::Factor c(v, 0.0);
+        for (size_t x = 0; x < v.states(); x++)
+            c.set(x, cav[first + x]);
+        result *= c;
+        first += v.states();
+    }
+    return result;
+}
+
+dai::Factor ParallelRBP::calcMarginal(const dai::VarSet &vs)
+{
+    bool maximize = (props.inference == Properties::InfType::MAXPROD);
+
+    // from a factor belief if one factor contains vs, otherwise as if the variables were independent
+    dai::Factor result(vs, 1.0);
+    size_t best = npos;
+    for (size_t I = 0; I < _factors.size(); I++)
+        if ((vs << _factors[I].vars()) && ((best == npos) || (_factors[I].nrStates() < _factors[best].nrStates())))
+            best = I;
+    if (best != npos)
+    {
+        dai::Factor b = factorBelief(best);
+        result = maximize ? b.maxMarginal(vs, false) : b.marginal(vs, false);
+    }
+    else
+    {
+        for (auto const& v: vs)
+            result *= belief(v);
+    }
+    if (result.sum() > 0.0)
+        result.normalize();
+    return result;
+}
+
+void ParallelRBP::calcMarginal(const dai::VarSet &vs, std::vector<dai::Real> &marginal)
+{
+    dai::Factor result = calcMarginal(vs);
+    marginal.assign(result.p().begin(), result.p().end());
+}
+
+std::vector<size_t> ParallelRBP::findMaximum()
+{
+    // decode breadth first: each variable takes its best state in the belief of the factor through which
+    // it was reached, given the variables of that factor that were decoded before it
+    std::vector<size_t> maximum(_vars.size(), 0);
+    std::vector<bool> assigned(_vars.size(), false);
+    for (size_t i = 0; i < _vars.size(); i++)
+        if (_evidence[i] != npos)
+        {
+            maximum[i] = _evidence[i];
+            assigned[i] = true;
+        }
+
+    std::vector<size_t> via(_vars.size(), npos);
+    std::vector<bool> queued(_vars.size(), false);
+    for (size_t start = 0; start < _vars.size(); start++)
+    {
+        if (queued[start])
+            continue;
+        std::queue<size_t> order;
+        order.push(start);
+        queued[start] = true;
+        while (!order.empty())
+        {
+            size_t i = order.front();
+            order.pop();
+            if (!assigned[i])
+            {
+                dai::Factor scores = belief(_vars[i]);
+                if (via[i] != npos)
+                {
+                    dai::Factor b = factorBelief(via[i]);
+                    std::map<dai::Var, size_t> state;
+                    scores.fill(0.0);
+                    for (size_t t = 0; t < b.nrStates(); t++)
+                    {
+                        state = dai::calcState(b.vars(), t);
+                        bool consistent = true;
+                        for (auto j: _factorVars[via[i]])
+                            if ((j != i) && assigned[j] && (state[_vars[j]] != maximum[j]))
+                                consistent = false;
+                        size_t x = state[_vars[i]];
+                        if (consistent && (b[t] > scores[x]))
+                            scores.set(x, b[t]);
+                    }
+                }
+                maximum[i] = scores.p().argmax().first;
+                assigned[i] = true;
+            }
+            for (auto e: _varEdges[i])
+                for (auto j: _factorVars[_edgeFactor[e]])
+                    if (!queued[j])
+                    {
+                        queued[j] = true;
+                        via[j] = _edgeFactor[e];
+                        order.push(j);
+                    }
+        }
+    }
+    return maximum;
+}
@@ -0,0 +1,77 @@
+#ifndef RBPHEADER
+#define RBPHEADER
+
+// STL includes
+#include <vector>
+#include <map>
+#include <string>
+#include "dai/factorgraph.h"
+#include "dai/varset.h"
+#include "dai/enum.h"
+#include "dai/properties.h"
+#include "engine.h"
+#include "threadpool.h"
+
+// Loopy belief propagation (sum- or max-product) with relaxed residual scheduling on the shared thread
+// pool. Every round commits the 'batch' pending messages with the largest residuals (instead of the
+// single largest, as libDAI's BP with updates=SEQMAX does) and then recomputes, in parallel, only the
+// messages that depend on them. Reading and writing messages happen in separate phases, so no locking
+// is needed and convergence (no residual above tol) is detected exactly, whatever the number of threads.
+// Messages are kept between runs, so a run with slightly different evidence starts from the last fixed point.
+class ParallelRBP : public InferenceEngine
+{
+    public:
+        struct Properties
+        {
+            DAI_ENUM(InfType,SUMPROD,MAXPROD);
+            InfType inference;      // sum-product (marginals, MAP) or max-product (MPE)
+            size_t threads;         // 1 = sequential
+            size_t maxiter;         // maximum number of rounds
+            dai::Real tol;          // convergence: largest residual of a message
+            size_t batch;           // messages committed per round (0 = one sixteenth of all messages)
+            bool warmstart;         // start from the messages of the previous run
+        } props;
+
+        ParallelRBP(const dai::FactorGraph &fg, const dai::PropertySet &opts);
+
+        std::string name() const { return "RBP"; }
+
+        void run(const std::vector<unsigned int> &evidenceVars, const std::vector<unsigned int> &evidenceValues);
+
+        dai::Factor belief(const dai::Var &v);
+        dai::Factor calcMarginal(const dai::VarSet &vs);
+        void calcMarginal(const dai::VarSet &vs, std::vector<dai::Real> &marginal);
+        std::vector<size_t> findMaximum();
+
+        const dai::Var &var(size_t i) const { return _vars[i]; }
+        size_t nrVars() const { return _vars.size(); }
+        size_t iterations() const { return _rounds; }
+        dai::Real maxDiff() const { return _maxDiff; }
+
+    private:
+        void update(const std::vector<size_t> &edges);
+        void cavity(size_t I, size_t skip, std::vector<dai::Real> &cav) const;
+        dai::Factor factorBelief(size_t I) const;
+
+        std::vector<dai::Var> _vars;
+        std::map<size_t, size_t> _label2index;
+        std::vector<dai::Factor> _factors;
+        std::vector<std::vector<size_t> > _factorVars;  // per factor: its variables (libDAI order)
+        std::vector<size_t> _factorEdges;               // per factor: its first edge (one edge per variable)
+
+        // edge e is the message from factor _edgeFactor[e] to the variable at position _edgePos[e] in it
+        std::vector<size_t> _edgeFactor, _edgePos, _edgeVar;
+        std::vector<size_t> _edgeOffset;                // first entry of the message in _msgs and _cand
+        std::vector<std::vector<size_t> > _varEdges;    // per variable: edges towards it
+
+        std::vector<dai::Real> _msgs;                   // committed messages
+        std::vector<dai::Real> _cand;                   // recomputed (pending) messages
+        std::vector<dai::Real> _residual;               // per edge: distance between pending and committed
+        std::vector<size_t> _evidence;                  // per variable: observed state (or npos)
+
+        ThreadPool *_pool;
+        size_t _rounds;
+        dai::Real _maxDiff;
+};
+
+#endif // defined RBPHEADER
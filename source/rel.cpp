@@ -13,16 +13,26 @@
 
 // headers
 #include "mfesim.h"
+#include "metrics.h"
 #include "dai/alldai.h"
 #include "dai/jtree.h"
 
 // compute the relevance of a variable
 double relevance(dai::FactorGraph fg, unsigned int node, std::vector<unsigned int> evidence_vars, std::vector<unsigned int> evidence_values, 
-	std::vector<unsigned int> hypothesis_vars, std::vector<unsigned int> intermediate_vars, unsigned long int samples, std::mt19937 rngen)
+	std::vector<unsigned int> hypothesis_vars, std::vector<unsigned int> intermediate_vars, unsigned long int samples, std::mt19937 &rngen)
+{
+    std::unique_ptr<InferenceEngine> jt(newEngine(fg, engineOptions("inference",std::string("MAXPROD"))));
+    return relevance(*jt, node, evidence_vars, evidence_values, hypothesis_vars, intermediate_vars, samples, rngen);
+}
+
+// as above, using a (max-product) junction tree that is shared between calls
+double relevance(InferenceEngine &jt, unsigned int node, const std::vector<unsigned int> &evidence_vars, const std::vector<unsigned int> &evidence_values, 
+	const std::vector<unsigned int> &hypothesis_vars, const std::vector<unsigned int> &intermediate_vars, unsigned long int samples, std::mt19937 &rngen)
 {
 	// if samples = 0, relevance is computed exactly, otherwise by that amount of samples over the intermediate variables
 	// algorithm: compute (approximate) the fraction of joint value assignments to the intermediate variables (other than node)
 	// for which the value of node changes the MPE.
+	METRIC_SPAN("REL.relevance", "node=" + std::to_string(node) + " samples=" + std::to_string(samples));
 
     unsigned long int non_equals = 0, iteration = 0, max_iterations = 1;
     unsigned int nr_int_vars = intermediate_vars.size();
@@ -56,7 +66,7 @@ double relevance(dai::FactorGraph fg, unsigned int node, std::vector<unsigned in
     // initialize values to zeros, set maximum values per variable, and set max_interations to total joint value assignments;
     for (auto inter: intermediate_vars)
     {
-        unsigned int st = fg.var(inter).states();
+        unsigned int st = jt.var(inter).states();
          
         intermediate_values.push_back(0);
         intermediate_max_values.push_back(st - 1);
@@ -85,7 +95,7 @@ double relevance(dai::FactorGraph fg, unsigned int node, std::vector<unsigned in
         std::copy(evidence_values.begin(), evidence_values.end(), back_inserter(ev_values));
 
         ev_values[node_index] = 0;
-        mpe_cmp = get_mpe(fg, ev_vars, ev_values);
+        mpe_cmp = get_mpe(jt, ev_vars, ev_values);
                         
         // test whether MPE are all equal or not
         for (unsigned int i = 1; i <= intermediate_max_values[node_index]; i++)
@@ -94,7 +104,7 @@ double relevance(dai::FactorGraph fg, unsigned int node, std::vector<unsigned in
 
             // set value of node to test and copy the values of this sample to the total evidence
             ev_values[node_index] = i;
-            mpe = get_mpe(fg, ev_vars, ev_values);
+            mpe = get_mpe(jt, ev_vars, ev_values);
 
             for (auto it: hypothesis_vars)
             {
@@ -120,6 +130,7 @@ double relevance(dai::FactorGraph fg, unsigned int node, std::vector<unsigned in
 		{
         	// random sample
 	        random_sample(nr_int_vars - 1, node_index, intermediate_values, intermediate_max_values, rngen);
+	        METRIC_COUNT(SAMPLES, 1);
 		}
     }
 
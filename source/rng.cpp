@@ -0,0 +1,92 @@
+/************************************************************************/
+/* Seeded random streams                       					        */
+/* Version:			1.0													*/
+/* Last changed:	18-10-2026                                         	*/
+/*                                                                     	*/
+/* Version History:                                                    	*/
+/*                                                                     	*/
+/* Version Comments:                                                   	*/
+/* - stream seeds are SplitMix64 (Steele et al., 2014) of the run seed, */
+/*   an FNV-1a hash of the purpose and the index: a counter-based      	*/
+/*   scheme, so any stream can be created without the ones before it   	*/
+/* - task counters are per purpose; tasks started from one thread (as  	*/
+/*   in mfesim and the batch mode) are numbered the same in every run  	*/
+/************************************************************************/
+
+// headers
+#include <map>
+#include <string>
+#include <mutex>
+#include "dai/util.h"
+#include "rng.h"
+
+static std::mutex rngMutex;
+static bool seeded = false;
+static uint64_t seed = 0;
+static std::map<std::string, uint64_t> tasks;
+
+static uint64_t splitmix(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+void setRunSeed(uint64_t s)
+{
+    {
+        std::lock_guard<std::mutex> lock(rngMutex);
+        seed = s;
+        seeded = true;
+        tasks.clear();
+    }
+    dai::rnd_seed((size_t) streamSeed("libdai", 0));
+}
+
+uint64_t runSeed()
+{
+    {
+        std::lock_guard<std::mutex> lock(rngMutex);
+        if (seeded)
+            return seed;
+    }
+    std::random_device rd;
+    setRunSeed(((uint64_t) rd() << 32) | rd());
+    return runSeed();
+}
+
+uint64_t streamSeed(const char *purpose, uint64_t index)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for (const char *c = purpose; *c != '\0'; c++)
+        h = (h ^ (unsigned char) *c) * 1099511628211ULL;
+    return splitmix(splitmix(runSeed() ^ h) + index);
+}
+
+uint64_t taskSeed(const char *purpose)
+{
+    uint64_t index;
+    runSeed();
+    {
+        std::lock_guard<std::mutex> lock(rngMutex);
+        index = tasks[purpose]++;
+    }
+    return streamSeed(purpose, index);
+}
+
+static std::mt19937 generator(uint64_t s)
+{
+    std::seed_seq seq = { (uint32_t) s, (uint32_t) (s >> 32) };
+    return std::mt19937(seq);
+}
+
+std::mt19937 indexedStream(const char *purpose, uint64_t index)
+{
+    return generator(streamSeed(purpose, index));
+}
+
+std::mt19937 taskStream(const char *purpose)
+{
+    return generator(taskSeed(purpose));
+}
@@ -0,0 +1,26 @@
+#ifndef RNGHEADER
+#define RNGHEADER
+
+// STL includes
+#include <random>
+#include <cstdint>
+
+// Random streams. A run has one seed (--seed, or drawn from std::random_device on first use and then
+// reported like a given one), and every stochastic computation draws from a stream of its own whose seed
+// is a hash of the run seed, a purpose and an index. A stream therefore does not depend on the thread
+// that uses it: parallel code takes one stream per unit of work (a block of samples, a chain), never one
+// per thread, so runs with any number of threads draw the same numbers as a sequential run.
+
+// sets the run seed (and seeds libDAI's own generator with a stream of it)
+void setRunSeed(uint64_t seed);
+uint64_t runSeed();
+
+// the seed and generator of stream 'index' of a purpose ("mfe", "forward", ...)
+uint64_t streamSeed(const char *purpose, uint64_t index);
+std::mt19937 indexedStream(const char *purpose, uint64_t index);
+
+// the seed and generator of the next task of a purpose: the n-th task that asks gets stream n
+uint64_t taskSeed(const char *purpose);
+std::mt19937 taskStream(const char *purpose);
+
+#endif // defined RNGHEADER
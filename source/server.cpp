@@ -0,0 +1,386 @@
+/************************************************************************/
+/* Explanation server on a Unix domain socket 					        */
+/* Version:			1.0													*/
+/* Last changed:	18-10-2026                                         	*/
+/*                                                                     	*/
+/* Version History:                                                    	*/
+/*                                                                     	*/
+/* Version Comments:                                                   	*/
+/* - requests run on a pool of their own: the engines use the shared    */
+/*   pool, and a request waiting there must not pick up another request */
+/* - a request on a busy network is queued there and its pool thread    */
+/*   returns: only one thread per network answers requests             	*/
+/* - requests only hold flat JSON objects (strings, numbers, booleans   */
+/*   and arrays), which are turned into batch query lines, so names     */
+/*   cannot contain blanks.                                             */
+/************************************************************************/
+
+// headers
+#include <sstream>
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "mfesim.h"
+#include "server.h"
+#include "network.h"
+
+static const size_t maxRequest = 1 << 20;       // longest request line in bytes
+
+struct ExplanationServer::Connection
+{
+    explicit Connection(int f) : fd(f) {}
+    ~Connection() { close(fd); }
+
+    int fd;
+    std::mutex write;                   // one response at a time
+    ThreadPool::Group group;
+};
+
+// the members of a flat JSON object; arrays of numbers or strings become comma separated lists, booleans 1 or 0
+static bool parseObject(const std::string &text, std::map<std::string, std::string> &members, std::string &error)
+{
+    size_t pos = 0;
+    auto peek = [&text, &pos]() { while ((pos < text.size()) && std::isspace((unsigned char) text[pos])) pos++; return (pos < text.size()) ? text[pos] : '\0'; };
+    auto string = [&text, &pos](std::string &out)
+    {
+        out.clear();
+        for (pos++; (pos < text.size()) && (text[pos] != '"'); pos++)
+        {
+            if ((text[pos] == '\\') && (pos + 1 < text.size()))
+                pos++;
+            out += text[pos];
+        }
+        return (pos++ < text.size());
+    };
+    auto scalar = [&text, &pos](std::string &out)
+    {
+        size_t begin = pos;
+        while ((pos < text.size()) && (std::isalnum((unsigned char) text[pos]) || (std::strchr("+-.", text[pos]) != NULL)))
+            pos++;
+        out = text.substr(begin, pos - begin);
+        if (out == "true")
+            out = "1";
+        else if (out == "false")
+            out = "0";
+        return !out.empty();
+    };
+
+    error = "malformed JSON object";
+    if (peek() != '{')
+        return false;
+    pos++;
+    if (peek() == '}')
+        return true;
+    while (true)
+    {
+        std::string key, value, item;
+        if ((peek() != '"') || !string(key) || (peek() != ':'))
+            return false;
+        pos++;
+        if (peek() == '"')
+        {
+            if (!string(value))
+                return false;
+        }
+        else if (peek() == '[')
+        {
+            pos++;
+            while (peek() != ']')
+            {
+                if ((peek() == '"') ? !string(item) : !scalar(item))
+                    return false;
+                value += (value.empty() ? "" : ",") + item;
+                if (peek() == ',')
+                    pos++;
+            }
+            pos++;
+        }
+        else if (!scalar(value))
+            return false;
+        members[key] = value;
+
+        char next = peek();
+        pos++;
+        if (next == '}')
+            return true;
+        if (next != ',')
+            return false;
+    }
+}
+
+static std::string failure(const std::string &id, const std::string &message)
+{
+    return "{\"id\":" + jsonString(id) + ",\"error\":" + jsonString(message) + "}";
+}
+
+// requests answered at the same time: one per loaded network, within the core budget
+static size_t concurrentRequests(const dai::PropertySet &opts)
+{
+    size_t budget = opts.hasKey("threads") ? opts.getStringAs<size_t>("threads") : 1;
+    size_t networks = opts.hasKey("networks") ? std::max((size_t) 1, opts.getStringAs<size_t>("networks")) : 8;
+    return std::max((size_t) 1, std::min(budget, networks));
+}
+
+ExplanationServer::ExplanationServer(const dai::PropertySet &opts, ResultStore *store) : props(), _listener(-1), _store(store),
+    _pool(concurrentRequests(opts)), _started(std::chrono::steady_clock::now()),
+    _requests(0), _errors(0), _missed(0), _loads(0), _evictions(0), _cacheHits(0), _active(0), _busyNs(0)
+{
+    props.socket = opts.getStringAs<std::string>("socket");
+    props.networks = 8;
+    if (opts.hasKey("networks"))
+        props.networks = std::max((size_t) 1, opts.getStringAs<size_t>("networks"));
+    props.threads = _pool.size();
+
+    // the engines get what the request threads leave of the budget; a request thread waiting for its
+    // propagation only runs the tasks of that propagation (threadpool.h), so requests never share scratch
+    size_t budget = opts.hasKey("threads") ? opts.getStringAs<size_t>("threads") : 1;
+    if (props.threads == 1)
+        props.engineThreads = std::max((size_t) 1, budget);
+    else
+        props.engineThreads = (budget > props.threads) ? budget - props.threads : 1;
+}
+
+ExplanationServer::~ExplanationServer()
+{
+    if (_listener >= 0)
+    {
+        close(_listener);
+        unlink(props.socket.c_str());
+    }
+}
+
+std::shared_ptr<ExplanationServer::Network> ExplanationServer::network(const std::string &path)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    _recent.remove(path);
+    _recent.push_front(path);
+    std::shared_ptr<Network> &net = _networks[path];
+    if (!net)
+    {
+        net.reset(new Network());
+        net->path = path;
+    }
+    std::shared_ptr<Network> result = net;
+
+    // requests still running on an evicted network keep it alive until they finish
+    while (_recent.size() > props.networks)
+    {
+        _networks.erase(_recent.back());
+        _recent.pop_back();
+        _evictions++;
+    }
+    return result;
+}
+
+std::string ExplanationServer::metrics()
+{
+    std::ostringstream json;
+    json << "{\"uptime\":" << std::chrono::duration<double>(std::chrono::steady_clock::now() - _started).count()
+        << ",\"requests\":" << _requests << ",\"errors\":" << _errors << ",\"deadline_misses\":" << _missed
+        << ",\"active\":" << _active << ",\"threads\":" << props.threads << ",\"engine_threads\":" << props.engineThreads << ",\"loads\":" << _loads << ",\"evictions\":" << _evictions
+        << ",\"cache_hits\":" << _cacheHits << ",\"busy_ns\":" << _busyNs << ",\"networks\":[";
+    std::lock_guard<std::mutex> guard(_lock);
+    for (auto n = _recent.begin(); n != _recent.end(); ++n)
+        json << ((n == _recent.begin()) ? "" : ",") << jsonString(*n);
+    json << "]}";
+    return json.str();
+}
+
+void ExplanationServer::handle(const std::string &request, std::chrono::steady_clock::time_point arrival, const Respond &respond)
+{
+    _requests++;
+    Request r;
+    r.arrival = arrival;
+    r.begin = std::chrono::steady_clock::now();
+    r.deadline = 0.0;
+    r.respond = respond;
+
+    std::map<std::string, std::string> members;
+    std::string error;
+    if (!parseObject(request, members, error))
+    {
+        finish(r, failure("", error));
+        return;
+    }
+    r.id = members["id"];
+    std::string algorithm = members["algorithm"];
+    std::transform(algorithm.begin(), algorithm.end(), algorithm.begin(), [](unsigned char c) { return std::toupper(c); });
+    r.deadline = members.count("deadline") ? std::atof(members["deadline"].c_str()) : 0.0;
+    if (algorithm == "METRICS")
+    {
+        finish(r, metrics());
+        return;
+    }
+    if (members["network"].empty())
+    {
+        finish(r, failure(r.id, "no network"));
+        return;
+    }
+
+    // everything but the network and the deadline is a batch query key
+    r.query = algorithm;
+    for (auto const& m: members)
+        if ((m.first != "id") && (m.first != "algorithm") && (m.first != "network") && (m.first != "deadline"))
+            r.query += " " + m.first + "=" + m.second;
+
+    // the request waits in the queue of its network; the thread that finds the network idle answers the queue
+    std::shared_ptr<Network> net = network(members["network"]);
+    {
+        std::lock_guard<std::mutex> guard(net->lock);
+        net->pending.push_back(r);
+        if (net->busy)
+            return;
+        net->busy = true;
+    }
+    drain(*net);
+}
+
+// answers the queued requests of a network until its queue is empty
+void ExplanationServer::drain(Network &net)
+{
+    while (true)
+    {
+        Request r;
+        {
+            std::lock_guard<std::mutex> guard(net.lock);
+            if (net.pending.empty())
+            {
+                net.busy = false;
+                return;
+            }
+            r = net.pending.front();
+            net.pending.pop_front();
+        }
+        r.begin = std::chrono::steady_clock::now();
+        finish(r, answer(net, r));
+    }
+}
+
+std::string ExplanationServer::answer(Network &net, const Request &r)
+{
+    double waited = std::chrono::duration<double>(std::chrono::steady_clock::now() - r.arrival).count();
+    if ((r.deadline > 0.0) && (waited >= r.deadline))
+        return failure(r.id, "deadline passed before the request could start");
+
+    _active++;
+    std::string response, error;
+    try
+    {
+        if (!net.session)
+        {
+            NetworkNames names;
+            dai::FactorGraph fg = readNetwork(net.path, &names);
+            net.session.reset(new QuerySession(fg, names, 65536, _store));
+            _loads++;
+        }
+
+        // names in the query are resolved with the network
+        Query query;
+        if (!parseQuery(r.query, query, error, &net.session->names()))
+            response = failure(r.id, error);
+        else
+        {
+            // the rest of the deadline, fractions of a second included, is the budget of the algorithm
+            query.id = r.id;
+            if (r.deadline > 0.0)
+                query.cutoffTime = r.deadline - waited;
+            size_t hits = net.session->cacheHits();
+            response = net.session->answer(query);
+            _cacheHits += net.session->cacheHits() - hits;
+        }
+    }
+    catch (std::exception &e)
+    {
+        response = failure(r.id, e.what());
+    }
+    _active--;
+    return response;
+}
+
+// counts a response and sends it
+void ExplanationServer::finish(const Request &r, const std::string &response)
+{
+    auto end = std::chrono::steady_clock::now();
+    if ((r.deadline > 0.0) && (std::chrono::duration<double>(end - r.arrival).count() > r.deadline))
+        _missed++;
+    if (response.find("\"error\":") != std::string::npos)
+        _errors++;
+    _busyNs += std::chrono::duration_cast<std::chrono::nanoseconds>(end - r.begin).count();
+    r.respond(response);
+}
+
+void ExplanationServer::receive(int fd)
+{
+    std::shared_ptr<Connection> connection(new Connection(fd));
+    std::string pending;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+    {
+        pending.append(buffer, n);
+        size_t newline;
+        while ((newline = pending.find('\n')) != std::string::npos)
+        {
+            std::string line = pending.substr(0, newline);
+            pending.erase(0, newline + 1);
+            if (line.find_first_not_of(" \t\r") == std::string::npos)
+                continue;
+
+            auto arrival = std::chrono::steady_clock::now();
+            _pool.submit(connection->group, [this, connection, line, arrival]
+            {
+                handle(line, arrival, [connection](const std::string &answer)
+                {
+                    std::string response = answer + "\n";
+                    std::lock_guard<std::mutex> guard(connection->write);
+                    for (size_t sent = 0; sent < response.size(); )
+                    {
+                        ssize_t k = send(connection->fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+                        if (k <= 0)
+                            return;
+                        sent += k;
+                    }
+                });
+            });
+        }
+        if (pending.size() > maxRequest)
+            break;
+    }
+    // the connection is closed when its last response has been sent
+}
+
+void ExplanationServer::serve()
+{
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (props.socket.size() >= sizeof(address.sun_path))
+        DAI_THROWE(RUNTIME_ERROR, "Socket path too long: " + props.socket);
+    std::strncpy(address.sun_path, props.socket.c_str(), sizeof(address.sun_path) - 1);
+
+    _listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (_listener < 0)
+        DAI_THROWE(RUNTIME_ERROR, "Cannot create a socket");
+    unlink(props.socket.c_str());
+    if ((bind(_listener, (sockaddr *) &address, sizeof(address)) < 0) || (listen(_listener, SOMAXCONN) < 0))
+        DAI_THROWE(RUNTIME_ERROR, "Cannot listen on " + props.socket + ": " + std::strerror(errno));
+    chmod(props.socket.c_str(), S_IRUSR | S_IWUSR);     // only for the user running the server
+    DEBUG(std::cout << "Listening on " << props.socket << " with " << props.threads << " threads" << std::endl)
+
+    while (true)
+    {
+        int fd = accept(_listener, NULL, NULL);
+        if (fd < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            DAI_THROWE(RUNTIME_ERROR, std::string("Cannot accept connections: ") + std::strerror(errno));
+        }
+        std::thread(&ExplanationServer::receive, this, fd).detach();
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef SERVERHEADER
+#define SERVERHEADER
+
+// STL includes
+#include <string>
+#include <map>
+#include <list>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include "dai/properties.h"
+#include "batch.h"
+#include "threadpool.h"
+
+// Explanation server on a local Unix domain socket. Every request is one line of JSON with the network
+// (a .fg, .fgb or .bif file), the algorithm and the batch query keys, e.g.
+//   {"id":"7","network":"alarm.fg","algorithm":"MAP","H":[3,5],"E":[0,1],"e":[1,1],"deadline":2.5}
+// (with names instead of numbers if the network has them, e.g. "H":["LVFAILURE"], see network.h)
+// and is answered by one line of JSON as in the batch mode, in the order in which requests finish. The
+// deadline (seconds after arrival) is the time budget of the algorithm; a request that is still queued at its
+// deadline fails without running. {"algorithm":"METRICS"} returns the server's counters.
+// The most recently used networks stay loaded with their engines and MAP cache; requests on different
+// networks run in parallel, requests on the same network one at a time: they wait in a queue of the network,
+// not on a thread, so a busy network never holds up the others. The core budget (the option "threads") is
+// split as PhaseScheduler does (phases.h): at most one request per loaded network runs at a time, and the
+// engines of the sessions get engineThreads() (the engine option "threads"), the rest of the budget.
+class ExplanationServer
+{
+    public:
+        struct Properties
+        {
+            std::string socket;     // path of the socket
+            size_t networks;        // networks kept loaded
+            size_t threads;         // requests answered at the same time
+            size_t engineThreads;   // threads of the parallel propagation inside a request
+        } props;
+
+        // with a result store, the sessions of all networks look up and store their results there (see batch.h)
+        explicit ExplanationServer(const dai::PropertySet &opts, ResultStore *store = NULL);
+        ~ExplanationServer();
+
+        // the threads the engines of the sessions may use (set the engine option to this before serve())
+        size_t engineThreads() const { return props.engineThreads; }
+
+        // accepts connections until the process ends
+        void serve();
+
+        // receives the answer to a request
+        typedef std::function<void(const std::string &)> Respond;
+
+        // answers one request line: at once, or when the requests queued before it on its network are done
+        void handle(const std::string &request, std::chrono::steady_clock::time_point arrival, const Respond &respond);
+
+    private:
+        struct Request
+        {
+            std::string id;
+            std::string query;                  // as a batch query line
+            double deadline;                    // seconds after arrival (0 = none)
+            std::chrono::steady_clock::time_point arrival;
+            std::chrono::steady_clock::time_point begin;
+            Respond respond;
+        };
+
+        struct Network
+        {
+            Network() : busy(false) {}
+
+            std::string path;
+            std::mutex lock;                    // guards pending and busy
+            std::deque<Request> pending;
+            bool busy;                          // a thread is answering the requests of this network
+            std::unique_ptr<QuerySession> session;  // only used by that thread
+        };
+
+        struct Connection;
+
+        std::shared_ptr<Network> network(const std::string &path);
+        void drain(Network &net);
+        std::string answer(Network &net, const Request &request);
+        void finish(const Request &request, const std::string &response);
+        void receive(int fd);
+        std::string metrics();
+
+        std::mutex _lock;                       // guards _networks and _recent
+        std::list<std::string> _recent;         // loaded networks, most recently used first
+        std::map<std::string, std::shared_ptr<Network> > _networks;
+
+        int _listener;
+        ResultStore *_store;
+        ThreadPool _pool;
+        std::chrono::steady_clock::time_point _started;
+        std::atomic<unsigned long> _requests, _errors, _missed, _loads, _evictions, _cacheHits, _active, _busyNs;
+};
+
+#endif // defined SERVERHEADER
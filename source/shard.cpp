@@ -0,0 +1,292 @@
+/************************************************************************/
+/* Sharded MFE and independence runs           					        */
+/* Version:			1.0													*/
+/* Last changed:	18-10-2026                                         	*/
+/*                                                                     	*/
+/* Version History:                                                    	*/
+/*                                                                     	*/
+/* Version Comments:                                                   	*/
+/* - messages are plain text; a shard's message ends with a line       	*/
+/*   "end", so a shard that dies halfway is recognized as failed        */
+/* - the shards are the parallelism: a shard propagates with a single  	*/
+/*   thread and builds its own engine                                  	*/
+/************************************************************************/
+
+// headers
+#include <unistd.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <cerrno>
+#include <csignal>
+#include <sstream>
+#include <limits>
+#include "mfesim.h"
+#include "shard.h"
+#include "rng.h"
+#include "combinations.hpp"		// Howard Hinnant's combinations template
+
+static const std::string endMarker = "end\n";
+
+ForkTransport::~ForkTransport()
+{
+    for (auto &c: _children)
+    {
+        close(c.fd);
+        kill(c.pid, SIGKILL);
+        waitpid(c.pid, NULL, 0);
+    }
+}
+
+void ForkTransport::start(size_t shard, const ShardWork &work)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+        DAI_THROWE(RUNTIME_ERROR, "Cannot create a pipe for shard " + std::to_string(shard));
+    std::cout.flush();
+    std::cerr.flush();
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        close(fds[0]);
+        close(fds[1]);
+        DAI_THROWE(RUNTIME_ERROR, "Cannot start shard " + std::to_string(shard));
+    }
+    if (pid == 0)
+    {
+        close(fds[0]);
+        for (auto &c: _children)
+            close(c.fd);
+        std::string message;
+        int code = 0;
+        try
+        {
+            message = work(shard) + endMarker;
+        }
+        catch (std::exception &e)
+        {
+            // libDAI's exceptions as well as std::bad_alloc and the like: a failure the coordinator can retry
+            std::cerr << "shard " << shard << ": " << e.what() << std::endl;
+            code = 1;
+        }
+        catch (...)
+        {
+            std::cerr << "shard " << shard << ": unknown exception" << std::endl;
+            code = 1;
+        }
+        for (size_t done = 0; done < message.size(); )
+        {
+            ssize_t n = write(fds[1], message.data() + done, message.size() - done);
+            if (n <= 0)
+                _exit(1);
+            done += n;
+        }
+        std::cout.flush();
+        std::cerr.flush();
+        _exit(code);
+    }
+
+    close(fds[1]);
+    Child c;
+    c.pid = pid;
+    c.fd = fds[0];
+    c.shard = shard;
+    _children.push_back(c);
+}
+
+bool ForkTransport::wait(size_t &shard, std::string &message)
+{
+    if (_children.empty())
+        DAI_THROWE(RUNTIME_ERROR, "No shard is running");
+
+    while (true)
+    {
+        std::vector<pollfd> fds;
+        for (auto &c: _children)
+            fds.push_back(pollfd{ c.fd, POLLIN, 0 });
+        if (poll(fds.data(), fds.size(), -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            DAI_THROWE(RUNTIME_ERROR, "Cannot wait for the shards");
+        }
+
+        for (size_t k = 0; k < fds.size(); k++)
+        {
+            if (fds[k].revents == 0)
+                continue;
+            char buffer[65536];
+            ssize_t n = read(fds[k].fd, buffer, sizeof(buffer));
+            if (n > 0)
+            {
+                _children[k].message.append(buffer, n);
+                continue;
+            }
+            if ((n < 0) && (errno == EINTR))
+                continue;
+
+            // end of the message: the shard succeeded if it exited normally after the end marker
+            Child c = _children[k];
+            _children.erase(_children.begin() + k);
+            close(c.fd);
+            int status = 0;
+            waitpid(c.pid, &status, 0);
+            shard = c.shard;
+            bool complete = (c.message.size() >= endMarker.size()) &&
+                (c.message.compare(c.message.size() - endMarker.size(), endMarker.size(), endMarker) == 0);
+            message = complete ? c.message.substr(0, c.message.size() - endMarker.size()) : std::string();
+            return complete && WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+        }
+    }
+}
+
+std::vector<std::string> runShards(size_t shards, size_t retries, const ShardWork &work, ShardTransport &transport)
+{
+    std::vector<std::string> messages(shards);
+    std::vector<size_t> attempts(shards, 1);
+    for (size_t k = 0; k < shards; k++)
+        transport.start(k, work);
+
+    for (size_t running = shards; running > 0; )
+    {
+        size_t shard;
+        std::string message;
+        if (transport.wait(shard, message))
+        {
+            messages[shard] = message;
+            running--;
+        }
+        else if (attempts[shard] <= retries)
+        {
+            std::cerr << "shard " << shard << " failed, starting it again (attempt " << ++attempts[shard] << ")" << std::endl;
+            transport.start(shard, work);
+        }
+        else
+            DAI_THROWE(RUNTIME_ERROR, "Shard " + std::to_string(shard) + " failed " + std::to_string(attempts[shard]) + " times");
+    }
+    return messages;
+}
+
+std::vector<unsigned long int> sharded_MFE(const dai::FactorGraph &fg, const std::vector<unsigned int> &evidenceVars,
+    const std::vector<unsigned int> &evidenceValues, const std::vector<unsigned int> &hypothesisVars, const std::vector<unsigned int> &relevantVars,
+    const std::vector<unsigned int> &irrelevantVars, unsigned long int samples, unsigned long int cutoffTime, size_t shards, size_t retries,
+    ShardTransport &transport)
+{
+    // a shard: its part of the samples, its own streams, and its vote table as lines "weight h1 h2 ..."
+    ShardWork work = [&](size_t shard) -> std::string
+    {
+        engineOptions.set("threads", (size_t) 1);
+        setRunSeed(streamSeed("shard", shard));
+        unsigned long int part = samples * (shard + 1) / shards - samples * shard / shards;
+        std::unique_ptr<InferenceEngine> jt(newEngine(fg, engineOptions("inference",std::string("SUMPROD"))));
+        VoteTable votes;
+        compute_MFE(fg, *jt, *jt, evidenceVars, evidenceValues, hypothesisVars, relevantVars, irrelevantVars, false, 0, 0.0, part, cutoffTime,
+            SnapshotHook(), &votes);
+
+        std::ostringstream os;
+        os.precision(std::numeric_limits<double>::max_digits10);
+        for (auto const& v: votes)
+        {
+            os << v.second;
+            for (auto h: v.first)
+                os << " " << h;
+            os << "\n";
+        }
+        return os.str();
+    };
+
+    VoteTable votes;
+    for (auto const& message: runShards(shards, retries, work, transport))
+    {
+        std::istringstream lines(message);
+        std::string line;
+        while (std::getline(lines, line))
+        {
+            std::istringstream is(line);
+            double weight;
+            std::vector<unsigned long int> h;
+            unsigned long int value;
+            is >> weight;
+            while (is >> value)
+                h.push_back(value);
+            votes[h] += weight;
+        }
+    }
+
+    // the assignment with the most votes (the first one in case of a tie, as in compute_MFE)
+    std::vector<unsigned long int> MFE;
+    double best = 0.0;
+    for (auto const& v: votes)
+    {
+        if (v.second > best)
+        {
+            best = v.second;
+            MFE = v.first;
+        }
+    }
+    return MFE;
+}
+
+std::vector<unsigned long int> sharded_max_strong_map_indep(const dai::FactorGraph &fg, const std::vector<unsigned int> &evidenceVars,
+    const std::vector<unsigned int> &evidenceValues, const std::vector<unsigned int> &hypothesisVars, const std::vector<unsigned int> &hypothesisValues,
+    const std::vector<unsigned int> &independenceTestVars, unsigned long int cutoffTime, size_t shards, size_t retries, ShardTransport &transport)
+{
+    // a shard tests the subsets of every size whose number (in the order of for_each_combination) is the shard
+    // modulo shards, and reports the first independent one of every size as a line "size number vars ..."
+    ShardWork work = [&](size_t shard) -> std::string
+    {
+        engineOptions.set("threads", (size_t) 1);
+        std::unique_ptr<InferenceEngine> jt(newEngine(fg, engineOptions("inference",std::string("SUMPROD"))));
+        std::vector<unsigned int> testVars(independenceTestVars);
+        std::ostringstream os;
+        for (size_t k = 0; k <= testVars.size(); k++)
+        {
+            size_t number = 0;
+            for_each_combination(testVars.begin(), testVars.begin() + k, testVars.end(),
+                [&](std::vector<unsigned int>::const_iterator first, std::vector<unsigned int>::const_iterator last)
+            {
+                if (number++ % shards != shard)
+                    return false;
+                std::vector<unsigned int> subset(first, last);
+                if (strong_map_indep_measure(*jt, evidenceVars, evidenceValues, hypothesisVars, hypothesisValues, subset, cutoffTime, true) != 1.0)
+                    return false;
+                os << k << " " << number - 1;
+                for (auto v: subset)
+                    os << " " << v;
+                os << "\n";
+                return true;
+            });
+        }
+        return os.str();
+    };
+
+    // per size, the independent subset with the lowest number is the one max_strong_map_indep finds first
+    std::vector<size_t> firstNumber(independenceTestVars.size() + 1, std::numeric_limits<size_t>::max());
+    std::vector<std::vector<unsigned long int> > first(independenceTestVars.size() + 1);
+    for (auto const& message: runShards(shards, retries, work, transport))
+    {
+        std::istringstream lines(message);
+        std::string line;
+        while (std::getline(lines, line))
+        {
+            std::istringstream is(line);
+            size_t k, number;
+            unsigned long int v;
+            is >> k >> number;
+            if (k >= first.size())
+                DAI_THROWE(RUNTIME_ERROR, "Invalid shard message: " + line);
+            if (number < firstNumber[k])
+            {
+                firstNumber[k] = number;
+                first[k].clear();
+                while (is >> v)
+                    first[k].push_back(v);
+            }
+        }
+    }
+
+    std::vector<unsigned long int> strong;
+    for (size_t k = 0; k < first.size(); k++)
+        if (firstNumber[k] != std::numeric_limits<size_t>::max())
+            strong = first[k];
+    return strong;
+}
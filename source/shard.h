@@ -0,0 +1,73 @@
+#ifndef SHARDHEADER
+#define SHARDHEADER
+
+// STL includes
+#include <string>
+#include <vector>
+#include <functional>
+#include <sys/types.h>
+#include "dai/factorgraph.h"
+
+// Sharded runs: a coordinator splits a job into shards, a transport runs every shard somewhere else and
+// brings back its result as a text message, and the coordinator combines the messages. A shard that fails
+// (a crash, an exception, a message cut short) is started again up to 'retries' times before the job fails.
+
+// computes the message of shard 'shard' (lines ending in a newline)
+typedef std::function<std::string(size_t shard)> ShardWork;
+
+// where shards run. The coordinator starts every shard and then waits for them one at a time, so a
+// transport to other machines only needs to implement these two calls
+class ShardTransport
+{
+    public:
+        virtual ~ShardTransport() {}
+
+        virtual void start(size_t shard, const ShardWork &work) = 0;
+
+        // waits for one of the started shards to end: its index and message; false if it failed
+        virtual bool wait(size_t &shard, std::string &message) = 0;
+};
+
+// runs every shard in a child process of its own (fork) and receives its message over a pipe. Start shards
+// from a process that has no other threads running: the child only has the thread that forked. mfesim does
+// so by running its phases in sequence and its engines with a single thread when it shards (engine option
+// "threads" = 1, so the shared pool of threadpool.h is never started)
+class ForkTransport : public ShardTransport
+{
+    public:
+        ~ForkTransport();
+
+        void start(size_t shard, const ShardWork &work);
+        bool wait(size_t &shard, std::string &message);
+
+    private:
+        struct Child
+        {
+            pid_t pid;
+            int fd;
+            size_t shard;
+            std::string message;
+        };
+
+        std::vector<Child> _children;
+};
+
+// the messages of shards 0 .. shards-1, in shard order
+std::vector<std::string> runShards(size_t shards, size_t retries, const ShardWork &work, ShardTransport &transport);
+
+// MFE with the samples split over the shards. Every shard draws its samples from streams of its own (derived
+// from the run seed and the shard number), and the weighted vote tables of the shards are added up as if
+// one compute_MFE run had cast all votes. For a given seed the answer does not change between runs, but it
+// may with the number of shards. The relevant and irrelevant variables are given (see QueryPlan)
+std::vector<unsigned long int> sharded_MFE(const dai::FactorGraph &fg, const std::vector<unsigned int> &evidenceVars,
+    const std::vector<unsigned int> &evidenceValues, const std::vector<unsigned int> &hypothesisVars, const std::vector<unsigned int> &relevantVars,
+    const std::vector<unsigned int> &irrelevantVars, unsigned long int samples, unsigned long int cutoffTime, size_t shards, size_t retries,
+    ShardTransport &transport);
+
+// max_strong_map_indep with the subsets of every size dealt out round robin over the shards; the answer is
+// the same as that of max_strong_map_indep
+std::vector<unsigned long int> sharded_max_strong_map_indep(const dai::FactorGraph &fg, const std::vector<unsigned int> &evidenceVars,
+    const std::vector<unsigned int> &evidenceValues, const std::vector<unsigned int> &hypothesisVars, const std::vector<unsigned int> &hypothesisValues,
+    const std::vector<unsigned int> &independenceTestVars, unsigned long int cutoffTime, size_t shards, size_t retries, ShardTransport &transport);
+
+#endif // defined SHARDHEADER
@@ -0,0 +1,336 @@
+/************************************************************************/
+/* Persistent result store                     					        */
+/* Version:			1.0													*/
+/* Last changed:	18-10-2026                                         	*/
+/*                                                                     	*/
+/* Version History:                                                    	*/
+/*                                                                     	*/
+/* Version Comments:                                                   	*/
+/* - log record: hash, key length and value length (8 + 4 + 4 bytes),  	*/
+/*   key, value and a checksum of the record (8 bytes), in the byte     */
+/*   order of the machine: a store is not moved between architectures  */
+/* - the index is an open addressing table (linear probing) that is    	*/
+/*   rebuilt at twice the size when it is half full; it is replaced by  */
+/*   renaming, so other processes notice the new file and map it       */
+/* - all locks are taken on the log, which is never replaced            */
+/************************************************************************/
+
+// headers
+#include <cstring>
+#include <cerrno>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "dai/exceptions.h"
+#include "store.h"
+
+static const uint64_t logMagic = 0x3130305352454d46ULL;         // "FMERS001"
+static const uint64_t indexMagic = 0x3130305849454d46ULL;       // "FMEIX001"
+static const uint64_t headerWords = 4;
+static const uint64_t initialCapacity = 1024;
+static const uint64_t recordHeader = 16;
+static const uint32_t maxField = 1U << 30;
+
+static uint64_t fnv1a(const std::string &s, uint64_t hash = 14695981039346656037ULL)
+{
+    for (unsigned char c: s)
+        hash = (hash ^ c) * 1099511628211ULL;
+    return hash;
+}
+
+// holds a lock on the log for as long as it exists
+class LogLock
+{
+    public:
+        LogLock(int fd, int operation) : _fd(fd)
+        {
+            while (flock(_fd, operation) != 0)
+                if (errno != EINTR)
+                    DAI_THROWE(RUNTIME_ERROR, "Cannot lock the result store");
+        }
+        ~LogLock() { flock(_fd, LOCK_UN); }
+
+    private:
+        int _fd;
+};
+
+static bool readAll(int fd, void *buffer, size_t size, uint64_t offset)
+{
+    char *p = static_cast<char *>(buffer);
+    while (size > 0)
+    {
+        ssize_t n = pread(fd, p, size, offset);
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= n;
+        offset += n;
+    }
+    return true;
+}
+
+static bool writeAll(int fd, const void *buffer, size_t size, uint64_t offset)
+{
+    const char *p = static_cast<const char *>(buffer);
+    while (size > 0)
+    {
+        ssize_t n = pwrite(fd, p, size, offset);
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= n;
+        offset += n;
+    }
+    return true;
+}
+
+ResultStore::ResultStore(const std::string &directory) : _logPath(directory + "/results.log"), _indexPath(directory + "/results.idx"),
+    _log(-1), _index(-1), _indexInode(0), _words(NULL), _bytes(0)
+{
+    _log = open(_logPath.c_str(), O_RDWR | O_CREAT, 0644);
+    if (_log < 0)
+        DAI_THROWE(CANNOT_READ_FILE, "Cannot open result store " + _logPath);
+
+    LogLock lock(_log, LOCK_EX);
+    uint64_t magic = 0;
+    if (logSize() == 0)
+    {
+        if (!writeAll(_log, &logMagic, sizeof(logMagic), 0))
+            DAI_THROWE(CANNOT_WRITE_FILE, "Cannot write result store " + _logPath);
+    }
+    else if (!readAll(_log, &magic, sizeof(magic), 0) || (magic != logMagic))
+        DAI_THROWE(INVALID_FACTORGRAPH_FILE, _logPath + " is not a result store");
+    mapIndex();
+    catchUp();
+}
+
+ResultStore::~ResultStore()
+{
+    if (_words != NULL)
+        munmap(_words, _bytes);
+    if (_index >= 0)
+        close(_index);
+    if (_log >= 0)
+        close(_log);
+}
+
+uint64_t ResultStore::logSize() const
+{
+    struct stat st;
+    if (fstat(_log, &st) != 0)
+        DAI_THROWE(CANNOT_READ_FILE, "Cannot read result store " + _logPath);
+    return st.st_size;
+}
+
+// maps the current index file (under a lock); an index that is missing or not valid is rebuilt, which
+// needs the exclusive lock: only the constructor finds such an index, later ones are replaced whole
+void ResultStore::mapIndex()
+{
+    struct stat st;
+    if ((_words != NULL) && (stat(_indexPath.c_str(), &st) == 0) && (st.st_ino == _indexInode))
+        return;
+
+    if (_words != NULL)
+        munmap(_words, _bytes);
+    if (_index >= 0)
+        close(_index);
+    _words = NULL;
+    _index = open(_indexPath.c_str(), O_RDWR);
+    if ((_index < 0) || (fstat(_index, &st) != 0) || ((uint64_t) st.st_size < headerWords * sizeof(uint64_t)))
+    {
+        rebuildIndex(initialCapacity);
+        return;
+    }
+    _bytes = st.st_size;
+    _indexInode = st.st_ino;
+    void *p = mmap(NULL, _bytes, PROT_READ | PROT_WRITE, MAP_SHARED, _index, 0);
+    if (p == MAP_FAILED)
+        DAI_THROWE(CANNOT_READ_FILE, "Cannot map result index " + _indexPath);
+    _words = static_cast<uint64_t *>(p);
+    if ((_words[0] != indexMagic) || (_bytes != (headerWords + 2 * _words[1]) * sizeof(uint64_t)) || (_words[3] > logSize()))
+        rebuildIndex(initialCapacity);
+}
+
+// writes a new index of every record in the log next to the old one and renames it over it
+void ResultStore::rebuildIndex(uint64_t capacity)
+{
+    // large enough to stay at most half full with the records in the log
+    uint64_t records = 0, end = logSize(), hash;
+    std::string key, value;
+    for (uint64_t offset = sizeof(logMagic); (offset = readRecord(offset, end, hash, key, value)) != 0; )
+        records++;
+    while ((records + 1) * 2 > capacity)
+        capacity *= 2;
+
+    std::string temporary = _indexPath + "." + std::to_string(getpid());
+    int fd = open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    size_t bytes = (headerWords + 2 * capacity) * sizeof(uint64_t);
+    if ((fd < 0) || (ftruncate(fd, bytes) != 0))
+        DAI_THROWE(CANNOT_WRITE_FILE, "Cannot write result index " + temporary);
+    void *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+        DAI_THROWE(CANNOT_WRITE_FILE, "Cannot map result index " + temporary);
+
+    if (_words != NULL)
+        munmap(_words, _bytes);
+    if (_index >= 0)
+        close(_index);
+    _index = fd;
+    _words = static_cast<uint64_t *>(p);
+    _bytes = bytes;
+    _words[0] = indexMagic;
+    _words[1] = capacity;
+    _words[2] = 0;
+    _words[3] = sizeof(logMagic);
+    catchUp();
+
+    if (rename(temporary.c_str(), _indexPath.c_str()) != 0)
+        DAI_THROWE(CANNOT_WRITE_FILE, "Cannot replace result index " + _indexPath);
+    struct stat st;
+    fstat(_index, &st);
+    _indexInode = st.st_ino;
+}
+
+// indexes the records added to the log after the indexed end (exclusive lock); a record cut short at the end
+// of the log is removed
+void ResultStore::catchUp()
+{
+    uint64_t end = logSize();
+    uint64_t hash;
+    std::string key, value;
+    while (_words[3] < end)
+    {
+        uint64_t next = readRecord(_words[3], end, hash, key, value);
+        if (next == 0)
+        {
+            if (ftruncate(_log, _words[3]) != 0)
+                DAI_THROWE(CANNOT_WRITE_FILE, "Cannot repair result store " + _logPath);
+            break;
+        }
+        if ((_words[2] + 1) * 2 > _words[1])
+        {
+            rebuildIndex(2 * _words[1]);     // indexes the rest of the log as well
+            return;
+        }
+        insertSlot(hash, _words[3]);
+        _words[3] = next;
+    }
+}
+
+// reads the record at offset; the offset of the next record, or 0 if it is not complete
+uint64_t ResultStore::readRecord(uint64_t offset, uint64_t end, uint64_t &hash, std::string &key, std::string &value) const
+{
+    unsigned char header[recordHeader];
+    uint32_t keyLength, valueLength;
+    if ((offset + recordHeader > end) || !readAll(_log, header, recordHeader, offset))
+        return 0;
+    std::memcpy(&hash, header, 8);
+    std::memcpy(&keyLength, header + 8, 4);
+    std::memcpy(&valueLength, header + 12, 4);
+    uint64_t next = offset + recordHeader + keyLength + valueLength + sizeof(uint64_t);
+    if ((keyLength > maxField) || (valueLength > maxField) || (next > end))
+        return 0;
+
+    std::vector<char> data(keyLength + valueLength);
+    uint64_t check;
+    if (!readAll(_log, data.data(), data.size(), offset + recordHeader) ||
+        !readAll(_log, &check, sizeof(check), offset + recordHeader + data.size()))
+        return 0;
+    key.assign(data.data(), keyLength);
+    value.assign(data.data() + keyLength, valueLength);
+    if ((fnv1a(key) != hash) || (fnv1a(value, hash) != check))
+        return 0;
+    return next;
+}
+
+bool ResultStore::findIndexed(uint64_t hash, const std::string &key, std::string &value) const
+{
+    uint64_t mask = _words[1] - 1;
+    uint64_t end = logSize();
+    for (uint64_t slot = hash & mask; ; slot = (slot + 1) & mask)
+    {
+        uint64_t *s = _words + headerWords + 2 * slot;
+        if (s[1] == 0)
+            return false;
+        uint64_t h;
+        std::string k;
+        if ((s[0] == hash) && (readRecord(s[1], end, h, k, value) != 0) && (k == key))
+            return true;
+    }
+}
+
+// records that are in the log but not (yet) in the index: added by a process that stopped before indexing them
+bool ResultStore::findUnindexed(uint64_t hash, const std::string &key, std::string &value) const
+{
+    uint64_t end = logSize(), h;
+    std::string k;
+    for (uint64_t offset = _words[3]; offset < end; )
+    {
+        uint64_t next = readRecord(offset, end, h, k, value);
+        if (next == 0)
+            return false;
+        if ((h == hash) && (k == key))
+            return true;
+        offset = next;
+    }
+    return false;
+}
+
+void ResultStore::insertSlot(uint64_t hash, uint64_t offset)
+{
+    uint64_t mask = _words[1] - 1;
+    uint64_t slot = hash & mask;
+    while (_words[headerWords + 2 * slot + 1] != 0)
+        slot = (slot + 1) & mask;
+    _words[headerWords + 2 * slot] = hash;
+    _words[headerWords + 2 * slot + 1] = offset;
+    _words[2]++;
+}
+
+bool ResultStore::get(const std::string &key, std::string &value)
+{
+    std::lock_guard<std::mutex> guard(_threads);
+    LogLock lock(_log, LOCK_SH);
+    mapIndex();
+    uint64_t hash = fnv1a(key);
+    return findIndexed(hash, key, value) || findUnindexed(hash, key, value);
+}
+
+void ResultStore::put(const std::string &key, const std::string &value)
+{
+    if ((key.size() > maxField) || (value.size() > maxField))
+        DAI_THROWE(RUNTIME_ERROR, "Result too large for the result store");
+
+    std::lock_guard<std::mutex> guard(_threads);
+    LogLock lock(_log, LOCK_EX);
+    mapIndex();
+    catchUp();
+    uint64_t hash = fnv1a(key);
+    std::string existing;
+    if (findIndexed(hash, key, existing))
+        return;
+
+    uint32_t keyLength = key.size(), valueLength = value.size();
+    uint64_t check = fnv1a(value, hash);
+    std::string record(recordHeader, '\0');
+    std::memcpy(&record[0], &hash, 8);
+    std::memcpy(&record[8], &keyLength, 4);
+    std::memcpy(&record[12], &valueLength, 4);
+    record += key;
+    record += value;
+    record.append(reinterpret_cast<const char *>(&check), sizeof(check));
+    if (!writeAll(_log, record.data(), record.size(), _words[3]))
+        DAI_THROWE(CANNOT_WRITE_FILE, "Cannot write result store " + _logPath);
+    catchUp();
+}
+
+size_t ResultStore::size()
+{
+    std::lock_guard<std::mutex> guard(_threads);
+    LogLock lock(_log, LOCK_SH);
+    mapIndex();
+    return _words[2];
+}
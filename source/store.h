@@ -0,0 +1,56 @@
+#ifndef STOREHEADER
+#define STOREHEADER
+
+// STL includes
+#include <string>
+#include <cstdint>
+#include <mutex>
+#include <sys/types.h>
+
+// Results kept on disk between runs (--store DIR). The directory holds an append-only log of key/value
+// records (results.log) and a hash index into it (results.idx) that is mapped into memory. The keys name
+// the network by its contents (contentHash in network.h) and the query with all parameters that change the
+// answer (see QueryPlan), so a result is only found again for the same question. Several processes may use
+// one store at the same time (and the threads of one): lookups hold a shared lock on the log, additions an
+// exclusive one. The log is what counts: an index that is missing, or behind the log after a crash, is
+// brought up to date from it, and a record cut short by a crash is dropped.
+class ResultStore
+{
+    public:
+        // opens the store in directory (which must exist), creating its files when needed
+        explicit ResultStore(const std::string &directory);
+        ~ResultStore();
+
+        // the value stored under key; false if there is none
+        bool get(const std::string &key, std::string &value);
+
+        // stores value under key, unless the key is already there (the first value stays)
+        void put(const std::string &key, const std::string &value);
+
+        // the number of stored results
+        size_t size();
+
+    private:
+        ResultStore(const ResultStore &);
+        ResultStore &operator=(const ResultStore &);
+
+        void mapIndex();
+        void rebuildIndex(uint64_t capacity);
+        void catchUp();
+        uint64_t logSize() const;
+        uint64_t readRecord(uint64_t offset, uint64_t end, uint64_t &hash, std::string &key, std::string &value) const;
+        bool findIndexed(uint64_t hash, const std::string &key, std::string &value) const;
+        bool findUnindexed(uint64_t hash, const std::string &key, std::string &value) const;
+        void insertSlot(uint64_t hash, uint64_t offset);
+
+        std::string _logPath;
+        std::string _indexPath;
+        int _log;
+        int _index;
+        ino_t _indexInode;
+        uint64_t *_words;           // the mapped index: magic, capacity, count, indexed end of the log, then (hash, offset) slots
+        size_t _bytes;
+        std::mutex _threads;        // flock() does not exclude threads that share the descriptor
+};
+
+#endif // defined STOREHEADER
@@ -0,0 +1,190 @@
+/************************************************************************/
+/* Work-stealing thread pool                   					        */
+/* Version:			1.0													*/
+/* Last changed:	18-10-2026                                         	*/
+/*                                                                     	*/
+/* Version History:                                                    	*/
+/*                                                                     	*/
+/* Version Comments:                                                   	*/
+/* - a single pool is shared by all parallel code (see shared()), so   	*/
+/*   nested parallelism never creates more threads than requested.     	*/
+/* - threads outside the pool share one worker index, so when they     	*/
+/*   wait they only run tasks of their own group.                      	*/
+/************************************************************************/
+
+// headers
+#include <algorithm>
+#include "threadpool.h"
+
+// identifies the pool and worker index of the current thread
+static thread_local const ThreadPool *currentPool = NULL;
+static thread_local size_t currentWorker = 0;
+
+ThreadPool::ThreadPool(size_t threads) : _queued(0), _next(0), _stop(false)
+{
+    if (threads == 0)
+        threads = 1;
+    for (size_t i = 0; i < threads; i++)
+        _queues.push_back(std::unique_ptr<Queue>(new Queue()));
+    for (size_t i = 0; i < threads; i++)
+        _threads.push_back(std::thread(&ThreadPool::loop, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(_sleep);
+        _stop = true;
+    }
+    _wake.notify_all();
+    for (auto &t: _threads)
+        t.join();
+}
+
+ThreadPool &ThreadPool::shared(size_t threads)
+{
+    static std::mutex creation;
+    static std::unique_ptr<ThreadPool> pool;
+
+    std::lock_guard<std::mutex> guard(creation);
+    if (!pool)
+    {
+        if (threads == 0)
+            threads = std::max(1U, std::thread::hardware_concurrency());
+        pool.reset(new ThreadPool(threads));
+    }
+    return *pool;
+}
+
+size_t ThreadPool::worker() const
+{
+    return (currentPool == this) ? currentWorker : size();
+}
+
+void ThreadPool::submit(Group &group, const std::function<void()> &task)
+{
+    Task t;
+    t.run = task;
+    t.group = &group;
+    group._pending++;
+
+    // workers keep their own tasks local (depth first); other threads spread them round robin
+    size_t self = worker();
+    size_t q = (self < size()) ? self : (_next++ % size());
+    {
+        std::lock_guard<std::mutex> guard(_queues[q]->lock);
+        _queues[q]->tasks.push_back(t);
+    }
+    _queued++;
+    {
+        std::lock_guard<std::mutex> guard(_sleep);
+    }
+    _wake.notify_one();
+}
+
+bool ThreadPool::runOne(size_t self, const Group *only)
+{
+    Task t;
+    bool found = false;
+
+    for (size_t k = 0; (k < size()) && !found; k++)
+    {
+        size_t q = (self < size()) ? (self + k) % size() : k;
+        std::lock_guard<std::mutex> guard(_queues[q]->lock);
+        if (_queues[q]->tasks.empty())
+            continue;
+        if (only != NULL)
+        {
+            // a waiting outside thread: only a task of its own group, oldest first
+            auto it = std::find_if(_queues[q]->tasks.begin(), _queues[q]->tasks.end(), [only](const Task &task) { return task.group == only; });
+            if (it == _queues[q]->tasks.end())
+                continue;
+            t = *it;
+            _queues[q]->tasks.erase(it);
+        }
+        else if (q == self)
+        {
+            t = _queues[q]->tasks.back();           // own work: newest first
+            _queues[q]->tasks.pop_back();
+        }
+        else
+        {
+            t = _queues[q]->tasks.front();          // stolen work: oldest first
+            _queues[q]->tasks.pop_front();
+        }
+        found = true;
+    }
+    if (!found)
+        return false;
+    _queued--;
+
+    try
+    {
+        t.run();
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> guard(t.group->_lock);
+        if (!t.group->_error)
+            t.group->_error = std::current_exception();
+    }
+    t.group->_pending--;
+    return true;
+}
+
+void ThreadPool::loop(size_t self)
+{
+    currentPool = this;
+    currentWorker = self;
+
+    while (true)
+    {
+        if (runOne(self))
+            continue;
+
+        std::unique_lock<std::mutex> lock(_sleep);
+        _wake.wait(lock, [this]{ return _stop || (_queued > 0); });
+        if (_stop && (_queued == 0))
+            return;
+    }
+}
+
+void ThreadPool::wait(Group &group)
+{
+    // help out instead of blocking: the tasks we wait for may be queued behind us. A thread outside the pool
+    // only helps with its own group, so it never runs the task of another outside thread under the same index
+    size_t self = worker();
+    const Group *only = (self < size()) ? NULL : &group;
+    while (group._pending > 0)
+    {
+        if (!runOne(self, only))
+            std::this_thread::yield();
+    }
+
+    if (group._error)
+    {
+        std::exception_ptr error = group._error;
+        group._error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::parallel_for(size_t n, size_t grain, const std::function<void(size_t, size_t)> &body)
+{
+    size_t chunks = std::min(size(), (grain > 0) ? n / grain : n);
+    if (chunks <= 1)
+    {
+        body(0, n);
+        return;
+    }
+
+    Group group;
+    size_t step = (n + chunks - 1) / chunks;
+    for (size_t begin = step; begin < n; begin += step)
+    {
+        size_t end = std::min(n, begin + step);
+        submit(group, [&body, begin, end]{ body(begin, end); });
+    }
+    body(0, std::min(n, step));
+    wait(group);
+}
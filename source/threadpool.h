@@ -0,0 +1,80 @@
+#ifndef THREADPOOLHEADER
+#define THREADPOOLHEADER
+
+// STL includes
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+
+// Work-stealing thread pool. Every worker owns a deque: it pushes and pops its own tasks at the back
+// and steals from the front of the other deques when its own deque is empty. Tasks are submitted
+// to a Group; waiting for a group executes pending tasks instead of blocking, so tasks may
+// submit and wait for subtasks without deadlocking the pool. A worker that waits runs any task, a
+// thread outside the pool only the tasks of the group it waits for: all outside threads share the
+// index size() (see worker()), so they must never run each other's tasks.
+class ThreadPool
+{
+    public:
+        class Group
+        {
+            public:
+                Group() : _pending(0) {}
+
+            private:
+                friend class ThreadPool;
+                std::atomic<size_t> _pending;
+                std::mutex _lock;
+                std::exception_ptr _error;      // first exception thrown by a task of this group
+        };
+
+        explicit ThreadPool(size_t threads);
+        ~ThreadPool();
+
+        // the pool shared by all parallel code in mfesim, created with the given number of threads on first use
+        static ThreadPool &shared(size_t threads = 0);
+
+        void submit(Group &group, const std::function<void()> &task);
+        void wait(Group &group);
+
+        // run body(begin, end) on consecutive chunks of [0, n) that are at least 'grain' long
+        void parallel_for(size_t n, size_t grain, const std::function<void(size_t, size_t)> &body);
+
+        size_t size() const { return _threads.size(); }
+
+        // index of the calling worker thread, or size() when called from a thread outside the pool. Code that
+        // keeps scratch per index keeps it per object (an engine), which one outside thread uses at a time: the
+        // tasks of that object then only run on the workers and on the thread that submitted them
+        size_t worker() const;
+
+    private:
+        struct Task
+        {
+            std::function<void()> run;
+            Group *group;
+        };
+
+        struct Queue
+        {
+            std::mutex lock;
+            std::deque<Task> tasks;
+        };
+
+        bool runOne(size_t self, const Group *only = NULL);
+        void loop(size_t self);
+
+        std::vector<std::thread> _threads;
+        std::vector<std::unique_ptr<Queue> > _queues;
+        std::mutex _sleep;
+        std::condition_variable _wake;
+        std::atomic<size_t> _queued;
+        std::atomic<size_t> _next;
+        std::atomic<bool> _stop;
+};
+
+#endif // defined THREADPOOLHEADER
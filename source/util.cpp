@@ -14,9 +14,13 @@
 #include <chrono>
 #include <ctime>
 #include "mfesim.h"
+#include "metrics.h"
 #include "dai/alldai.h"
 #include "dai/jtree.h"
 
+// properties passed to every junction tree engine (e.g. the number of threads), set from the command line
+dai::PropertySet engineOptions;
+
 // from www.techiedelight.com/print-vector-cpp/
 std::ostream& operator<<(std::ostream& os, const std::vector<int> &input)
 {
@@ -64,9 +68,8 @@ void iterate(unsigned int dimensions, unsigned int skip_node, std::vector<unsign
 }
 
 void random_sample(unsigned int dimensions, unsigned int skip_node, std::vector<unsigned int> &ordinates, std::vector<unsigned int> maximums,
-	std::mt19937 rngen)
+	std::mt19937 &rngen)
 {
-	auto start = std::chrono::steady_clock::now();
    // iterate over dimensions in reverse...
     for (int dimension = dimensions - 1; dimension >= 0; dimension--)
     {
@@ -83,33 +86,43 @@ void random_sample(unsigned int dimensions, unsigned int skip_node, std::vector<
 		std::uniform_int_distribution<> dist(0, maximums[dimension]);
 		ordinates[dimension] = dist(rngen);
 	}
-	auto end = std::chrono::steady_clock::now();
-	std::cout << "Taking a sample " << std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() << " ns" << std::endl;
-	DEBUG(std::cout << "Taking a sample " << std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() << " ns" << std::endl;)
 }
 
 std::vector<unsigned long int> get_mpe(dai::FactorGraph fg, std::vector<unsigned int> evidence_vars, std::vector<unsigned int> evidence_values)
 {
-	// returns the mpe, the joint value assignment to the hypothesis vars that has maximum posterior probability given the evidence
+    std::unique_ptr<InferenceEngine> jt(newEngine(fg, engineOptions("inference",std::string("MAXPROD"))));
+    return get_mpe(*jt, evidence_vars, evidence_values);
+}
 
-    std::vector<unsigned long int> mpe;
+std::vector<unsigned long int> get_mpe(InferenceEngine &jt, const std::vector<unsigned int> &evidence_vars, const std::vector<unsigned int> &evidence_values)
+{
+	// returns the mpe, the joint value assignment to all variables that has maximum posterior probability given the evidence
+	// (jt must use MAXPROD inference)
 
-    for (int i = 0; i < evidence_vars.size(); i++)
-    {
-        fg.clamp(evidence_vars[i], evidence_values[i], false);
-    }
-    
-    dai::PropertySet opts;
-    dai::JTree jt = dai::JTree(fg, opts("updates",std::string("HUGIN"))("inference",std::string("MAXPROD")));
-    jt.init();
-    jt.run();
-    mpe = jt.findMaximum();
+	{
+		METRIC_PHASE("MPE.propagate");
+		jt.run(evidence_vars, evidence_values);
+	}
+	METRIC_PHASE("MPE.maximize");
+    std::vector<size_t> maximum = jt.findMaximum();
 
-    return mpe;
+    return std::vector<unsigned long int>(maximum.begin(), maximum.end());
 }
 
 std::vector<unsigned long int> get_map(dai::FactorGraph fg, std::vector<unsigned int> hypothesis_vars, std::vector<unsigned int> evidence_vars,
 	std::vector<unsigned int> evidence_values, bool mapList)
+{
+	std::unique_ptr<InferenceEngine> jt;
+	{
+		METRIC_PHASE("MAP.build");
+		jt.reset(newEngine(fg, engineOptions("inference",std::string("SUMPROD"))));
+	}
+
+    return get_map(*jt, hypothesis_vars, evidence_vars, evidence_values, mapList);
+}
+
+std::vector<unsigned long int> get_map(InferenceEngine &jt, const std::vector<unsigned int> &hypothesis_vars, const std::vector<unsigned int> &evidence_vars,
+	const std::vector<unsigned int> &evidence_values, bool mapList)
 {
 	// returns the map, the joint value assignment to the hypothesis vars that has maximum posterior probability given the evidence
 	// while marginalizing over the (relevant) intermediate variables. As libDAI has no MAP function we just compute the distribution
@@ -117,56 +130,46 @@ std::vector<unsigned long int> get_map(dai::FactorGraph fg, std::vector<unsigned
 
 	// when used in MFE function, the evidence is the actual 'real' evidence plus the sampled irrelevant intermediate nodes
 
+	// the junction tree is built once by the caller; here we only enter the evidence and propagate
+
     std::vector<unsigned long int> map;
-    std::vector<unsigned long int> h_vars(begin(hypothesis_vars), end(hypothesis_vars));    // needs cast to long
+	std::vector<dai::Real> hypProbs;
 
-	dai::VarSet hypSet = fg.inds2vars(h_vars);
+	dai::VarSet hypSet;
+	for (auto const& h: hypothesis_vars)
+		hypSet.insert(jt.var(h));
 
-	auto start = std::chrono::steady_clock::now();
-    for (int i = 0; i < evidence_vars.size(); i++)
-    {
-        fg.clamp(evidence_vars[i], evidence_values[i], false);
-    }
-	auto end = std::chrono::steady_clock::now();
-	DEBUG(std::cout << "Clamping evidence " << std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() << " ns" << std::endl;)
-
-	start = std::chrono::steady_clock::now();
-    dai::PropertySet opts;
-    dai::JTree jt = dai::JTree(fg, opts("updates",std::string("HUGIN"))("inference",std::string("SUMPROD")));
-    jt.init();
-    jt.run();
-	end = std::chrono::steady_clock::now();
-	DEBUG(std::cout << "JT run " << std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() << " ns" << std::endl;)
-
-	start = std::chrono::steady_clock::now();
-	dai::Factor hypFact = jt.calcMarginal(hypSet);
-	end = std::chrono::steady_clock::now();
-	DEBUG(std::cout << "Marginal time " << std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() << " ns" << std::endl;)
+	{
+		METRIC_PHASE("MAP.propagate");
+		jt.run(evidence_vars, evidence_values);
+	}
+	{
+		METRIC_PHASE("MAP.marginal");
+		jt.calcMarginal(hypSet, hypProbs);
+	}
     
 	// find element with maximum value ( = MAP explanation)
-	start = std::chrono::steady_clock::now();
+	METRIC_PHASE("MAP.maximize");
 	double max = 0.0;
 	int entry = 0; 
-    for (int i = 0; i < hypFact.nrStates(); i++)
+    for (size_t i = 0; i < hypProbs.size(); i++)
     {
         if (mapList)
         {
-            std::cout << "entry ";
-            for (auto const& j: dai::calcState(hypFact.vars(), i))
-                std::cout << j.second;
-            std::cout << " has probability " << hypFact.p()[i] << std::endl;
+            std::cerr << "entry ";
+            for (auto const& j: dai::calcState(hypSet, i))
+                std::cerr << j.second;
+            std::cerr << " has probability " << hypProbs[i] << std::endl;
         }
-		if (hypFact.p()[i] > max)
+		if (hypProbs[i] > max)
 		{
-    	    max = hypFact.p()[i];
+    	    max = hypProbs[i];
 			entry = i;
 		}
     }
 
 	// transform index to map of <Var, value> pairs
-	std::map<dai::Var, size_t> mapValues = dai::calcState(hypFact.vars(), entry);
-	end = std::chrono::steady_clock::now();
-	DEBUG(std::cout << "MAP time " << std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() << " ns" << std::endl;)
+	std::map<dai::Var, size_t> mapValues = dai::calcState(hypSet, entry);
 
 	// now set map accordingly to the values in hypothesis_vars
 	for (auto const& i: mapValues)
@@ -188,18 +191,23 @@ std::vector<unsigned long int> prior_map(dai::FactorGraph fg, std::vector<unsign
 
 std::vector<unsigned long int> local_prior_map(dai::FactorGraph fg, std::vector<unsigned int> hypothesis_vars, 
     std::vector<double>& map_scores)
+{
+    std::unique_ptr<InferenceEngine> jt(newEngine(fg, engineOptions("inference",std::string("SUMPROD"))));
+    return local_prior_map(*jt, hypothesis_vars, map_scores);
+}
+
+std::vector<unsigned long int> local_prior_map(InferenceEngine &jt, const std::vector<unsigned int> &hypothesis_vars, 
+    std::vector<double>& map_scores)
 {
 	// returns the assignments to the hypothesis vars which each individually have maximum *prior* probability
     std::vector<unsigned long int> local_map;
+	std::vector<unsigned int> evidence;			// empty evidence
 
-    dai::PropertySet opts;
-    dai::JTree jt = dai::JTree(fg, opts("updates",std::string("HUGIN"))("inference",std::string("SUMPROD")));
-    jt.init();
-    jt.run();
+    jt.run(evidence, evidence);
 	
 	for (auto const& var: hypothesis_vars)
 	{
-		dai::Factor hypFact = jt.belief(fg.var(var));
+		dai::Factor hypFact = jt.belief(jt.var(var));
 		double max = 0.0;
 		int entry = 0; 
         for (int i = 0; i < hypFact.nrStates(); i++)
@@ -216,33 +224,33 @@ std::vector<unsigned long int> local_prior_map(dai::FactorGraph fg, std::vector<
 	return local_map;
 }	
 
-int sample(dai::Factor fact, double rand)
+int sample(const dai::Factor &fact, double rand)
 {
-    // return a sample of the factor according to its potentials
-    double sum = 0.0;
-    int entry = 0;
+    // return a sample of the factor according to its potentials; for many draws from the same
+    // distributions, ForwardSampler's alias tables are faster
+    const dai::Prob &p = fact.p();
+    size_t entry = 0;
 
-    rand = rand * fact.p().sum();               // marginalize
+    rand = rand * p.sum();                      // marginalize
 
-    while (sum < rand)                          // sample
+    while ((entry + 1 < p.size()) && (rand >= p[entry]))      // sample
     {
-        sum = sum + fact.p()[entry];
+        rand = rand - p[entry];
         entry++;
     }
-    entry--;
 
-    DEBUG(std::cout << "sampling from " << fact << " gives entry " << entry << " with prob " << fact.p()[entry] << std::endl;)
+    DEBUG(std::cout << "sampling from " << fact << " gives entry " << entry << " with prob " << p[entry] << std::endl;)
 		
     return entry;                            // sample'd entry from factor
 }
 
-std::vector<unsigned int> getIntermediateVars(dai::FactorGraph fg, std::vector<unsigned int> hypothesis_vars, 
-    std::vector<unsigned int> evidence_vars)
+std::vector<unsigned int> getIntermediateVars(const dai::FactorGraph &fg, const std::vector<unsigned int> &hypothesis_vars, 
+    const std::vector<unsigned int> &evidence_vars)
 {
 	// populate intermediate vars by matching all variables in fg with hypothesis and evidence variables
 
     std::vector<unsigned int> intermediateVars;
-	std::vector<unsigned int>::iterator it;
+	std::vector<unsigned int>::const_iterator it;
 
 	for (size_t i = 0; i < fg.nrVars(); i++ )
 	{